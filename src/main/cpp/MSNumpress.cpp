@@ -19,10 +19,40 @@
 
 #include <iostream>
 #include <cmath>
+#include <cfloat>
 #include <climits>
 #include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
 #include "MSNumpress.hpp"
 
+// SIMD kernels are compiled with per-function target attributes and selected
+// at runtime, so the library itself can be built without any -m flags.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MSNUMPRESS_X86 1
+#include <immintrin.h>
+#define MSNUMPRESS_TARGET(t) __attribute__((target(t)))
+#else
+#define MSNUMPRESS_X86 0
+#endif
+
+// kernels whose scalar and SIMD versions must round alike keep GCC from
+// fusing their multiplies and adds when the build enables FMA
+#if defined(__GNUC__) && !defined(__clang__)
+#define MSNUMPRESS_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define MSNUMPRESS_NO_CONTRACT
+#endif
+
 namespace ms {
 namespace numpress {
 namespace MSNumpress {
@@ -42,6 +72,78 @@ static bool is_little_endian() {
 }
 bool IS_LITTLE_ENDIAN = is_little_endian();
 
+// Byte order, known at compile time on all common compilers. Where it is not,
+// IS_LITTLE_ENDIAN above is used.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MSNUMPRESS_LITTLE_ENDIAN 1
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MSNUMPRESS_LITTLE_ENDIAN 0
+#elif defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM64)
+#define MSNUMPRESS_LITTLE_ENDIAN 1
+#else
+#define MSNUMPRESS_LITTLE_ENDIAN IS_LITTLE_ENDIAN
+#endif
+
+static inline unsigned long long byteSwap(
+		unsigned long long x
+) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_bswap64(x);
+#elif defined(_MSC_VER)
+	return _byteswap_uint64(x);
+#else
+	x = ((x & 0x00ff00ff00ff00ffULL) << 8)  | ((x >> 8)  & 0x00ff00ff00ff00ffULL);
+	x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+	return (x << 32) | (x >> 32);
+#endif
+}
+
+static inline unsigned long long loadLittleEndian(
+		const unsigned char *data
+) {
+	unsigned long long x;
+	memcpy(&x, data, 8);
+	return MSNUMPRESS_LITTLE_ENDIAN ? x : byteSwap(x);
+}
+
+static inline unsigned int loadLittleEndian32(
+		const unsigned char *data
+) {
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+}
+
+static inline void storeLittleEndian(
+		unsigned long long x,
+		unsigned char *result
+) {
+	x = MSNUMPRESS_LITTLE_ENDIAN ? x : byteSwap(x);
+	memcpy(result, &x, 8);
+}
+
+/**
+ * Doubles are always stored in big-endian byte order
+ */
+static inline double loadDouble(
+		const unsigned char *data
+) {
+	unsigned long long x;
+	double d;
+	memcpy(&x, data, 8);
+	x = MSNUMPRESS_LITTLE_ENDIAN ? byteSwap(x) : x;
+	memcpy(&d, &x, 8);
+	return d;
+}
+
+static inline void storeDouble(
+		double d,
+		unsigned char *result
+) {
+	unsigned long long x;
+	memcpy(&x, &d, 8);
+	x = MSNUMPRESS_LITTLE_ENDIAN ? byteSwap(x) : x;
+	memcpy(result, &x, 8);
+}
+
 
 
 /////////////////////////////////////////////////////////////
@@ -50,11 +152,7 @@ static void encodeFixedPoint(
 		double fixedPoint, 
 		unsigned char *result
 ) {
-	int i;
-	unsigned char *fp = (unsigned char*)&fixedPoint;
-	for (i=0; i<8; i++) {
-		result[i] = fp[IS_LITTLE_ENDIAN ? (7-i) : i];
-	}
+	storeDouble(fixedPoint, result);
 }
 
 
@@ -62,75 +160,170 @@ static void encodeFixedPoint(
 static double decodeFixedPoint(
 		const unsigned char *data
 ) {
-	int i;
-	double fixedPoint;
-	unsigned char *fp = (unsigned char*)&fixedPoint;
-		
-	for (i=0; i<8; i++) {
-		fp[i] = data[IS_LITTLE_ENDIAN ? (7-i) : i];
-	}
-	
-	return fixedPoint;
+	return loadDouble(data);
 }
 
 /////////////////////////////////////////////////////////////
 
 /**
- * Encodes the int x as a number of halfbytes in res. 
- * res_length is incremented by the number of halfbytes, 
- * which will be 1 <= n <= 9
+ * The SIMD kernels of the codecs. There is one set per SimdTier, and 
+ * kernels() returns the one in use.
+ */
+typedef void (*IntLengthsFn)(const unsigned char*, size_t, unsigned char*);
+typedef void (*LinearValuesFn)(const unsigned int*, size_t, long long*, double, double*);
+typedef void (*SafeResidualsFn)(const double*, size_t, unsigned char*);
+typedef void (*SafeValuesFn)(const unsigned char*, size_t, double*, double*);
+typedef double (*MaxValueFn)(const double*, size_t);
+typedef void (*SlofCodesFn)(const double*, size_t, double, unsigned char*);
+typedef void (*SlofGatherFn)(const unsigned char*, size_t, const double*, double*);
+typedef bool (*Base64DecodeFn)(const char*, size_t, unsigned char*);
+typedef void (*Base64EncodeFn)(const unsigned char*, size_t, char*);
+typedef void (*PicSvValuesFn)(const unsigned char*, const unsigned char*, size_t, size_t, double*);
+typedef void (*PicForValuesFn)(const unsigned char*, size_t, unsigned int, unsigned int, double*);
+typedef void (*LogIntsFn)(const double*, size_t, double, long long*);
+typedef void (*ExpValuesFn)(double*, size_t);
+
+struct Kernels {
+	IntLengthsFn intLengths;
+	LinearValuesFn linearValues;
+	SafeResidualsFn safeResiduals;
+	SafeValuesFn safeValues;
+	MaxValueFn maxValue;
+	SlofCodesFn slofCodes;
+	SlofGatherFn slofGather;
+	Base64DecodeFn base64Decode;
+	Base64EncodeFn base64Encode;
+	PicSvValuesFn picSvValues;
+	PicForValuesFn picForValues;
+	LogIntsFn logInts;
+	ExpValuesFn expValues;
+};
+
+static const Kernels &kernels();
+
+/////////////////////////////////////////////////////////////
+
+/**
+ * Counts the leading zero bits of x, which must not be 0.
+ */
+static inline unsigned int countLeadingZeros(
+		unsigned long long x
+) {
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned int>(__builtin_clzll(x));
+#else
+	unsigned int n = 0;
+	while ((x & 0x8000000000000000ULL) == 0) {
+		x <<= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+
+
+/**
+ * Returns the number of leading 0x0 (or 0xf) halfbytes of x that encodeInt
+ * leaves out, taken from the leading zero bits of x (or ~x), so that no 
+ * halfbyte is inspected individually.
+ */
+static inline unsigned int leadingHalfBytes(
+		const unsigned int x
+) {
+	unsigned int neg = x >> 31;
+	unsigned int t = x ^ (0u - neg); // ~x for leading ones, x for leading zeros
+
+	// number of leading 0x0 halfbytes of t, 8 if t == 0 
+	unsigned int l = countLeadingZeros((static_cast<unsigned long long>(t) << 32) | 0x80000000ULL) >> 2;
+
+	// -1 is written as 7 0xf halfbytes followed by a 0xf 
+	return l - ((l >> 3) & neg);
+}
+
+
+
+/**
+ * Encodes the int x as a number of halfbytes. The halfbytes are returned 
+ * packed with the first one in the lowest 4 bits, and *length is set to the 
+ * number of halfbytes, which will be 1 <= n <= 9
  */
-static void encodeInt(
+static inline unsigned long long encodeInt(
 		const unsigned int x,
-		unsigned char* res,
-		size_t *res_length	
+		unsigned int *length
 ) {
-    // get the bit pattern of a signed int x_inp
-	unsigned int m;
-	unsigned char i, l; // numbers between 0 and 9
+	unsigned int neg = x >> 31;
+	unsigned int l = leadingHalfBytes(x);
 
-    unsigned int mask = 0xf0000000;
-    unsigned int init = x & mask;
+	// leading ones get a count of l + 8, unless there are none
+	unsigned int head = l | ((((l + 7) >> 3) & neg) << 3);
 
-	if (init == 0) {
-		l = 8;
-		for (i=0; i<8; i++) {
-			m = mask >> (4*i);
-			if ((x & m) != 0) {
-				l = i;
-				break;
-			}
-		}
-		res[0] = l;
-		for (i=l; i<8; i++) {
-			res[1+i-l] = static_cast<unsigned char>( x >> (4*(i-l)) );
-		}
-		*res_length += 1+8-l;
+	*length = 9 - l;
+	return (head | (static_cast<unsigned long long>(x) << 4)) 
+			& ((1ULL << (4 * (9 - l))) - 1);
+}
 
-	} else if (init == mask) {
-		l = 7;
-		for (i=0; i<8; i++) {
-			m = mask >> (4*i);
-			if ((x & m) != m) {
-				l = i;
-				break;
-			}
-		}
-		res[0] = l + 8;
-		for (i=l; i<8; i++) {
-			res[1+i-l] = static_cast<unsigned char>( x >> (4*(i-l)) );
-		}
-		*res_length += 1+8-l;
 
-	} else {
-		res[0] = 0;
-		for (i=0; i<8; i++) {
-			res[1+i] = static_cast<unsigned char>( x >> (4*i) );
+
+/**
+ * Collects the halfbytes from encodeInt and writes them out as bytes, the 
+ * first halfbyte of each byte in the high bits. acc holds the pending 
+ * halfbytes (the first one in the lowest bits) and bits their number of bits.
+ */
+struct HalfByteWriter {
+	unsigned long long acc;
+	unsigned int bits;
+
+	HalfByteWriter() : acc(0), bits(0) {}
+
+	inline void put(unsigned int x) {
+		unsigned int length;
+		acc |= encodeInt(x, &length) << bits;
+		bits += 4 * length;
+	}
+
+	static inline unsigned long long swapHalfBytes(unsigned long long w) {
+		return ((w >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((w & 0x0f0f0f0f0f0f0f0fULL) << 4);
+	}
+
+	/**
+	 * Writes all complete bytes to result[*ri ..]. Stores a whole word, so
+	 * result must have room for 8 bytes at *ri.
+	 */
+	inline void flushWord(unsigned char *result, size_t *ri) {
+		storeLittleEndian(swapHalfBytes(acc), result + *ri);
+		*ri += bits >> 3;
+		acc >>= bits & ~7u;
+		bits &= 7;
+	}
+
+	/**
+	 * Writes all complete bytes to result[*ri ..], and nothing beyond them.
+	 */
+	inline void flushBytes(unsigned char *result, size_t *ri) {
+		while (bits >= 8) {
+			result[(*ri)++] = static_cast<unsigned char>(swapHalfBytes(acc));
+			acc >>= 8;
+			bits -= 8;
 		}
-		*res_length += 9;
+	}
 
+	/**
+	 * Writes the remaining bytes, padding a last single halfbyte with 0x0.
+	 */
+	inline void finish(unsigned char *result, size_t *ri) {
+		flushBytes(result, ri);
+		if (bits != 0) {
+			result[(*ri)++] = static_cast<unsigned char>((acc & 0xf) << 4);
+			acc = 0;
+			bits = 0;
+		}
 	}
-}
+};
+
+// number of ints that must follow the current one before HalfByteWriter can
+// safely use flushWord without writing past the end of the encoded data
+static const size_t FLUSH_WORD_MARGIN = 16;
 
 
 
@@ -205,11 +398,325 @@ static void decodeInt(
 	}
 }
 
+/////////////////////////////////////////////////////////////
+
+// number of halfbytes (head included) used by an int with the given head
+static const unsigned char INT_LENGTH[16] = {
+	9, 8, 7, 6, 5, 4, 3, 2, 1, 8, 7, 6, 5, 4, 3, 2
+};
+
+// mask of the halfbytes stored after the given head
+static const unsigned int INT_MASK[16] = {
+	0xffffffff, 0x0fffffff, 0x00ffffff, 0x000fffff,
+	0x0000ffff, 0x00000fff, 0x000000ff, 0x0000000f,
+	0x00000000, 0x0fffffff, 0x00ffffff, 0x000fffff,
+	0x0000ffff, 0x00000fff, 0x000000ff, 0x0000000f
+};
+
+// leading 0xf halfbytes implied by the given head
+static const unsigned int INT_FILL[16] = {
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0xf0000000, 0xff000000, 0xfff00000,
+	0xffff0000, 0xfffff000, 0xffffff00, 0xfffffff0
+};
+
+// number of data bytes whose halfbyte lengths are computed at a time
+static const size_t INT_TILE = 512;
+
+// number of ints decodeIntBlock is asked for at a time by the decoders
+static const size_t INT_BLOCK = 1024;
+
+/**
+ * Reads the 8 bytes at data as a little-endian word with the two halfbytes of
+ * every byte swapped, so that halfbyte k of the stream ends up at bits 4k.
+ */
+static inline unsigned long long loadHalfBytes(
+		const unsigned char *data
+) {
+	unsigned long long w = loadLittleEndian(data);
+	return ((w >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((w & 0x0f0f0f0f0f0f0f0fULL) << 4);
+}
+
+
+
+/**
+ * Fills lengths[0 .. 2*n) with INT_LENGTH of every halfbyte in data[0 .. n),
+ * i.e. the length an int would have if it started at that halfbyte.
+ */
+static void intLengthsScalar(
+		const unsigned char *data,
+		size_t n,
+		unsigned char *lengths
+) {
+	for (size_t i=0; i<n; i++) {
+		lengths[2*i] 	= INT_LENGTH[data[i] >> 4];
+		lengths[2*i+1] 	= INT_LENGTH[data[i] & 0xf];
+	}
+}
+
+#if MSNUMPRESS_X86
+
+MSNUMPRESS_TARGET("ssse3")
+static void intLengthsSSSE3(
+		const unsigned char *data,
+		size_t n,
+		unsigned char *lengths
+) {
+	const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(INT_LENGTH));
+	const __m128i low 	= _mm_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; i+16 <= n; i+=16) {
+		__m128i v 	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		__m128i hi 	= _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+		__m128i lo 	= _mm_shuffle_epi8(table, _mm_and_si128(v, low));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lengths + 2*i), 		_mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lengths + 2*i + 16), 	_mm_unpackhi_epi8(hi, lo));
+	}
+	intLengthsScalar(data + i, n - i, lengths + 2*i);
+}
+
+
+
+MSNUMPRESS_TARGET("avx2")
+static void intLengthsAVX2(
+		const unsigned char *data,
+		size_t n,
+		unsigned char *lengths
+) {
+	const __m256i table = _mm256_broadcastsi128_si256(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(INT_LENGTH)));
+	const __m256i low 	= _mm256_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; i+32 <= n; i+=32) {
+		__m256i v 	= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		__m256i hi 	= _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+		__m256i lo 	= _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+		// unpack works within 128 bit lanes, so put the lanes back in order
+		__m256i a 	= _mm256_unpacklo_epi8(hi, lo);
+		__m256i b 	= _mm256_unpackhi_epi8(hi, lo);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lengths + 2*i), 		_mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lengths + 2*i + 32), 	_mm256_permute2x128_si256(a, b, 0x31));
+	}
+	intLengthsScalar(data + i, n - i, lengths + 2*i);
+}
+
+
+
+MSNUMPRESS_TARGET("avx512f,avx512bw")
+static void intLengthsAVX512(
+		const unsigned char *data,
+		size_t n,
+		unsigned char *lengths
+) {
+	// the masked forms take an explicit source, where the plain ones leave 
+	// GCC warning about the undefined one they pass on
+	const __m512i table = _mm512_mask_broadcast_i32x4(_mm512_setzero_si512(), 0xffff,
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(INT_LENGTH)));
+	const __m512i low 	= _mm512_set1_epi8(0x0f);
+	const __m512i first = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+	const __m512i second = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+	size_t i = 0;
+
+	for (; i+64 <= n; i+=64) {
+		__m512i v 	= _mm512_loadu_si512(data + i);
+		__m512i hi 	= _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), low));
+		__m512i lo 	= _mm512_shuffle_epi8(table, _mm512_and_si512(v, low));
+		__m512i a 	= _mm512_unpacklo_epi8(hi, lo);
+		__m512i b 	= _mm512_unpackhi_epi8(hi, lo);
+		_mm512_storeu_si512(lengths + 2*i, 		_mm512_permutex2var_epi64(a, first, b));
+		_mm512_storeu_si512(lengths + 2*i + 64, _mm512_permutex2var_epi64(a, second, b));
+	}
+	intLengthsAVX2(data + i, n - i, lengths + 2*i);
+}
+
+#endif
+
+
+
+/**
+ * Decodes up to maxCount ints into res, continuing from the position given by
+ * di and half (see decodeInt), as long as their head is in a byte followed by
+ * at least 7 more, so that they can be decoded without bounds checks. The int
+ * boundaries are found from a table of halfbyte lengths, and each int is 
+ * extracted with a single word load.
+ *
+ * @return the number of decoded ints, which is smaller than maxCount only
+ * when the next int is too close to the end of the data.
+ */
+static size_t decodeIntTiles(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *di,
+		size_t *half,
+		unsigned int *res,
+		size_t maxCount
+) {
+	unsigned char lengths[2 * INT_TILE];
+	size_t count = 0;
+
+	while (count < maxCount && *di + 8 <= dataSize) {
+		size_t start 	= *di;
+		size_t tile 	= min(INT_TILE, dataSize - 7 - start);
+		size_t end 		= 2 * tile;
+		size_t p 		= *half;
+
+		kernels().intLengths(data + start, tile, lengths);
+
+		while (p < end && count < maxCount) {
+			unsigned long long w = loadHalfBytes(data + start + (p >> 1)) >> ((p & 1) * 4);
+			unsigned int head = static_cast<unsigned int>(w & 0xf);
+			res[count++] = (static_cast<unsigned int>(w >> 4) & INT_MASK[head]) | INT_FILL[head];
+			p += lengths[p];
+		}
+
+		*di 	= start + (p >> 1);
+		*half 	= p & 1;
+	}
+
+	return count;
+}
+
+
+
+/**
+ * Decodes up to maxCount ints into res, continuing from the position given by
+ * di and half (see decodeInt). Gives exactly the same ints as repeated calls
+ * to decodeInt, but away from the end of the data they are decoded by 
+ * decodeIntTiles.
+ *
+ * @return the number of decoded ints, which is smaller than maxCount only
+ * when the end of the data has been reached.
+ */
+static size_t decodeIntBlock(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *di,
+		size_t *half,
+		unsigned int *res,
+		size_t maxCount
+) {
+	size_t count = decodeIntTiles(data, dataSize, di, half, res, maxCount);
+
+	while (count < maxCount && *di < dataSize) {
+		if (*di == (dataSize - 1) && *half == 1) {
+			if ((data[*di] & 0xf) == 0x0) {
+				break;
+			}
+		}
+		decodeInt(data, di, dataSize, half, &res[count++]);
+	}
+
+	return count;
+}
+
+
+
+/**
+ * Skips up to maxCount ints from the position given by di and half (see 
+ * decodeInt), exactly as decodeIntBlock would decode them and throwing where
+ * it would, but only walking the heads.
+ *
+ * @return the number of skipped ints, which is smaller than maxCount only
+ * when the end of the data has been reached.
+ */
+static size_t skipInts(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *di,
+		size_t *half,
+		size_t maxCount
+) {
+	unsigned char lengths[2 * INT_TILE];
+	unsigned int res;
+	size_t count = 0;
+
+	while (count < maxCount && *di + 8 <= dataSize) {
+		size_t start 	= *di;
+		size_t tile 	= min(INT_TILE, dataSize - 7 - start);
+		size_t end 		= 2 * tile;
+		size_t p 		= *half;
+
+		kernels().intLengths(data + start, tile, lengths);
+		for (; p < end && count < maxCount; p += lengths[p]) {
+			count++;
+		}
+
+		*di 	= start + (p >> 1);
+		*half 	= p & 1;
+	}
+
+	while (count < maxCount && *di < dataSize) {
+		if (*di == (dataSize - 1) && *half == 1) {
+			if ((data[*di] & 0xf) == 0x0) {
+				break;
+			}
+		}
+		decodeInt(data, di, dataSize, half, &res);
+		count++;
+	}
+
+	return count;
+}
+
+
+
+/**
+ * Counts the ints from the position given by di and half to the end of the 
+ * data, see skipInts.
+ */
+static size_t countInts(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t di,
+		size_t half
+) {
+	return skipInts(data, dataSize, &di, &half, static_cast<size_t>(-1));
+}
 
 
 
 /////////////////////////////////////////////////////////////
 
+/**
+ * Raises maxDouble to the bound optimalLinearFixedPoint derives from the 
+ * linear prediction residuals of data[begin..end), begin >= 2: the largest
+ * ceil(|residual| + 1), ignoring NaN. As ceil(x + 1) is monotonic, that is 
+ * taken once of the largest |residual|.
+ */
+static double maxLinearResidual(
+		const double *data,
+		size_t begin,
+		size_t end,
+		double maxDouble
+) {
+	double extrapol;
+	double diff;
+	double maxDiff[4] = { -1, -1, -1, -1 };
+	size_t i = begin;
+
+	// independent maxima, so that the loop is not bound by their latency
+	for (; i+4 <= end; i+=4) {
+		for (size_t j=0; j<4; j++) {
+			extrapol = data[i+j-1] + (data[i+j-1] - data[i+j-2]);
+			diff = abs(data[i+j] - extrapol);
+			maxDiff[j] = (maxDiff[j] < diff) ? diff : maxDiff[j];
+		}
+	}
+	for (; i<end; i++) {
+		extrapol = data[i-1] + (data[i-1] - data[i-2]);
+		diff = abs(data[i] - extrapol);
+		maxDiff[0] = (maxDiff[0] < diff) ? diff : maxDiff[0];
+	}
+
+	double m = max(max(maxDiff[0], maxDiff[1]), max(maxDiff[2], maxDiff[3]));
+	return (m < 0) ? maxDouble : max(maxDouble, ceil(m+1));
+}
+
+
+
 double optimalLinearFixedPointMass(
 		const double *data, 
 		size_t dataSize,
@@ -252,17 +759,69 @@ double optimalLinearFixedPoint(
 	*/
 	if (dataSize == 0) return 0;
 	if (dataSize == 1) return floor(0x7FFFFFFFl / data[0]);
-	double maxDouble = max(data[0], data[1]);
-	double extrapol;
-	double diff;
+	double maxDouble = maxLinearResidual(data, 2, dataSize, max(data[0], data[1]));
 
-	for (size_t i=2; i<dataSize; i++) {
-		extrapol = data[i-1] + (data[i-1] - data[i-2]);
-		diff = data[i] - extrapol;
-		maxDouble = max(maxDouble, ceil(abs(diff)+1));
+	return floor(0x7FFFFFFFl / maxDouble);
+}
+
+
+
+/**
+ * Computes the next linear prediction residual of encodeLinear, shifting
+ * ints (the last three fixed point values) along.
+ */
+static inline int linearResidual(
+		double d,
+		double fixedPoint,
+		long long *ints
+) {
+	long long extrapol;
+
+	ints[0] = ints[1];
+	ints[1] = ints[2];
+	if (THROW_ON_OVERFLOW && 
+			d * fixedPoint + 0.5 > LLONG_MAX	) {
+		throw "[MSNumpress::encodeLinear] Next number overflows LLONG_MAX.";
 	}
 
-	return floor(0x7FFFFFFFl / maxDouble);
+	ints[2] = static_cast<long long>(d * fixedPoint + 0.5);
+	extrapol = ints[1] + (ints[1] - ints[0]);
+
+	if (THROW_ON_OVERFLOW && 
+			(		ints[2] - extrapol > INT_MAX 
+				|| 	ints[2] - extrapol < INT_MIN	)) {
+		throw "[MSNumpress::encodeLinear] Cannot encode a number that exceeds the bounds of [-INT_MAX, INT_MAX].";
+	}
+
+	return static_cast<int>(ints[2] - extrapol);
+}
+
+
+
+/**
+ * Encodes the residuals of data[begin..end), begin >= 2, of an encodeLinear
+ * of dataSize values.
+ */
+static void encodeLinearResiduals(
+		const double *data,
+		size_t begin,
+		size_t end,
+		size_t dataSize,
+		double fixedPoint,
+		long long *ints,
+		HalfByteWriter *writer,
+		unsigned char *result,
+		size_t *ri
+) {
+	size_t i = begin;
+	for (; i<end && i + FLUSH_WORD_MARGIN < dataSize; i++) {
+		writer->put(static_cast<unsigned int>(linearResidual(data[i], fixedPoint, ints)));
+		writer->flushWord(result, ri);
+	}
+	for (; i<end; i++) {
+		writer->put(static_cast<unsigned int>(linearResidual(data[i], fixedPoint, ints)));
+		writer->flushBytes(result, ri);
+	}
 }
 
 
@@ -275,11 +834,7 @@ size_t encodeLinear(
 ) {
 	long long ints[3];
 	size_t i, ri;
-	unsigned char halfBytes[10];
-	size_t halfByteCount;
-	size_t hbi;
-	long long extrapol;
-	int diff;
+	HalfByteWriter writer;
 
 	//printf("Encoding %d doubles with fixed point %f\n", (int)dataSize, fixedPoint);
 	encodeFixedPoint(fixedPoint, result);
@@ -299,484 +854,6429 @@ size_t encodeLinear(
 		result[12+i] = (ints[2] >> (i*8)) & 0xff;
 	}
 
-	halfByteCount = 0;
 	ri = 16;
+	encodeLinearResiduals(data, 2, dataSize, dataSize, fixedPoint, ints, &writer, result, &ri);
+	writer.finish(result, &ri);
+	return ri;
+}
 
-	for (i=2; i<dataSize; i++) {
-		ints[0] = ints[1];
-		ints[1] = ints[2];
-		if (THROW_ON_OVERFLOW && 
-				data[i] * fixedPoint + 0.5 > LLONG_MAX	) {
-			throw "[MSNumpress::encodeLinear] Next number overflows LLONG_MAX.";
-		}
 
-		ints[2] = static_cast<long long>(data[i] * fixedPoint + 0.5);
-		extrapol = ints[1] + (ints[1] - ints[0]);
 
-		if (THROW_ON_OVERFLOW && 
-				(		ints[2] - extrapol > INT_MAX 
-					|| 	ints[2] - extrapol < INT_MIN	)) {
-			throw "[MSNumpress::encodeLinear] Cannot encode a number that exceeds the bounds of [-INT_MAX, INT_MAX].";
-		}
-
-		diff = static_cast<int>(ints[2] - extrapol);
-		//printf("%lu %lu %lu,   extrapol: %ld    diff: %d \n", ints[0], ints[1], ints[2], extrapol, diff);
-		encodeInt(
-				static_cast<unsigned int>(diff), 
-				&halfBytes[halfByteCount], 
-				&halfByteCount
-			);
-		/*
-		printf("%d (%d):  ", diff, (int)halfByteCount);
-		for (size_t j=0; j<halfByteCount; j++) {
-			printf("%x ", halfBytes[j] & 0xf);
-		}
-		printf("\n");
-		*/
-		
-		
-		for (hbi=1; hbi < halfByteCount; hbi+=2) {
-			result[ri] = static_cast<unsigned char>(
-					(halfBytes[hbi-1] << 4) | (halfBytes[hbi] & 0xf)
-				);
-			//printf("%x \n", result[ri]);
-			ri++;
-		}
-		if (halfByteCount % 2 != 0) {
-			halfBytes[0] = halfBytes[halfByteCount-1];
-			halfByteCount = 1;
-		} else {
-			halfByteCount = 0;
-		}
+size_t encodedSizeLinear(
+		const double *data, 
+		size_t dataSize, 
+		double fixedPoint
+) {
+	long long ints[3];
+	size_t halfBytes = 0;
+
+	if (dataSize == 0) return 8;
+	if (dataSize == 1) return 12;
+
+	ints[1] = static_cast<long long>(data[0] * fixedPoint + 0.5);
+	ints[2] = static_cast<long long>(data[1] * fixedPoint + 0.5);
+
+	for (size_t i=2; i<dataSize; i++) {
+		halfBytes += 9 - leadingHalfBytes(static_cast<unsigned int>(linearResidual(data[i], fixedPoint, ints)));
 	}
-	if (halfByteCount == 1) {
-		result[ri] = static_cast<unsigned char>(halfBytes[0] << 4);
-		ri++;
+	return 16 + (halfBytes + 1) / 2;
+}
+
+
+
+/**
+ * Number of values encodeLinearAuto checks the fixed point for before 
+ * encoding them, small enough for them to still be in cache when encoded
+ */
+static const size_t SPECULATION_BLOCK = 1024;
+
+/**
+ * Encodes data with fixedPoint in one pass, checking each block against the
+ * residual bound maxDouble (see optimalLinearFixedPoint) before encoding it.
+ * A block violates the bound if the fixed point it allows differs from 
+ * fixedPoint (exact) or is smaller than fixedPoint (!exact).
+ *
+ * Returns 0 on the first violation, with maxDouble raised over all of data
+ * if exact. Throws as encodeLinear would with fixedPoint, unless a later
+ * block violates the bound.
+ */
+static size_t encodeLinearSpeculative(
+		const double *data,
+		size_t dataSize,
+		unsigned char *result,
+		double fixedPoint,
+		bool exact,
+		double *maxDouble
+) {
+	long long ints[3];
+	size_t i, end, ri;
+	HalfByteWriter writer;
+
+	encodeFixedPoint(fixedPoint, result);
+	ints[1] = static_cast<long long>(data[0] * fixedPoint + 0.5);
+	ints[2] = static_cast<long long>(data[1] * fixedPoint + 0.5);
+	for (i=0; i<4; i++) {
+		result[8+i] 	= (ints[1] >> (i*8)) & 0xff;
+		result[12+i] 	= (ints[2] >> (i*8)) & 0xff;
+	}
+	ri = 16;
+
+	for (i=2; i<dataSize; i=end) {
+		end = min(dataSize, i + SPECULATION_BLOCK);
+		*maxDouble = maxLinearResidual(data, i, end, *maxDouble);
+		double limit = floor(0x7FFFFFFFl / *maxDouble);
+
+		if (exact ? limit != fixedPoint : fixedPoint > limit) {
+			if (exact) {
+				*maxDouble = maxLinearResidual(data, end, dataSize, *maxDouble);
+			}
+			return 0;
+		}
+
+		try {
+			encodeLinearResiduals(data, i, end, dataSize, fixedPoint, ints, &writer, result, &ri);
+		} catch (const char *) {
+			double rest = maxLinearResidual(data, end, dataSize, *maxDouble);
+			limit = floor(0x7FFFFFFFl / rest);
+			if (exact ? limit != fixedPoint : fixedPoint > limit) {
+				*maxDouble = rest;
+				return 0;
+			}
+			throw;
+		}
+	}
+
+	writer.finish(result, &ri);
+	return ri;
+}
+
+
+
+size_t encodeLinearAuto(
+		const double *data,
+		size_t dataSize,
+		unsigned char *result,
+		double *fixedPoint
+) {
+	if (dataSize < 3) {
+		*fixedPoint = optimalLinearFixedPoint(data, dataSize);
+		return encodeLinear(data, dataSize, result, *fixedPoint);
+	}
+
+	// usually the first values, not the residuals, decide the fixed point
+	double maxDouble = max(data[0], data[1]);
+	*fixedPoint = floor(0x7FFFFFFFl / maxDouble);
+	size_t ri = encodeLinearSpeculative(data, dataSize, result, *fixedPoint, true, &maxDouble);
+	if (ri > 0) return ri;
+
+	*fixedPoint = floor(0x7FFFFFFFl / maxDouble);
+	return encodeLinear(data, dataSize, result, *fixedPoint);
+}
+
+
+
+size_t encodeLinearAutoMass(
+		const double *data,
+		size_t dataSize,
+		unsigned char *result,
+		double mass_acc,
+		double *fixedPoint
+) {
+	if (dataSize < 3) {
+		*fixedPoint = 0;
+		return encodeLinear(data, dataSize, result, *fixedPoint);
+	}
+
+	double maxDouble = max(data[0], data[1]);
+	*fixedPoint = 0.5 / mass_acc;
+	size_t ri = encodeLinearSpeculative(data, dataSize, result, *fixedPoint, false, &maxDouble);
+	if (ri == 0) {
+		*fixedPoint = -1;
 	}
 	return ri;
 }
 
 
 
+/**
+ * Reconstructs n values of decodeLinear from their prediction residuals.
+ * ints holds the last two fixed point values (ints[0] before ints[1]) and is
+ * updated to the last two reconstructed ones.
+ */
+static void linearValuesScalar(
+		const unsigned int *diffs,
+		size_t n,
+		long long *ints,
+		double fixedPoint,
+		double *result
+) {
+	long long extrapol, y;
+	long long prev = ints[0];
+	long long last = ints[1];
+
+	for (size_t i=0; i<n; i++) {
+		extrapol = last + (last - prev);
+		y = extrapol + static_cast<int>(diffs[i]);
+		result[i] = y / fixedPoint;
+		prev = last;
+		last = y;
+	}
+
+	ints[0] = prev;
+	ints[1] = last;
+}
+
+#if MSNUMPRESS_X86
+
+/**
+ * As linearValuesAVX2 below, two values at a time
+ */
+MSNUMPRESS_TARGET("sse4.2")
+static void linearValuesSSE42(
+		const unsigned int *diffs,
+		size_t n,
+		long long *ints,
+		double fixedPoint,
+		double *result
+) {
+	const __m128i magicBits 	= _mm_set1_epi64x(0x4338000000000000LL);
+	const __m128d magic 		= _mm_set1_pd(6755399441055744.0);
+	const __m128i upper 		= _mm_set1_epi64x((1LL << 51) - 1);
+	const __m128i lower 		= _mm_set1_epi64x(-(1LL << 51));
+	const __m128d fp 			= _mm_set1_pd(fixedPoint);
+
+	unsigned long long last = static_cast<unsigned long long>(ints[1]);
+	unsigned long long step = last - static_cast<unsigned long long>(ints[0]);
+	size_t i = 0;
+
+	for (; i+2 <= n; i+=2) {
+		__m128i d = _mm_cvtepi32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(diffs + i)));
+		__m128i s1 = _mm_add_epi64(d, _mm_slli_si128(d, 8));
+		__m128i s2 = _mm_add_epi64(s1, _mm_slli_si128(s1, 8));
+
+		unsigned long long step2 = step + step;
+		__m128i y = _mm_add_epi64(
+				_mm_set1_epi64x(static_cast<long long>(last)),
+				_mm_add_epi64(s2, _mm_set_epi64x(static_cast<long long>(step2), static_cast<long long>(step))));
+
+		__m128i outside = _mm_or_si128(_mm_cmpgt_epi64(y, upper), _mm_cmpgt_epi64(lower, y));
+		if (_mm_testz_si128(outside, outside)) {
+			__m128d yd = _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(y, magicBits)), magic);
+			_mm_storeu_pd(result + i, _mm_div_pd(yd, fp));
+		} else {
+			long long ys[2];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ys), y);
+			result[i] 	= ys[0] / fixedPoint;
+			result[i+1] = ys[1] / fixedPoint;
+		}
+
+		step += static_cast<unsigned long long>(_mm_extract_epi64(s1, 1));
+		last += step2 + static_cast<unsigned long long>(_mm_extract_epi64(s2, 1));
+	}
+
+	ints[0] = static_cast<long long>(last - step);
+	ints[1] = static_cast<long long>(last);
+	linearValuesScalar(diffs + i, n - i, ints, fixedPoint, result + i);
+}
+
+
+
+/**
+ * Inclusive prefix sum over the four 64 bit lanes of x
+ */
+MSNUMPRESS_TARGET("avx2")
+static inline __m256i prefixSum4(
+		__m256i x
+) {
+	const __m256i zero = _mm256_setzero_si256();
+	x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), zero, 0x03));
+	x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x40), zero, 0x0f));
+	return x;
+}
+
+
+
+/**
+ * As linearValuesScalar, but four values at a time: the residuals are summed
+ * twice (into the first differences, then into the values) with in-register
+ * prefix sums, and only the running value and difference are carried from
+ * one group of four to the next.
+ */
+MSNUMPRESS_TARGET("avx2")
+static void linearValuesAVX2(
+		const unsigned int *diffs,
+		size_t n,
+		long long *ints,
+		double fixedPoint,
+		double *result
+) {
+	// int64 -> double by adding the bits of 1.5 * 2^52, exact for |y| < 2^51
+	const __m256i magicBits 	= _mm256_set1_epi64x(0x4338000000000000LL);
+	const __m256d magic 		= _mm256_set1_pd(6755399441055744.0);
+	const __m256i upper 		= _mm256_set1_epi64x((1LL << 51) - 1);
+	const __m256i lower 		= _mm256_set1_epi64x(-(1LL << 51));
+	const __m256d fp 			= _mm256_set1_pd(fixedPoint);
+
+	// unsigned, as the scalar code relies on long long arithmetic wrapping
+	unsigned long long last = static_cast<unsigned long long>(ints[1]);
+	unsigned long long step = last - static_cast<unsigned long long>(ints[0]);
+	size_t i = 0;
+
+	for (; i+4 <= n; i+=4) {
+		__m256i d = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(diffs + i)));
+		__m256i s1 = prefixSum4(d);
+		__m256i s2 = prefixSum4(s1);
+
+		unsigned long long step2 = step + step;
+		__m256i y = _mm256_add_epi64(
+				_mm256_set1_epi64x(static_cast<long long>(last)),
+				_mm256_add_epi64(s2, _mm256_set_epi64x(
+						static_cast<long long>(step2 + step2), 
+						static_cast<long long>(step2 + step), 
+						static_cast<long long>(step2), 
+						static_cast<long long>(step))));
+
+		__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(y, upper), _mm256_cmpgt_epi64(lower, y));
+		if (_mm256_testz_si256(outside, outside)) {
+			__m256d yd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(y, magicBits)), magic);
+			_mm256_storeu_pd(result + i, _mm256_div_pd(yd, fp));
+		} else {
+			long long ys[4];
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(ys), y);
+			for (size_t j=0; j<4; j++) {
+				result[i+j] = ys[j] / fixedPoint;
+			}
+		}
+
+		step += static_cast<unsigned long long>(_mm256_extract_epi64(s1, 3));
+		last += step2 + step2 + static_cast<unsigned long long>(_mm256_extract_epi64(s2, 3));
+	}
+
+	ints[0] = static_cast<long long>(last - step);
+	ints[1] = static_cast<long long>(last);
+	linearValuesScalar(diffs + i, n - i, ints, fixedPoint, result + i);
+}
+
+
+
+/**
+ * Inclusive prefix sum over the eight 64 bit lanes of x
+ */
+MSNUMPRESS_TARGET("avx512f")
+static inline __m512i prefixSum8(
+		__m512i x
+) {
+	x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xfe, _mm512_setr_epi64(0, 0, 1, 2, 3, 4, 5, 6), x));
+	x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xfc, _mm512_setr_epi64(0, 0, 0, 1, 2, 3, 4, 5), x));
+	x = _mm512_add_epi64(x, _mm512_maskz_permutexvar_epi64(0xf0, _mm512_setr_epi64(0, 0, 0, 0, 0, 1, 2, 3), x));
+	return x;
+}
+
+
+
+/**
+ * As linearValuesAVX2, eight values at a time. AVX-512DQ converts int64 to
+ * double directly, rounding as the scalar conversion does, so no range 
+ * check is needed.
+ */
+MSNUMPRESS_TARGET("avx512f,avx512dq")
+static void linearValuesAVX512(
+		const unsigned int *diffs,
+		size_t n,
+		long long *ints,
+		double fixedPoint,
+		double *result
+) {
+	const __m512i multiples = _mm512_setr_epi64(1, 2, 3, 4, 5, 6, 7, 8);
+	const __m512d fp 		= _mm512_set1_pd(fixedPoint);
+
+	unsigned long long last = static_cast<unsigned long long>(ints[1]);
+	unsigned long long step = last - static_cast<unsigned long long>(ints[0]);
+	size_t i = 0;
+
+	for (; i+8 <= n; i+=8) {
+		__m512i d = _mm512_mask_cvtepi32_epi64(_mm512_setzero_si512(), 0xff, 
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(diffs + i)));
+		__m512i s1 = prefixSum8(d);
+		__m512i s2 = prefixSum8(s1);
+
+		__m512i y = _mm512_add_epi64(
+				_mm512_set1_epi64(static_cast<long long>(last)),
+				_mm512_add_epi64(s2, _mm512_mullo_epi64(_mm512_set1_epi64(static_cast<long long>(step)), multiples)));
+		_mm512_storeu_pd(result + i, _mm512_div_pd(_mm512_cvtepi64_pd(y), fp));
+
+		last += 8 * step + static_cast<unsigned long long>(_mm_extract_epi64(_mm512_extracti64x2_epi64(s2, 3), 1));
+		step += static_cast<unsigned long long>(_mm_extract_epi64(_mm512_extracti64x2_epi64(s1, 3), 1));
+	}
+
+	ints[0] = static_cast<long long>(last - step);
+	ints[1] = static_cast<long long>(last);
+	linearValuesScalar(diffs + i, n - i, ints, fixedPoint, result + i);
+}
+
+#endif
+
+
+
 size_t decodeLinear(
 		const unsigned char *data,
 		const size_t dataSize,
 		double *result
 ) {
-	size_t i;
+	size_t i, n;
 	size_t ri = 0;
-	unsigned int init, buff;
-	int diff;
+	unsigned int init;
+	unsigned int diffs[INT_BLOCK];
 	long long ints[3];
 	//double d;
 	size_t di;
 	size_t half;
-	long long extrapol;
-	long long y;
 	double fixedPoint;
 	
 	//printf("Decoding %d bytes with fixed point %f\n", (int)dataSize, fixedPoint);
 
-	if (dataSize == 8) return 0;
+	if (dataSize == 8) return 0;
+
+	if (dataSize < 8) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read fixed point! ";
+	
+	fixedPoint = decodeFixedPoint(data);
+
+	// a framed array starts with a tag that reads as a NaN fixed point
+	if (fixedPoint != fixedPoint) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: fixed point is NaN (framed or indexed data must be decoded with decodeLinearFramed or decodeLinearIndexed)! ";
+
+	if (dataSize < 12) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read first value! ";
+
+	ints[1] = 0;
+	for (i=0; i<4; i++) {
+		ints[1] = ints[1] | ((0xff & (init = data[8+i])) << (i*8));
+	}
+	result[0] = ints[1] / fixedPoint;
+
+	if (dataSize == 12) return 1;
+	if (dataSize < 16) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read second value! ";
+
+	ints[2] = 0;
+	for (i=0; i<4; i++) {
+		ints[2] = ints[2] | ((0xff & (init = data[12+i])) << (i*8));
+	}
+	result[1] = ints[2] / fixedPoint;
+		
+	half = 0;
+	ri = 2;
+	di = 16;
+	
+	// first unpack a block of residuals, then reconstruct the values from them
+	LinearValuesFn linearValues = kernels().linearValues;
+	ints[0] = ints[1];
+	ints[1] = ints[2];
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, diffs, INT_BLOCK);
+		linearValues(diffs, n, ints, fixedPoint, result + ri);
+		ri += n;
+	} while (n == INT_BLOCK);
+
+	return ri;
+}
+
+
+
+size_t decodedCountLinear(
+		const unsigned char *data,
+		const size_t dataSize
+) {
+	if (dataSize == 8) return 0;
+
+	if (dataSize < 8) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read fixed point! ";
+	if (decodeFixedPoint(data) != decodeFixedPoint(data)) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: fixed point is NaN (framed or indexed data must be decoded with decodeLinearFramed or decodeLinearIndexed)! ";
+	if (dataSize < 12) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read first value! ";
+
+	if (dataSize == 12) return 1;
+	if (dataSize < 16) 
+		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read second value! ";
+
+	return 2 + countInts(data, dataSize, 16, 0);
+}
+
+
+
+/**
+ * Returns the smallest y with y / fixedPoint >= lo, for fixedPoint > 0. The
+ * estimate is corrected with the same division the decoder does, so that 
+ * comparing y with it gives exactly the comparison of the decoded value.
+ */
+static long long lowerThreshold(
+		double lo,
+		double fixedPoint
+) {
+	double t = ceil(lo * fixedPoint);
+	if (!(t > -9.2e18)) return LLONG_MIN;
+	if (t > 9.2e18) return LLONG_MAX;
+
+	long long y = static_cast<long long>(t);
+	while (y > LLONG_MIN && (y - 1) / fixedPoint >= lo) y--;
+	while (y < LLONG_MAX && y / fixedPoint < lo) y++;
+	return y;
+}
+
+
+
+/**
+ * Returns the largest y with y / fixedPoint <= hi, for fixedPoint > 0
+ */
+static long long upperThreshold(
+		double hi,
+		double fixedPoint
+) {
+	double t = floor(hi * fixedPoint);
+	if (!(t < 9.2e18)) return LLONG_MAX;
+	if (t < -9.2e18) return LLONG_MIN;
+
+	long long y = static_cast<long long>(t);
+	while (y < LLONG_MAX && (y + 1) / fixedPoint <= hi) y++;
+	while (y > LLONG_MIN && y / fixedPoint > hi) y--;
+	return y;
+}
+
+
+
+IndexRange decodeLinearRange(
+		const unsigned char *data,
+		const size_t dataSize,
+		double lo,
+		double hi,
+		double *result
+) {
+	IndexRange range = { 0, 0 };
+	size_t count = decodedCountLinear(data, min(dataSize, static_cast<size_t>(16)));
+	if (count == 0) return range;
+
+	double fixedPoint = decodeFixedPoint(data);
+	if (!(fixedPoint > 0)) {
+		// thresholds need an increasing value: decode all, keep the range
+		size_t n = decodeLinear(data, dataSize, result);
+		while (range.begin < n && !(result[range.begin] >= lo) && !(result[range.begin] > hi)) range.begin++;
+		range.end = range.begin;
+		while (range.end < n && !(result[range.end] > hi)) range.end++;
+		memmove(result, result + range.begin, (range.end - range.begin) * sizeof(double));
+		return range;
+	}
+
+	// the values are compared as the ints they are decoded from
+	long long yLo = lowerThreshold(lo, fixedPoint);
+	long long yHi = upperThreshold(hi, fixedPoint);
+
+	long long ints[2] = { 0, 0 };
+	for (size_t i=0; i<count; i++) {
+		for (size_t j=0; j<4; j++) {
+			ints[i] |= static_cast<long long>(data[8 + 4*i + j]) << (j*8);
+		}
+	}
+
+	unsigned int diffs[INT_BLOCK];
+	size_t di = 16;
+	size_t half = 0;
+	size_t i = 0;
+	size_t n = 0;
+	size_t index = 0;
+	size_t ri = 0;
+	bool started = false;
+	long long prev = 0;
+	long long last = 0;
+
+	for (;; index++) {
+		long long y;
+		if (index < count) {
+			y = ints[index];
+		} else {
+			if (count < 2) break;
+			if (i == n) {
+				n = decodeIntBlock(data, dataSize, &di, &half, diffs, INT_BLOCK);
+				i = 0;
+				if (n == 0) break;
+			}
+			y = last + (last - prev) + static_cast<int>(diffs[i++]);
+		}
+		prev = last;
+		last = y;
+
+		if (y > yHi) break;
+		if (!started) {
+			if (y < yLo) continue;
+			started = true;
+			range.begin = index;
+		}
+		result[ri++] = y / fixedPoint;
+	}
+
+	if (!started) range.begin = index;
+	range.end = range.begin + ri;
+	return range;
+}
+
+
+
+void encodeLinear(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double fixedPoint
+) {
+	size_t dataSize = data.size();
+	result.resize(dataSize * 5 + 8);
+	size_t encodedLength = encodeLinear(&data[0], dataSize, &result[0], fixedPoint);
+	result.resize(encodedLength);
+}
+
+
+
+double encodeLinearAuto(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result
+) {
+	double fixedPoint;
+	size_t dataSize = data.size();
+	result.resize(dataSize * 5 + 8);
+	size_t encodedLength = encodeLinearAuto(&data[0], dataSize, &result[0], &fixedPoint);
+	result.resize(encodedLength);
+	return fixedPoint;
+}
+
+
+
+double encodeLinearAutoMass(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double mass_acc
+) {
+	double fixedPoint;
+	size_t dataSize = data.size();
+	result.resize(dataSize * 5 + 8);
+	size_t encodedLength = encodeLinearAutoMass(&data[0], dataSize, &result[0], mass_acc, &fixedPoint);
+	result.resize(encodedLength);
+	return fixedPoint;
+}
+
+
+
+void decodeLinear(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result
+) {
+	size_t dataSize = data.size();
+	result.resize(decodedCountLinear(&data[0], dataSize));
+	if (!result.empty()) {
+		decodeLinear(&data[0], dataSize, &result[0]);
+	}
+}
+
+/////////////////////////////////////////////////////////////
+
+
+/**
+ * Writes the residuals of encodeSafe for data[i], i in [2, n), to 
+ * result[8*i ..]
+ */
+static void safeResidualsScalar(
+		const double *data,
+		size_t n,
+		unsigned char *result
+) {
+	double extrapol, diff;
+
+	for (size_t i=2; i<n; i++) {
+		extrapol = data[i-1] + (data[i-1] - data[i-2]);
+		diff = data[i] - extrapol;
+		storeDouble(diff, result + 8*i);
+	}
+}
+
+
+
+/**
+ * Reconstructs n values of decodeSafe from the residuals in data. latest
+ * holds the previous two values and is updated.
+ */
+static void safeValuesScalar(
+		const unsigned char *data,
+		size_t n,
+		double *latest,
+		double *result
+) {
+	double extrapol;
+
+	for (size_t i=0; i<n; i++) {
+		extrapol = latest[1] + (latest[1] - latest[0]);
+		latest[0] = latest[1];
+		latest[1] = extrapol + loadDouble(data + 8*i);
+		result[i] = latest[1];
+	}
+}
+
+#if MSNUMPRESS_X86 && MSNUMPRESS_LITTLE_ENDIAN
+
+MSNUMPRESS_TARGET("ssse3")
+static inline __m128i byteSwapSSSE3(
+		__m128i x
+) {
+	const __m128i reverse = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	return _mm_shuffle_epi8(x, reverse);
+}
+
+
+
+/**
+ * As safeResidualsAVX2, two residuals at a time
+ */
+MSNUMPRESS_TARGET("ssse3")
+static void safeResidualsSSSE3(
+		const double *data,
+		size_t n,
+		unsigned char *result
+) {
+	size_t i = 2;
+	for (; i+2 <= n; i+=2) {
+		__m128d d0 = _mm_loadu_pd(data + i - 2);
+		__m128d d1 = _mm_loadu_pd(data + i - 1);
+		__m128d d2 = _mm_loadu_pd(data + i);
+		__m128d diff = _mm_sub_pd(d2, _mm_add_pd(d1, _mm_sub_pd(d1, d0)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(result + 8*i), byteSwapSSSE3(_mm_castpd_si128(diff)));
+	}
+	for (; i<n; i++) {
+		storeDouble(data[i] - (data[i-1] + (data[i-1] - data[i-2])), result + 8*i);
+	}
+}
+
+
+
+/**
+ * As safeValuesAVX2, swapping two residuals at a time
+ */
+MSNUMPRESS_TARGET("ssse3")
+static void safeValuesSSSE3(
+		const unsigned char *data,
+		size_t n,
+		double *latest,
+		double *result
+) {
+	const size_t SAFE_BLOCK = 512;
+	double prev = latest[0];
+	double last = latest[1];
+
+	for (size_t start=0; start<n; start+=SAFE_BLOCK) {
+		size_t end = min(n, start + SAFE_BLOCK);
+		size_t i = start;
+
+		for (; i+2 <= end; i+=2) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 8*i));
+			_mm_storeu_pd(result + i, _mm_castsi128_pd(byteSwapSSSE3(x)));
+		}
+		for (; i<end; i++) {
+			result[i] = loadDouble(data + 8*i);
+		}
+
+		for (i=start; i<end; i++) {
+			double extrapol = last + (last - prev);
+			prev = last;
+			last = extrapol + result[i];
+			result[i] = last;
+		}
+	}
+
+	latest[0] = prev;
+	latest[1] = last;
+}
+
+
+
+MSNUMPRESS_TARGET("avx2")
+static inline __m256i byteSwapAVX2(
+		__m256i x
+) {
+	const __m256i reverse = _mm256_setr_epi8(
+			7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+			7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	return _mm256_shuffle_epi8(x, reverse);
+}
+
+
+
+/**
+ * As safeResidualsScalar, four residuals at a time from three overlapping 
+ * loads. The arithmetic is exactly that of the scalar code.
+ */
+MSNUMPRESS_TARGET("avx2")
+static void safeResidualsAVX2(
+		const double *data,
+		size_t n,
+		unsigned char *result
+) {
+	size_t i = 2;
+	for (; i+4 <= n; i+=4) {
+		__m256d d0 = _mm256_loadu_pd(data + i - 2);
+		__m256d d1 = _mm256_loadu_pd(data + i - 1);
+		__m256d d2 = _mm256_loadu_pd(data + i);
+		__m256d diff = _mm256_sub_pd(d2, _mm256_add_pd(d1, _mm256_sub_pd(d1, d0)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(result + 8*i), byteSwapAVX2(_mm256_castpd_si256(diff)));
+	}
+	for (; i<n; i++) {
+		storeDouble(data[i] - (data[i-1] + (data[i-1] - data[i-2])), result + 8*i);
+	}
+}
+
+
+
+/**
+ * As safeValuesScalar. Each value depends on the rounding of the previous 
+ * ones, so only the byte swapping is vectorized: a block of residuals is 
+ * swapped into result first, and the values are then rebuilt in place.
+ */
+MSNUMPRESS_TARGET("avx2")
+static void safeValuesAVX2(
+		const unsigned char *data,
+		size_t n,
+		double *latest,
+		double *result
+) {
+	const size_t SAFE_BLOCK = 512;
+	double prev = latest[0];
+	double last = latest[1];
+
+	for (size_t start=0; start<n; start+=SAFE_BLOCK) {
+		size_t end = min(n, start + SAFE_BLOCK);
+		size_t i = start;
+
+		for (; i+4 <= end; i+=4) {
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 8*i));
+			_mm256_storeu_pd(result + i, _mm256_castsi256_pd(byteSwapAVX2(x)));
+		}
+		for (; i<end; i++) {
+			result[i] = loadDouble(data + 8*i);
+		}
+
+		for (i=start; i<end; i++) {
+			double extrapol = last + (last - prev);
+			prev = last;
+			last = extrapol + result[i];
+			result[i] = last;
+		}
+	}
+
+	latest[0] = prev;
+	latest[1] = last;
+}
+
+
+
+MSNUMPRESS_TARGET("avx512f,avx512bw")
+static inline __m512i byteSwapAVX512(
+		__m512i x
+) {
+	const __m512i reverse = _mm512_mask_broadcast_i32x4(_mm512_setzero_si512(), 0xffff,
+			_mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+	return _mm512_shuffle_epi8(x, reverse);
+}
+
+
+
+/**
+ * As safeResidualsAVX2, eight residuals at a time
+ */
+MSNUMPRESS_TARGET("avx512f,avx512bw")
+static void safeResidualsAVX512(
+		const double *data,
+		size_t n,
+		unsigned char *result
+) {
+	size_t i = 2;
+	for (; i+8 <= n; i+=8) {
+		__m512d d0 = _mm512_loadu_pd(data + i - 2);
+		__m512d d1 = _mm512_loadu_pd(data + i - 1);
+		__m512d d2 = _mm512_loadu_pd(data + i);
+		__m512d diff = _mm512_sub_pd(d2, _mm512_add_pd(d1, _mm512_sub_pd(d1, d0)));
+		_mm512_storeu_si512(result + 8*i, byteSwapAVX512(_mm512_castpd_si512(diff)));
+	}
+	for (; i<n; i++) {
+		storeDouble(data[i] - (data[i-1] + (data[i-1] - data[i-2])), result + 8*i);
+	}
+}
+
+
+
+/**
+ * As safeValuesAVX2, swapping eight residuals at a time
+ */
+MSNUMPRESS_TARGET("avx512f,avx512bw")
+static void safeValuesAVX512(
+		const unsigned char *data,
+		size_t n,
+		double *latest,
+		double *result
+) {
+	const size_t SAFE_BLOCK = 512;
+	double prev = latest[0];
+	double last = latest[1];
+
+	for (size_t start=0; start<n; start+=SAFE_BLOCK) {
+		size_t end = min(n, start + SAFE_BLOCK);
+		size_t i = start;
+
+		for (; i+8 <= end; i+=8) {
+			__m512i x = _mm512_loadu_si512(data + 8*i);
+			_mm512_storeu_pd(result + i, _mm512_castsi512_pd(byteSwapAVX512(x)));
+		}
+		for (; i<end; i++) {
+			result[i] = loadDouble(data + 8*i);
+		}
+
+		for (i=start; i<end; i++) {
+			double extrapol = last + (last - prev);
+			prev = last;
+			last = extrapol + result[i];
+			result[i] = last;
+		}
+	}
+
+	latest[0] = prev;
+	latest[1] = last;
+}
+
+#endif
+
+
+
+size_t encodeSafe(
+		const double *data, 
+		const size_t dataSize, 
+		unsigned char *result
+) {
+	//printf("d0 d1 d2 extrapol diff\n");
+		
+	if (dataSize == 0) return 0;
+
+	storeDouble(data[0], result);
+	
+	if (dataSize == 1) return 8;
+
+	storeDouble(data[1], result + 8);
+
+	kernels().safeResiduals(data, dataSize, result);
+	
+	return dataSize * 8;
+}
+
+
+
+size_t decodeSafe(
+		const unsigned char *data,
+		const size_t dataSize,
+		double *result
+) {
+	double latest[2];
+	
+	if (dataSize % 8 != 0) 
+		throw "[MSNumpress::decodeSafe] Corrupt input data: number of bytes needs to be multiple of 8! ";
+	
+	if (dataSize == 0) return 0;
+
+	//printf("d0 d1 extrapol diff\td2\n");
+	
+	latest[1] = loadDouble(data);
+	result[0] = latest[1];
+
+	if (dataSize == 8) return 1;
+
+	latest[0] = latest[1];
+	latest[1] = loadDouble(data + 8);
+	result[1] = latest[1];
+	
+	kernels().safeValues(data + 16, dataSize / 8 - 2, latest, result + 2);
+	
+	return dataSize / 8;
+}
+
+/////////////////////////////////////////////////////////////
+
+
+/**
+ * Rounds an ion count to the int stored by encodePic.
+ */
+static inline unsigned int picInt(
+		double d
+) {
+	if (THROW_ON_OVERFLOW && 
+			(d + 0.5 > INT_MAX || d < -0.5)		){
+		throw "[MSNumpress::encodePic] Cannot use Pic to encode a number larger than INT_MAX or smaller than 0.";
+	}
+	return static_cast<unsigned int>(d + 0.5);
+}
+
+
+
+size_t encodePic(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result
+) {
+	size_t i, ri;
+	HalfByteWriter writer;
+
+	//printf("Encoding %d doubles\n", (int)dataSize);
+
+	ri = 0;
+
+	for (i=0; i + FLUSH_WORD_MARGIN < dataSize; i++) {
+		writer.put(picInt(data[i]));
+		writer.flushWord(result, &ri);
+	}
+	for (; i<dataSize; i++) {
+		writer.put(picInt(data[i]));
+		writer.flushBytes(result, &ri);
+	}
+	writer.finish(result, &ri);
+	return ri;
+}
+
+
+
+size_t encodedSizePic(
+		const double *data, 
+		size_t dataSize
+) {
+	size_t halfBytes = 0;
+	for (size_t i=0; i<dataSize; i++) {
+		halfBytes += 9 - leadingHalfBytes(picInt(data[i]));
+	}
+	return (halfBytes + 1) / 2;
+}
+
+
+
+size_t decodePic(
+		const unsigned char *data,
+		const size_t dataSize,
+		double *result
+) {
+	size_t i, n, ri;
+	unsigned int ints[INT_BLOCK];
+	size_t di;
+	size_t half;
+
+	// a framed array starts with a tag that cannot start a Pic array
+	if (isFramed(data, dataSize)) 
+		throw "[MSNumpress::decodePic] Corrupt input data: starts with a frame tag (framed data must be decoded with decodePicFramed)! ";
+
+	half = 0;
+	ri = 0;
+	di = 0;
+	
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, ints, INT_BLOCK);
+		for (i=0; i<n; i++) {
+			result[ri++] = static_cast<double>(ints[i]);
+		}
+	} while (n == INT_BLOCK);
+
+	return ri;
+}
+
+
+
+size_t decodedCountPic(
+		const unsigned char *data,
+		const size_t dataSize
+) {
+	if (isFramed(data, dataSize)) 
+		throw "[MSNumpress::decodePic] Corrupt input data: starts with a frame tag (framed data must be decoded with decodePicFramed)! ";
+	return countInts(data, dataSize, 0, 0);
+}
+
+
+
+/**
+ * Decodes up to count values of the encodePic array in data, starting with
+ * the int at the position given by di and half (see decodeInt).
+ *
+ * @return the number of decoded values, which is smaller than count only 
+ * when the end of the data has been reached.
+ */
+static size_t decodePicFrom(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t di,
+		size_t half,
+		size_t count,
+		double *result
+) {
+	size_t i, n;
+	size_t ri = 0;
+	unsigned int ints[INT_BLOCK];
+
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, ints, min(INT_BLOCK, count - ri));
+		for (i=0; i<n; i++) {
+			result[ri++] = static_cast<double>(ints[i]);
+		}
+	} while (n == INT_BLOCK && ri < count);
+
+	return ri;
+}
+
+
+
+size_t decodePicSlice(
+		const unsigned char *data,
+		const size_t dataSize,
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	size_t di = 0;
+	size_t half = 0;
+
+	if (end <= begin) return 0;
+	if (skipInts(data, dataSize, &di, &half, begin) < begin) return 0;
+
+	return decodePicFrom(data, dataSize, di, half, end - begin, result);
+}
+
+
+
+void encodePic(
+		const std::vector<double> &data,  
+		std::vector<unsigned char> &result
+) {
+	size_t dataSize = data.size();
+	result.resize(dataSize * 5);
+	size_t encodedLength = encodePic(&data[0], dataSize, &result[0]);
+	result.resize(encodedLength);
+}
+
+
+
+void decodePic(
+		const std::vector<unsigned char> &data,  
+		std::vector<double> &result
+) {
+	size_t dataSize = data.size();
+	result.resize(decodedCountPic(&data[0], dataSize));
+	if (!result.empty()) {
+		decodePic(&data[0], dataSize, &result[0]);
+	}
+}
+
+/////////////////////////////////////////////////////////////
+
+// the first bytes of a framed array, which read as a NaN Linear fixed point 
+// and cannot start a Pic array, followed by the format, the version and 2
+// reserved bytes
+static const unsigned char FRAME_MAGIC[4] = { 0xff, 0xf8, 'N', 'P' };
+static const unsigned char FRAME_VERSION = 1;
+
+enum FrameFormat {
+	FRAME_LINEAR 			= 1,
+	FRAME_PIC 				= 2,
+	FRAME_LINEAR_INDEXED 	= 3,
+	FRAME_LINEAR_SEEK 		= 4,
+	FRAME_PIC_SEEK 			= 5,
+	FRAME_PIC_SV 			= 6,
+	FRAME_PIC_FOR 			= 7,
+	FRAME_PIC_ZR 			= 8,
+	FRAME_LINEAR_RL 		= 9,
+	FRAME_LINEAR_LOG 		= 10
+};
+
+// tag, block size, block count and value count
+static const size_t FRAME_HEADER_SIZE = 24;
+
+/**
+ * Writes the 8 byte tag of a framed array of the given format to result
+ */
+static void encodeFrameTag(
+		unsigned char format,
+		unsigned char *result
+) {
+	memcpy(result, FRAME_MAGIC, 4);
+	result[4] = format;
+	result[5] = FRAME_VERSION;
+	result[6] = 0;
+	result[7] = 0;
+}
+
+
+
+/**
+ * Returns the format of the framed array in data, or 0 if it is not one.
+ * Throws if it is one of an unknown version.
+ */
+static unsigned char decodeFrameTag(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	if (dataSize < 8 || memcmp(data, FRAME_MAGIC, 4) != 0) return 0;
+
+	if (data[5] != FRAME_VERSION) 
+		throw "[MSNumpress::decodeFramed] Unsupported framed format version! ";
+	return data[4];
+}
+
+
+
+/**
+ * The range of indices [begin, end) a thread of parallelFor has left to do,
+ * packed into one word (begin in the low 32 bits) so that the owner can take
+ * from the front and other threads steal from the back with a single CAS.
+ */
+struct alignas(64) WorkRange {
+	std::atomic<unsigned long long> range;
+
+	static unsigned long long pack(size_t begin, size_t end) {
+		return begin | (static_cast<unsigned long long>(end) << 32);
+	}
+
+	// takes the first index, returns false if there is none
+	bool pop(size_t *i) {
+		unsigned long long r = range.load();
+		while ((r & 0xffffffff) < (r >> 32)) {
+			if (range.compare_exchange_weak(r, r + 1)) {
+				*i = static_cast<size_t>(r & 0xffffffff);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// takes the back half (at least one index), returns false if there is none
+	bool steal(size_t *begin, size_t *end) {
+		unsigned long long r = range.load();
+		for (;;) {
+			size_t b = static_cast<size_t>(r & 0xffffffff);
+			size_t e = static_cast<size_t>(r >> 32);
+			if (b >= e) return false;
+
+			size_t mid = b + (e - b) / 2;
+			if (range.compare_exchange_weak(r, pack(b, mid))) {
+				*begin 	= mid;
+				*end 	= e;
+				return true;
+			}
+		}
+	}
+};
+
+
+
+/**
+ * Threads kept for parallelFor from one call to the next, so that calls on
+ * small batches do not pay for starting threads. They are started when first
+ * needed, up to one less than the most threads a call has asked for, and run
+ * tasks in the order they were added.
+ *
+ * The pool is never destroyed, so that its threads need not be joined at
+ * exit, where they may be waiting for a task.
+ */
+class ThreadPool {
+public:
+	static ThreadPool &instance() {
+		static ThreadPool *pool = new ThreadPool();
+		return *pool;
+	}
+
+	/**
+	 * Adds the task, after starting threads until there are at least 
+	 * threads of them. Throws if a thread cannot be started.
+	 */
+	void run(std::function<void()> task, size_t threads) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		while (workers_.size() < threads) {
+			workers_.push_back(std::thread(&ThreadPool::loop, this));
+		}
+		tasks_.push_back(task);
+		added_.notify_one();
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable added_;
+	std::deque<std::function<void()> > tasks_;
+	std::vector<std::thread> workers_;
+
+	void loop() {
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				added_.wait(lock, [this] { return !tasks_.empty(); });
+				task = tasks_.front();
+				tasks_.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+
+
+/**
+ * Calls fn(i) for every i in [0, n) on up to threads threads (0 for one per 
+ * core), and rethrows the first exception thrown by any of the calls.
+ *
+ * Every thread starts on an equal share of the indices, and when done steals
+ * half of what another thread has left, so that uneven costs (spectra of 
+ * very different sizes) are balanced without a shared counter. The calling
+ * thread is one of them, the others are helpers run by the ThreadPool. A 
+ * helper that has not started by the time the calling thread runs out of
+ * work is skipped, its share having been stolen, so that parallelFor may be
+ * called from within a task without waiting on the pool.
+ */
+template <typename Fn>
+static void parallelFor(
+		size_t n,
+		size_t threads,
+		Fn fn
+) {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+	threads = max(static_cast<size_t>(1), min(threads, n));
+
+	if (threads == 1) {
+		for (size_t i=0; i<n; i++) {
+			fn(i);
+		}
+		return;
+	}
+	if (n > 0xffffffff) 
+		throw "[MSNumpress::parallelFor] Too many tasks.";
+
+	std::vector<WorkRange> ranges(threads);
+	for (size_t t=0; t<threads; t++) {
+		ranges[t].range = WorkRange::pack(n * t / threads, n * (t + 1) / threads);
+	}
+
+	// the first exception of any type is rethrown once all threads are joined
+	std::atomic<bool> failed(false);
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto work = [&](size_t self) {
+		size_t i, begin, end;
+		for (;;) {
+			while (!failed && ranges[self].pop(&i)) {
+				try {
+					fn(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (!error) error = std::current_exception();
+					failed = true;
+				}
+			}
+			if (failed) return;
+
+			bool stolen = false;
+			for (size_t v=1; v<threads && !stolen; v++) {
+				stolen = ranges[(self + v) % threads].steal(&begin, &end);
+			}
+			if (!stolen) return;
+			ranges[self].range = WorkRange::pack(begin, end);
+		}
+	};
+
+	// helpers only touch the state of this call once they are counted as
+	// running, which they can no longer be after it has been closed
+	struct Helpers {
+		std::mutex mutex;
+		std::condition_variable done;
+		size_t running;
+		bool closed;
+	};
+	std::shared_ptr<Helpers> helpers = std::make_shared<Helpers>();
+	helpers->running = 0;
+	helpers->closed = false;
+
+	try {
+		for (size_t t=1; t<threads; t++) {
+			ThreadPool::instance().run([helpers, &work, t]() {
+				{
+					std::lock_guard<std::mutex> lock(helpers->mutex);
+					if (helpers->closed) return;
+					helpers->running++;
+				}
+				work(t);
+				std::lock_guard<std::mutex> lock(helpers->mutex);
+				helpers->running--;
+				helpers->done.notify_all();
+			}, threads - 1);
+		}
+	} catch (...) {
+		// with fewer threads than asked for, the others steal the shares
+	}
+	work(0);
+
+	{
+		std::unique_lock<std::mutex> lock(helpers->mutex);
+		helpers->closed = true;
+		helpers->done.wait(lock, [&] { return helpers->running == 0; });
+	}
+
+	if (error) std::rethrow_exception(error);
+}
+
+
+
+/**
+ * Encodes data in blocks of blockSize values with encodeBlock, each 
+ * independent of the others, behind a header and a table of block offsets:
+ *
+ *   tag (8) | block size (4) | block count (4) | value count (8) |
+ *   block offsets (8 each, block count + 1 of them) | blocks
+ *
+ * All numbers are little-endian, and the offsets count from the start of 
+ * the tag, the last one being the size of the frame.
+ */
+template <typename EncodeBlock>
+static size_t encodeFramed(
+		const double *data,
+		size_t dataSize,
+		unsigned char *result,
+		size_t blockSize,
+		unsigned char format,
+		EncodeBlock encodeBlock
+) {
+	if (blockSize == 0 || blockSize > 0xffffffff) 
+		throw "[MSNumpress::encodeFramed] Block size must be between 1 and 2^32 - 1.";
+
+	size_t blockCount = (dataSize + blockSize - 1) / blockSize;
+	if (blockCount > 0xffffffff) 
+		throw "[MSNumpress::encodeFramed] Too many blocks.";
+
+	encodeFrameTag(format, result);
+	storeLittleEndian(blockSize | (static_cast<unsigned long long>(blockCount) << 32), result + 8);
+	storeLittleEndian(dataSize, result + 16);
+
+	unsigned char *offsets = result + FRAME_HEADER_SIZE;
+	size_t ri = FRAME_HEADER_SIZE + 8 * (blockCount + 1);
+	for (size_t b=0; b<blockCount; b++) {
+		size_t begin = b * blockSize;
+		storeLittleEndian(ri, offsets + 8*b);
+		ri += encodeBlock(data + begin, min(blockSize, dataSize - begin), result + ri);
+	}
+	storeLittleEndian(ri, offsets + 8*blockCount);
+	return ri;
+}
+
+
+
+/**
+ * Decodes a framed array of the given format with decodeBlock and 
+ * countBlock, the blocks spread over up to threads threads.
+ */
+template <typename DecodeBlock, typename CountBlock>
+static size_t decodeFramed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads,
+		unsigned char format,
+		DecodeBlock decodeBlock,
+		CountBlock countBlock
+) {
+	size_t valueCount = decodedCountFramed(data, dataSize);
+	if (decodeFrameTag(data, dataSize) != format) 
+		throw "[MSNumpress::decodeFramed] Framed data is of another format! ";
+
+	size_t blockSize 	= static_cast<unsigned int>(loadLittleEndian(data + 8));
+	size_t blockCount 	= (valueCount + blockSize - 1) / blockSize;
+	const unsigned char *offsets = data + FRAME_HEADER_SIZE;
+
+	parallelFor(blockCount, threads, [&](size_t b) {
+		size_t begin 	= static_cast<size_t>(loadLittleEndian(offsets + 8*b));
+		size_t end 		= static_cast<size_t>(loadLittleEndian(offsets + 8*b + 8));
+		size_t count 	= min(blockSize, valueCount - b * blockSize);
+
+		// checked first, so that corrupt blocks cannot write past their part
+		if (countBlock(data + begin, end - begin) != count) 
+			throw "[MSNumpress::decodeFramed] Corrupt input data: wrong number of values in block! ";
+		decodeBlock(data + begin, end - begin, result + b * blockSize);
+	});
+
+	return valueCount;
+}
+
+
+
+size_t decodedCountFramed(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	unsigned char format = decodeFrameTag(data, dataSize);
+	if (format != FRAME_LINEAR && format != FRAME_PIC) 
+		throw "[MSNumpress::decodeFramed] Corrupt input data: not a framed array! ";
+	if (dataSize < FRAME_HEADER_SIZE) 
+		throw "[MSNumpress::decodeFramed] Corrupt input data: not enough bytes to read header! ";
+
+	unsigned long long sizes = loadLittleEndian(data + 8);
+	size_t blockSize 	= static_cast<unsigned int>(sizes);
+	size_t blockCount 	= static_cast<unsigned int>(sizes >> 32);
+	unsigned long long valueCount = loadLittleEndian(data + 16);
+
+	if (blockSize == 0 || valueCount > (static_cast<unsigned long long>(blockSize) << 32) ||
+			blockCount != (valueCount + blockSize - 1) / blockSize) 
+		throw "[MSNumpress::decodeFramed] Corrupt input data: inconsistent block and value counts! ";
+	if ((dataSize - FRAME_HEADER_SIZE) / 8 < blockCount + 1) 
+		throw "[MSNumpress::decodeFramed] Corrupt input data: not enough bytes to read block offsets! ";
+
+	// Linear and Pic take at least a halfbyte per value, which bounds the 
+	// value count by the data before the vector overloads allocate for it
+	const unsigned char *offsets = data + FRAME_HEADER_SIZE;
+	unsigned long long previous = FRAME_HEADER_SIZE + 8 * (blockCount + 1);
+	for (size_t b=0; b<=blockCount; b++) {
+		unsigned long long offset = loadLittleEndian(offsets + 8*b);
+		if (offset < previous || offset > dataSize || (b == 0 && offset != previous)) 
+			throw "[MSNumpress::decodeFramed] Corrupt input data: block offsets out of order or bounds! ";
+		if (b > 0 && min(static_cast<unsigned long long>(blockSize), valueCount - (b - 1) * blockSize) > 2 * (offset - previous)) 
+			throw "[MSNumpress::decodeFramed] Corrupt input data: more values than a block has bytes for! ";
+		previous = offset;
+	}
+	if (previous != dataSize) 
+		throw "[MSNumpress::decodeFramed] Corrupt input data: blocks do not end with the data! ";
+
+	return static_cast<size_t>(valueCount);
+}
+
+
+
+bool isFramed(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	return dataSize >= 8 && memcmp(data, FRAME_MAGIC, 4) == 0;
+}
+
+
+
+size_t encodeLinearFramed(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint,
+		size_t blockSize
+) {
+	return encodeFramed(data, dataSize, result, blockSize, FRAME_LINEAR, 
+		[fixedPoint](const double *block, size_t n, unsigned char *out) {
+			return encodeLinear(block, n, out, fixedPoint);
+		});
+}
+
+
+
+size_t decodeLinearFramed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads
+) {
+	return decodeFramed(data, dataSize, result, threads, FRAME_LINEAR,
+		[](const unsigned char *block, size_t n, double *out) {
+			return decodeLinear(block, n, out);
+		},
+		[](const unsigned char *block, size_t n) {
+			return decodedCountLinear(block, n);
+		});
+}
+
+
+
+size_t encodePicFramed(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		size_t blockSize
+) {
+	return encodeFramed(data, dataSize, result, blockSize, FRAME_PIC, 
+		[](const double *block, size_t n, unsigned char *out) {
+			return encodePic(block, n, out);
+		});
+}
+
+
+
+size_t decodePicFramed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads
+) {
+	return decodeFramed(data, dataSize, result, threads, FRAME_PIC,
+		[](const unsigned char *block, size_t n, double *out) {
+			return decodePic(block, n, out);
+		},
+		[](const unsigned char *block, size_t n) {
+			return decodedCountPic(block, n);
+		});
+}
+
+
+
+void encodeLinearFramed(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		size_t blockSize
+) {
+	size_t dataSize = data.size();
+	result.resize(maxFramedSize(dataSize, blockSize));
+	size_t encodedLength = encodeLinearFramed(&data[0], dataSize, &result[0], fixedPoint, blockSize);
+	result.resize(encodedLength);
+}
+
+
+
+void decodeLinearFramed(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result,
+		size_t threads
+) {
+	size_t dataSize = data.size();
+	result.resize(decodedCountFramed(&data[0], dataSize));
+	decodeLinearFramed(&data[0], dataSize, result.empty() ? NULL : &result[0], threads);
+}
+
+
+
+void encodePicFramed(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		size_t blockSize
+) {
+	size_t dataSize = data.size();
+	result.resize(maxFramedSize(dataSize, blockSize));
+	size_t encodedLength = encodePicFramed(&data[0], dataSize, &result[0], blockSize);
+	result.resize(encodedLength);
+}
+
+
+
+void decodePicFramed(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result,
+		size_t threads
+) {
+	size_t dataSize = data.size();
+	result.resize(decodedCountFramed(&data[0], dataSize));
+	decodePicFramed(&data[0], dataSize, result.empty() ? NULL : &result[0], threads);
+}
+
+
+
+size_t maxFramedSize(
+		size_t dataSize,
+		size_t blockSize
+) {
+	size_t blockCount = (blockSize == 0) ? 0 : (dataSize + blockSize - 1) / blockSize;
+	return FRAME_HEADER_SIZE + 8 + 16 * blockCount + 5 * dataSize;
+}
+
+/////////////////////////////////////////////////////////////
+
+/**
+ * Returns the i-th (0 or 1) of the ints stored in the header of an 
+ * encodeLinear array, as decodeLinear reads it.
+ */
+static long long linearHeaderInt(
+		const unsigned char *data,
+		size_t i
+) {
+	long long x = 0;
+	for (size_t j=0; j<4; j++) {
+		x |= static_cast<long long>(data[8 + 4*i + j]) << (j*8);
+	}
+	return x;
+}
+
+
+
+/**
+ * Walks the residuals of the encodeLinear array in data, reconstructing the
+ * ints but not the doubles, and calls checkpoint(index, di, half, ints) with 
+ * the position (see decodeInt) of the residual of value index and the ints of
+ * the two values before it and of the value itself, for every multiple index
+ * of interval from 2 on that is in the array. Throws where decodeLinear would.
+ *
+ * @return the number of values in the array
+ */
+template <typename Checkpoint>
+static size_t scanLinear(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t interval,
+		Checkpoint checkpoint
+) {
+	size_t count = decodedCountLinear(data, min(dataSize, static_cast<size_t>(16)));
+	if (count < 2) return count;
+
+	unsigned int diffs[INT_BLOCK];
+	long long ints[2] = { linearHeaderInt(data, 0), linearHeaderInt(data, 1) };
+	size_t di = 16;
+	size_t half = 0;
+	size_t index = 2;
+	size_t next = (2 + interval - 1) / interval * interval;
+
+	for (;;) {
+		size_t checkpointDi = di;
+		size_t checkpointHalf = half;
+		bool atCheckpoint = (index == next);
+		if (atCheckpoint) {
+			next += interval;
+		}
+
+		size_t wanted = min(INT_BLOCK, next - index);
+		size_t n = decodeIntBlock(data, dataSize, &di, &half, diffs, wanted);
+
+		// only once it is known that the value is there
+		if (atCheckpoint && n > 0) {
+			long long checkpointInts[3] = { ints[0], ints[1], 
+				ints[1] + (ints[1] - ints[0]) + static_cast<int>(diffs[0]) };
+			checkpoint(index, checkpointDi, checkpointHalf, checkpointInts);
+		}
+		for (size_t i=0; i<n; i++) {
+			long long y = ints[1] + (ints[1] - ints[0]) + static_cast<int>(diffs[i]);
+			ints[0] = ints[1];
+			ints[1] = y;
+		}
+		index += n;
+		if (n < wanted) return index;
+	}
+}
+
+
+
+/**
+ * Decodes up to count values of the encodeLinear array in data, starting 
+ * with the residual at the position given by di and half (see decodeInt), 
+ * where ints holds the ints of the two values before it. The first skip
+ * values are reconstructed but not stored.
+ *
+ * @return the number of decoded values, which is smaller than count only 
+ * when the end of the data has been reached.
+ */
+static size_t decodeLinearFrom(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t di,
+		size_t half,
+		long long *ints,
+		double fixedPoint,
+		size_t skip,
+		size_t count,
+		double *result
+) {
+	unsigned int diffs[INT_BLOCK];
+	size_t n, wanted;
+	size_t ri = 0;
+
+	while (skip > 0) {
+		wanted = min(INT_BLOCK, skip);
+		n = decodeIntBlock(data, dataSize, &di, &half, diffs, wanted);
+		for (size_t i=0; i<n; i++) {
+			long long y = ints[1] + (ints[1] - ints[0]) + static_cast<int>(diffs[i]);
+			ints[0] = ints[1];
+			ints[1] = y;
+		}
+		if (n < wanted) return 0;
+		skip -= n;
+	}
+
+	LinearValuesFn linearValues = kernels().linearValues;
+	while (ri < count) {
+		wanted = min(INT_BLOCK, count - ri);
+		n = decodeIntBlock(data, dataSize, &di, &half, diffs, wanted);
+		linearValues(diffs, n, ints, fixedPoint, result + ri);
+		ri += n;
+		if (n < wanted) break;
+	}
+	return ri;
+}
+
+
+
+// an indexed Linear array is a header like a framed one (interval instead 
+// of block size, checkpoint count instead of block count), the checkpoints
+// and a classic encodeLinear array. A seek index is the same header and the
+// size of the array it belongs to, followed by the checkpoints only, which 
+// are positions alone for Pic.
+static const size_t CHECKPOINT_SIZE = 32;
+static const size_t PIC_CHECKPOINT_SIZE = 8;
+static const size_t SEEK_HEADER_SIZE = 32;
+
+// values decoded per task by the parallel decoders of seek indices
+static const size_t PARALLEL_PART = 65536;
+
+/**
+ * Returns the start of the checkpoints of the indexed array or seek index of
+ * the given format in data, having checked its header, and sets the number 
+ * of values, the checkpoint interval and where the checkpoints end.
+ */
+static const unsigned char* checkpointTable(
+		const unsigned char *data,
+		size_t dataSize,
+		unsigned char format,
+		size_t *valueCount,
+		size_t *interval,
+		size_t *tableEnd
+) {
+	size_t headerSize 		= (format == FRAME_LINEAR_INDEXED) ? FRAME_HEADER_SIZE : SEEK_HEADER_SIZE;
+	size_t checkpointSize 	= (format == FRAME_PIC_SEEK) ? PIC_CHECKPOINT_SIZE : CHECKPOINT_SIZE;
+	size_t minInterval 		= (format == FRAME_PIC_SEEK) ? 1 : 2;
+
+	if (decodeFrameTag(data, dataSize) != format) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: not an indexed array or seek index of this format! ";
+	if (dataSize < headerSize) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: not enough bytes to read header! ";
+
+	unsigned long long sizes = loadLittleEndian(data + 8);
+	unsigned long long count = loadLittleEndian(data + 16);
+	size_t checkpointCount = static_cast<unsigned int>(sizes >> 32);
+	*interval = static_cast<unsigned int>(sizes);
+
+	if (*interval < minInterval || count > (static_cast<unsigned long long>(*interval) << 32) ||
+			checkpointCount != (count + *interval - 1) / *interval) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: inconsistent checkpoint and value counts! ";
+	if ((dataSize - headerSize) / checkpointSize < checkpointCount) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: not enough bytes to read checkpoints! ";
+
+	*valueCount = static_cast<size_t>(count);
+	*tableEnd 	= headerSize + checkpointSize * checkpointCount;
+	return data + headerSize;
+}
+
+
+
+/**
+ * Returns the checkpoints of the seek index of the given format, having 
+ * checked that it was made for an array of dataSize bytes, and sets the 
+ * number of values and the checkpoint interval.
+ */
+static const unsigned char* seekIndexHeader(
+		const unsigned char *index,
+		size_t indexSize,
+		unsigned char format,
+		size_t dataSize,
+		size_t *valueCount,
+		size_t *interval
+) {
+	size_t tableEnd;
+	const unsigned char *checkpoints = checkpointTable(index, indexSize, format, valueCount, interval, &tableEnd);
+
+	if (tableEnd != indexSize) 
+		throw "[MSNumpress::decodeSeek] Corrupt seek index: checkpoints do not end with the index! ";
+	if (loadLittleEndian(index + 24) != dataSize) 
+		throw "[MSNumpress::decodeSeek] Seek index was made for data of another size! ";
+	return checkpoints;
+}
+
+
+
+/**
+ * Writes the checkpoints of the encodeLinear array in data, see 
+ * encodeLinearIndexed, and returns its number of values.
+ */
+static size_t linearCheckpoints(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t interval,
+		unsigned char *checkpoints
+) {
+	double fixedPoint = (dataSize >= 8) ? decodeFixedPoint(data) : 0;
+
+	size_t valueCount = scanLinear(data, dataSize, interval, 
+		[&](size_t index, size_t di, size_t half, const long long *ints) {
+			unsigned char *checkpoint = checkpoints + CHECKPOINT_SIZE * (index / interval);
+			storeLittleEndian(2 * di + half, checkpoint);
+			storeLittleEndian(static_cast<unsigned long long>(ints[0]), checkpoint + 8);
+			storeLittleEndian(static_cast<unsigned long long>(ints[1]), checkpoint + 16);
+			storeDouble(ints[2] / fixedPoint, checkpoint + 24);
+		});
+
+	// the first checkpoint is the start of the array
+	if (valueCount > 0) {
+		memset(checkpoints, 0, 24);
+		storeDouble(linearHeaderInt(data, 0) / fixedPoint, checkpoints + 24);
+	}
+	return valueCount;
+}
+
+
+
+/**
+ * Sets di, half (see decodeInt) and ints to where decoding continues from 
+ * the given checkpoint of an indexed array, and returns the index of the 
+ * value decoded next. The first checkpoint is the start of the encodeLinear
+ * array, for which the two values in its header are in ints.
+ */
+static size_t indexedLinearState(
+		const unsigned char *checkpoints,
+		size_t checkpoint,
+		size_t interval,
+		const unsigned char *stream,
+		size_t streamSize,
+		size_t valueCount,
+		size_t *di,
+		size_t *half,
+		long long *ints
+) {
+	if (checkpoint == 0) {
+		size_t headerCount = min(valueCount, static_cast<size_t>(2));
+		if (streamSize < 8 + 4 * headerCount) 
+			throw "[MSNumpress::decodeIndexed] Corrupt input data: not enough bytes to read first values! ";
+		ints[0] = (headerCount > 0) ? linearHeaderInt(stream, 0) : 0;
+		ints[1] = (headerCount > 1) ? linearHeaderInt(stream, 1) : 0;
+		*di 	= 16;
+		*half 	= 0;
+		return headerCount;
+	}
+
+	const unsigned char *c = checkpoints + CHECKPOINT_SIZE * checkpoint;
+	unsigned long long position = loadLittleEndian(c);
+	if (position < 32 || position / 2 > streamSize) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: checkpoint out of bounds! ";
+
+	*di 	= static_cast<size_t>(position / 2);
+	*half 	= static_cast<size_t>(position & 1);
+	ints[0] = static_cast<long long>(loadLittleEndian(c + 8));
+	ints[1] = static_cast<long long>(loadLittleEndian(c + 16));
+	return checkpoint * interval;
+}
+
+
+
+/**
+ * Decodes the values with indices [begin, end) of the encodeLinear array in
+ * stream from the checkpoint before begin, see decodeLinearIndexedSlice.
+ */
+static size_t decodeLinearCheckpointed(
+		const unsigned char *checkpoints,
+		size_t interval,
+		size_t valueCount,
+		const unsigned char *stream,
+		size_t streamSize,
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	end = min(end, valueCount);
+	if (end <= begin) return 0;
+	if (streamSize < 8) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: not enough bytes to read fixed point! ";
+
+	double fixedPoint = decodeFixedPoint(stream);
+	long long ints[2];
+	size_t di, half;
+	size_t ri = 0;
+	size_t index = indexedLinearState(checkpoints, begin / interval, interval, 
+		stream, streamSize, valueCount, &di, &half, ints);
+
+	for (size_t i=begin; i<index && i<end; i++) {
+		result[ri++] = ints[i] / fixedPoint;
+	}
+	if (end > max(begin, index)) {
+		size_t skip = (begin > index) ? begin - index : 0;
+		ri += decodeLinearFrom(stream, streamSize, di, half, ints, fixedPoint, 
+			skip, end - index - skip, result + ri);
+	}
+	if (ri != end - begin) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: array ends before its value count! ";
+	return ri;
+}
+
+
+
+/**
+ * Returns the index of the first value of the sorted encodeLinear array in 
+ * stream that is not less than value, see lowerBoundLinearIndexed.
+ */
+static size_t lowerBoundLinearCheckpointed(
+		const unsigned char *checkpoints,
+		size_t interval,
+		size_t valueCount,
+		const unsigned char *stream,
+		size_t streamSize,
+		double value
+) {
+	// the first checkpoint at or above value, the answer is in the block 
+	// before it
+	size_t lo = 0;
+	size_t hi = (valueCount + interval - 1) / interval;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (loadDouble(checkpoints + CHECKPOINT_SIZE * mid + 24) < value) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == 0) return 0;
+	if (streamSize < 8) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: not enough bytes to read fixed point! ";
+
+	// scan the block comparing ints, with the same division as the decoder
+	// where the fixed point does not keep the order
+	double fixedPoint = decodeFixedPoint(stream);
+	long long threshold = (fixedPoint > 0) ? lowerThreshold(value, fixedPoint) : 0;
+
+	long long ints[2];
+	size_t di, half;
+	size_t end = min(lo * interval, valueCount);
+	size_t index = indexedLinearState(checkpoints, lo - 1, interval, 
+		stream, streamSize, valueCount, &di, &half, ints);
+
+	for (size_t i=(lo - 1) * interval; i<index; i++) {
+		if (fixedPoint > 0 ? ints[i] >= threshold : !(ints[i] / fixedPoint < value)) return i;
+	}
+
+	unsigned int diffs[INT_BLOCK];
+	while (index < end) {
+		size_t wanted = min(INT_BLOCK, end - index);
+		size_t n = decodeIntBlock(stream, streamSize, &di, &half, diffs, wanted);
+		for (size_t i=0; i<n; i++) {
+			long long y = ints[1] + (ints[1] - ints[0]) + static_cast<int>(diffs[i]);
+			if (fixedPoint > 0 ? y >= threshold : !(y / fixedPoint < value)) return index + i;
+			ints[0] = ints[1];
+			ints[1] = y;
+		}
+		if (n < wanted) 
+			throw "[MSNumpress::decodeIndexed] Corrupt input data: array ends before its value count! ";
+		index += n;
+	}
+	return end;
+}
+
+
+
+/**
+ * Decodes the values with indices [begin, end) of the encodePic array in 
+ * data from the checkpoint before begin, skipping the ints up to begin by 
+ * their header halfbytes.
+ */
+static size_t decodePicCheckpointed(
+		const unsigned char *checkpoints,
+		size_t interval,
+		size_t valueCount,
+		const unsigned char *data,
+		size_t dataSize,
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	end = min(end, valueCount);
+	if (end <= begin) return 0;
+
+	size_t checkpoint = begin / interval;
+	unsigned long long position = loadLittleEndian(checkpoints + PIC_CHECKPOINT_SIZE * checkpoint);
+	if (position / 2 > dataSize) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: checkpoint out of bounds! ";
+
+	size_t di 	= static_cast<size_t>(position / 2);
+	size_t half = static_cast<size_t>(position & 1);
+	size_t skip = begin - checkpoint * interval;
+	if (skipInts(data, dataSize, &di, &half, skip) != skip || 
+			decodePicFrom(data, dataSize, di, half, end - begin, result) != end - begin) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: array ends before its value count! ";
+	return end - begin;
+}
+
+
+
+/**
+ * Decodes all valueCount values by calling decodeSlice(begin, end, result + 
+ * begin) on parts of whole checkpoint intervals, spread over up to threads 
+ * threads.
+ */
+template <typename DecodeSlice>
+static size_t decodeCheckpointedParallel(
+		size_t valueCount,
+		size_t interval,
+		size_t threads,
+		double *result,
+		DecodeSlice decodeSlice
+) {
+	size_t partSize = interval * max(static_cast<size_t>(1), PARALLEL_PART / interval);
+	size_t partCount = (valueCount + partSize - 1) / partSize;
+
+	parallelFor(partCount, threads, [&](size_t p) {
+		size_t begin = p * partSize;
+		decodeSlice(begin, min(begin + partSize, valueCount), result + begin);
+	});
+	return valueCount;
+}
+
+
+
+/**
+ * Returns the start of the checkpoints of the indexed array in data, having
+ * checked its header, and sets the number of values, the checkpoint interval
+ * and where its encodeLinear array starts.
+ */
+static const unsigned char* indexedLinearHeader(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *valueCount,
+		size_t *interval,
+		size_t *streamOffset
+) {
+	const unsigned char *checkpoints = checkpointTable(data, dataSize, FRAME_LINEAR_INDEXED, 
+		valueCount, interval, streamOffset);
+	if (dataSize - *streamOffset < 8) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: not enough bytes to read fixed point! ";
+	return checkpoints;
+}
+
+
+
+size_t maxIndexedSize(
+		size_t dataSize,
+		size_t interval
+) {
+	size_t checkpointCount = (interval == 0) ? 0 : (dataSize + interval - 1) / interval;
+	return FRAME_HEADER_SIZE + CHECKPOINT_SIZE * checkpointCount + 8 + 5 * dataSize;
+}
+
+
+
+size_t encodeLinearIndexed(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint,
+		size_t interval
+) {
+	if (interval < 2 || interval > 0xffffffff) 
+		throw "[MSNumpress::encodeLinearIndexed] Checkpoint interval must be between 2 and 2^32 - 1.";
+
+	size_t checkpointCount = (dataSize + interval - 1) / interval;
+	if (checkpointCount > 0xffffffff) 
+		throw "[MSNumpress::encodeLinearIndexed] Too many checkpoints.";
+
+	encodeFrameTag(FRAME_LINEAR_INDEXED, result);
+	storeLittleEndian(interval | (static_cast<unsigned long long>(checkpointCount) << 32), result + 8);
+	storeLittleEndian(dataSize, result + 16);
+
+	// the checkpoints are found in what was encoded, so that they hold 
+	// exactly what decodeLinear sees
+	unsigned char *checkpoints = result + FRAME_HEADER_SIZE;
+	unsigned char *stream = checkpoints + CHECKPOINT_SIZE * checkpointCount;
+	size_t streamSize = encodeLinear(data, dataSize, stream, fixedPoint);
+	linearCheckpoints(stream, streamSize, interval, checkpoints);
+
+	return FRAME_HEADER_SIZE + CHECKPOINT_SIZE * checkpointCount + streamSize;
+}
+
+
+
+size_t decodedCountIndexed(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	size_t valueCount, interval, streamOffset;
+	indexedLinearHeader(data, dataSize, &valueCount, &interval, &streamOffset);
+	return valueCount;
+}
+
+
+
+size_t decodeLinearIndexed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result
+) {
+	size_t valueCount, interval, streamOffset;
+	indexedLinearHeader(data, dataSize, &valueCount, &interval, &streamOffset);
+
+	// checked first, so that corrupt data cannot write past the result
+	if (decodedCountLinear(data + streamOffset, dataSize - streamOffset) != valueCount) 
+		throw "[MSNumpress::decodeIndexed] Corrupt input data: wrong number of values! ";
+	return decodeLinear(data + streamOffset, dataSize - streamOffset, result);
+}
+
+
+
+size_t decodeLinearIndexedSlice(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	size_t valueCount, interval, streamOffset;
+	const unsigned char *checkpoints = indexedLinearHeader(data, dataSize, &valueCount, &interval, &streamOffset);
+	return decodeLinearCheckpointed(checkpoints, interval, valueCount, 
+		data + streamOffset, dataSize - streamOffset, begin, end, result);
+}
+
+
+
+size_t lowerBoundLinearIndexed(
+		const unsigned char *data,
+		size_t dataSize,
+		double value
+) {
+	size_t valueCount, interval, streamOffset;
+	const unsigned char *checkpoints = indexedLinearHeader(data, dataSize, &valueCount, &interval, &streamOffset);
+	return lowerBoundLinearCheckpointed(checkpoints, interval, valueCount, 
+		data + streamOffset, dataSize - streamOffset, value);
+}
+
+
+
+void encodeLinearIndexed(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		size_t interval
+) {
+	size_t dataSize = data.size();
+	result.resize(maxIndexedSize(dataSize, interval));
+	size_t encodedLength = encodeLinearIndexed(data.data(), dataSize, &result[0], fixedPoint, interval);
+	result.resize(encodedLength);
+}
+
+
+
+void decodeLinearIndexed(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result
+) {
+	size_t dataSize = data.size();
+	result.resize(decodedCountIndexed(data.data(), dataSize));
+	decodeLinearIndexed(data.data(), dataSize, result.empty() ? NULL : &result[0]);
+}
+
+
+
+/**
+ * Writes the header of a seek index
+ */
+static void encodeSeekHeader(
+		unsigned char format,
+		size_t interval,
+		size_t checkpointCount,
+		size_t valueCount,
+		size_t dataSize,
+		unsigned char *index
+) {
+	if (checkpointCount > 0xffffffff) 
+		throw "[MSNumpress::seekIndex] Too many checkpoints.";
+
+	encodeFrameTag(format, index);
+	storeLittleEndian(interval | (static_cast<unsigned long long>(checkpointCount) << 32), index + 8);
+	storeLittleEndian(valueCount, index + 16);
+	storeLittleEndian(dataSize, index + 24);
+}
+
+
+
+size_t maxSeekIndexSize(
+		size_t dataSize,
+		size_t interval
+) {
+	// ints are at least a halfbyte
+	size_t checkpointCount = (interval == 0) ? 0 : (2 * dataSize + 2) / interval + 1;
+	return SEEK_HEADER_SIZE + CHECKPOINT_SIZE * checkpointCount;
+}
+
+
+
+size_t seekIndexLinear(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t interval,
+		unsigned char *index
+) {
+	if (interval < 2 || interval > 0xffffffff) 
+		throw "[MSNumpress::seekIndexLinear] Checkpoint interval must be between 2 and 2^32 - 1.";
+
+	size_t valueCount = linearCheckpoints(data, dataSize, interval, index + SEEK_HEADER_SIZE);
+	size_t checkpointCount = (valueCount + interval - 1) / interval;
+	encodeSeekHeader(FRAME_LINEAR_SEEK, interval, checkpointCount, valueCount, dataSize, index);
+
+	return SEEK_HEADER_SIZE + CHECKPOINT_SIZE * checkpointCount;
+}
+
+
+
+size_t seekIndexPic(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t interval,
+		unsigned char *index
+) {
+	if (interval < 1 || interval > 0xffffffff) 
+		throw "[MSNumpress::seekIndexPic] Checkpoint interval must be between 1 and 2^32 - 1.";
+
+	unsigned char *checkpoints = index + SEEK_HEADER_SIZE;
+	size_t di = 0;
+	size_t half = 0;
+	size_t valueCount = 0;
+	size_t checkpointCount = 0;
+
+	for (;;) {
+		unsigned long long position = 2 * di + half;
+		size_t n = skipInts(data, dataSize, &di, &half, interval);
+		if (n == 0) break;
+
+		storeLittleEndian(position, checkpoints + PIC_CHECKPOINT_SIZE * checkpointCount++);
+		valueCount += n;
+		if (n < interval) break;
+	}
+	encodeSeekHeader(FRAME_PIC_SEEK, interval, checkpointCount, valueCount, dataSize, index);
+
+	return SEEK_HEADER_SIZE + PIC_CHECKPOINT_SIZE * checkpointCount;
+}
+
+
+
+void seekIndexLinear(
+		const std::vector<unsigned char> &data,
+		size_t interval,
+		std::vector<unsigned char> &index
+) {
+	index.resize(maxSeekIndexSize(data.size(), interval));
+	index.resize(seekIndexLinear(data.data(), data.size(), interval, &index[0]));
+}
+
+
+
+void seekIndexPic(
+		const std::vector<unsigned char> &data,
+		size_t interval,
+		std::vector<unsigned char> &index
+) {
+	index.resize(maxSeekIndexSize(data.size(), interval));
+	index.resize(seekIndexPic(data.data(), data.size(), interval, &index[0]));
+}
+
+
+
+size_t decodedCountSeek(
+		const unsigned char *index,
+		size_t indexSize
+) {
+	size_t valueCount, interval, tableEnd;
+	unsigned char format = decodeFrameTag(index, indexSize);
+	if (format != FRAME_LINEAR_SEEK && format != FRAME_PIC_SEEK) 
+		throw "[MSNumpress::decodeSeek] Corrupt seek index: not a seek index! ";
+
+	checkpointTable(index, indexSize, format, &valueCount, &interval, &tableEnd);
+	if (tableEnd != indexSize) 
+		throw "[MSNumpress::decodeSeek] Corrupt seek index: checkpoints do not end with the index! ";
+	return valueCount;
+}
+
+
+
+size_t decodeLinearSlice(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	size_t valueCount, interval;
+	const unsigned char *checkpoints = seekIndexHeader(index, indexSize, FRAME_LINEAR_SEEK, 
+		dataSize, &valueCount, &interval);
+	return decodeLinearCheckpointed(checkpoints, interval, valueCount, 
+		data, dataSize, begin, end, result);
+}
+
+
+
+size_t lowerBoundLinear(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		double value
+) {
+	size_t valueCount, interval;
+	const unsigned char *checkpoints = seekIndexHeader(index, indexSize, FRAME_LINEAR_SEEK, 
+		dataSize, &valueCount, &interval);
+	return lowerBoundLinearCheckpointed(checkpoints, interval, valueCount, 
+		data, dataSize, value);
+}
+
+
+
+size_t decodePicSlice(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	size_t valueCount, interval;
+	const unsigned char *checkpoints = seekIndexHeader(index, indexSize, FRAME_PIC_SEEK, 
+		dataSize, &valueCount, &interval);
+	return decodePicCheckpointed(checkpoints, interval, valueCount, 
+		data, dataSize, begin, end, result);
+}
+
+
+
+size_t decodeLinearParallel(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		double *result,
+		size_t threads
+) {
+	size_t valueCount, interval;
+	const unsigned char *checkpoints = seekIndexHeader(index, indexSize, FRAME_LINEAR_SEEK, 
+		dataSize, &valueCount, &interval);
+	return decodeCheckpointedParallel(valueCount, interval, threads, result, 
+		[&](size_t begin, size_t end, double *out) {
+			decodeLinearCheckpointed(checkpoints, interval, valueCount, 
+				data, dataSize, begin, end, out);
+		});
+}
+
+
+
+size_t decodePicParallel(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		double *result,
+		size_t threads
+) {
+	size_t valueCount, interval;
+	const unsigned char *checkpoints = seekIndexHeader(index, indexSize, FRAME_PIC_SEEK, 
+		dataSize, &valueCount, &interval);
+	return decodeCheckpointedParallel(valueCount, interval, threads, result, 
+		[&](size_t begin, size_t end, double *out) {
+			decodePicCheckpointed(checkpoints, interval, valueCount, 
+				data, dataSize, begin, end, out);
+		});
+}
+
+
+/////////////////////////////////////////////////////////////
+
+// bytes per chunk below which decodePicParallel uses fewer threads, and the
+// number of int positions a chunk records for its start to be reconciled
+static const size_t SPECULATIVE_CHUNK = 65536;
+static const size_t SYNC_WINDOW = 64;
+
+/**
+ * Where a chunk of a Pic array starts (in halfbytes) and how many ints 
+ * start in it
+ */
+struct PicChunk {
+	unsigned long long start;
+	size_t count;
+};
+
+/**
+ * Walks the heads of the ints from the position given by di and half (see 
+ * decodeInt) as skipInts does, up to the first int starting at or after 
+ * byte stop, and returns how many were walked. The halfbyte positions of the
+ * first window of them are stored in positions.
+ */
+static size_t walkInts(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *di,
+		size_t *half,
+		size_t stop,
+		unsigned long long *positions,
+		size_t window
+) {
+	unsigned char lengths[2 * INT_TILE];
+	unsigned int res;
+	size_t count = 0;
+
+	while (*di < stop && *di + 8 <= dataSize) {
+		size_t start 	= *di;
+		size_t tile 	= min(INT_TILE, dataSize - 7 - start);
+		size_t end 		= min(2 * tile, 2 * (stop - start));
+		size_t p 		= *half;
+
+		kernels().intLengths(data + start, tile, lengths);
+		for (; p < end; p += lengths[p]) {
+			if (count < window) positions[count] = 2 * start + p;
+			count++;
+		}
+
+		*di 	= start + (p >> 1);
+		*half 	= p & 1;
+	}
+
+	while (*di < stop && *di < dataSize) {
+		if (*di == (dataSize - 1) && *half == 1) {
+			if ((data[*di] & 0xf) == 0x0) {
+				break;
+			}
+		}
+		if (count < window) positions[count] = 2 * *di + *half;
+		decodeInt(data, di, dataSize, half, &res);
+		count++;
+	}
+
+	return count;
+}
+
+
+
+/**
+ * Moves di and half (see decodeInt) past the int there, and returns false if
+ * there is none.
+ */
+static bool nextInt(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *di,
+		size_t *half
+) {
+	unsigned int res;
+	if (*di >= dataSize) return false;
+	if (*di == (dataSize - 1) && *half == 1 && (data[*di] & 0xf) == 0x0) return false;
+
+	decodeInt(data, di, dataSize, half, &res);
+	return true;
+}
+
+
+
+/**
+ * Splits the encodePic array in data into chunks of about equal size that 
+ * start on int boundaries, counting their ints on up to threads threads.
+ *
+ * The ints of a Pic array do not say where they start, but parsing the 
+ * heads from a wrong halfbyte usually falls into the true int boundaries 
+ * after a few ints. So every chunk is first walked from a guessed start on
+ * its own, recording where its first ints start. Then the true parse is 
+ * carried from chunk to chunk, walking it only until it meets one of the 
+ * recorded positions, from where the chunk's own walk was right. Chunks 
+ * where this does not happen soon are walked again in full.
+ */
+static void planPicChunks(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t threads,
+		std::vector<PicChunk> &chunks
+) {
+	if (isFramed(data, dataSize)) 
+		throw "[MSNumpress::decodePic] Corrupt input data: starts with a frame tag (framed data must be decoded with decodePicFramed)! ";
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+	size_t chunkCount = max(static_cast<size_t>(1), min(threads, dataSize / SPECULATIVE_CHUNK));
+
+	std::vector<size_t> bounds(chunkCount + 1);
+	for (size_t c=0; c<=chunkCount; c++) {
+		bounds[c] = dataSize * c / chunkCount;
+	}
+
+	// speculative walks from the first halfbyte of every chunk
+	std::vector<unsigned long long> positions(chunkCount * SYNC_WINDOW);
+	std::vector<PicChunk> guesses(chunkCount);
+	std::vector<unsigned long long> ends(chunkCount);
+	std::vector<char> failed(chunkCount, 0);
+
+	parallelFor(chunkCount, threads, [&](size_t c) {
+		size_t di = bounds[c];
+		size_t half = 0;
+		try {
+			guesses[c].count = walkInts(data, dataSize, &di, &half, bounds[c + 1], 
+				&positions[c * SYNC_WINDOW], SYNC_WINDOW);
+			ends[c] = 2 * di + half;
+		} catch (const char *) {
+			// a wrong start can run into the end of the data as corrupt,
+			// the true parse will tell
+			failed[c] = 1;
+		}
+	});
+
+	chunks.resize(chunkCount);
+	unsigned long long start = 0;
+	for (size_t c=0; c<chunkCount; c++) {
+		size_t di 		= static_cast<size_t>(start / 2);
+		size_t half 	= static_cast<size_t>(start & 1);
+		size_t count 	= 0;
+		size_t known 	= min(guesses[c].count, SYNC_WINDOW);
+		size_t j 		= 0;
+		bool synced 	= false;
+
+		chunks[c].start = start;
+		while (!failed[c] && j < known && di < bounds[c + 1]) {
+			unsigned long long q = 2 * di + half;
+			while (j < known && positions[c * SYNC_WINDOW + j] < q) j++;
+			if (j < known && positions[c * SYNC_WINDOW + j] == q) {
+				count += guesses[c].count - j;
+				start = ends[c];
+				synced = true;
+				break;
+			}
+			if (!nextInt(data, dataSize, &di, &half)) break;
+			count++;
+		}
+
+		if (!synced) {
+			count += walkInts(data, dataSize, &di, &half, bounds[c + 1], NULL, 0);
+			start = 2 * di + half;
+		}
+		chunks[c].count = count;
+	}
+}
+
+
+
+/**
+ * Decodes the chunks planned by planPicChunks on up to threads threads, 
+ * and returns the number of decoded values.
+ */
+static size_t decodePicChunks(
+		const unsigned char *data,
+		size_t dataSize,
+		const std::vector<PicChunk> &chunks,
+		double *result,
+		size_t threads
+) {
+	std::vector<size_t> offsets(chunks.size() + 1, 0);
+	for (size_t c=0; c<chunks.size(); c++) {
+		offsets[c + 1] = offsets[c] + chunks[c].count;
+	}
+
+	parallelFor(chunks.size(), threads, [&](size_t c) {
+		size_t di 	= static_cast<size_t>(chunks[c].start / 2);
+		size_t half = static_cast<size_t>(chunks[c].start & 1);
+		if (chunks[c].count > 0 && 
+				decodePicFrom(data, dataSize, di, half, chunks[c].count, result + offsets[c]) != chunks[c].count) 
+			throw "[MSNumpress::decodePicParallel] Corrupt input data: chunk ends early! ";
+	});
+	return offsets.back();
+}
+
+
+
+size_t decodePicParallel(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads
+) {
+	std::vector<PicChunk> chunks;
+	planPicChunks(data, dataSize, threads, chunks);
+	return decodePicChunks(data, dataSize, chunks, result, threads);
+}
+
+
+
+void decodePicParallel(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result,
+		size_t threads
+) {
+	std::vector<PicChunk> chunks;
+	planPicChunks(data.data(), data.size(), threads, chunks);
+
+	size_t count = 0;
+	for (size_t c=0; c<chunks.size(); c++) {
+		count += chunks[c].count;
+	}
+	result.resize(count);
+	decodePicChunks(data.data(), data.size(), chunks, result.empty() ? NULL : &result[0], threads);
+}
+
+
+/////////////////////////////////////////////////////////////
+
+
+/**
+ * Returns the largest of the n values in data, ignoring NaN, or -HUGE_VAL if
+ * there is none.
+ */
+static double maxValueScalar(
+		const double *data,
+		size_t n
+) {
+	double m = -HUGE_VAL;
+	for (size_t i=0; i<n; i++) {
+		m = (m < data[i]) ? data[i] : m;
+	}
+	return m;
+}
+
+
+
+/**
+ * Writes the 2 byte little-endian Slof codes of the n values in data to 
+ * result, the way encodeSlof always has: log(x + 1) * fixedPoint + 0.5
+ * truncated to an unsigned short.
+ */
+static void slofCodesScalar(
+		const double *data,
+		size_t n,
+		double fixedPoint,
+		unsigned char *result
+) {
+	double temp;
+	unsigned short x;
+
+	for (size_t i=0; i<n; i++) {
+		temp = log(data[i]+1) * fixedPoint;
+
+		if (THROW_ON_OVERFLOW && 
+				temp > USHRT_MAX		) {
+			throw "[MSNumpress::encodeSlof] Cannot encode a number that overflows USHRT_MAX.";
+		}
+
+		x = static_cast<unsigned short>(temp + 0.5);
+		result[2*i] 	= x & 0xff;
+		result[2*i+1] 	= (x >> 8) & 0xff; 
+	}
+}
+
+#if MSNUMPRESS_X86
+
+MSNUMPRESS_TARGET("sse2")
+static double maxValueSSE2(
+		const double *data,
+		size_t n
+) {
+	__m128d m0 = _mm_set1_pd(-HUGE_VAL);
+	__m128d m1 = m0;
+	size_t i = 0;
+
+	for (; i+4 <= n; i+=4) {
+		m0 = _mm_max_pd(_mm_loadu_pd(data + i), m0);
+		m1 = _mm_max_pd(_mm_loadu_pd(data + i + 2), m1);
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_max_pd(m0, m1));
+	return max(max(lanes[0], lanes[1]), maxValueScalar(data + i, n - i));
+}
+
+
+
+MSNUMPRESS_TARGET("avx2")
+static double maxValueAVX2(
+		const double *data,
+		size_t n
+) {
+	// maxpd returns its second operand if the first is NaN
+	__m256d m0 = _mm256_set1_pd(-HUGE_VAL);
+	__m256d m1 = m0;
+	size_t i = 0;
+
+	for (; i+8 <= n; i+=8) {
+		m0 = _mm256_max_pd(_mm256_loadu_pd(data + i), m0);
+		m1 = _mm256_max_pd(_mm256_loadu_pd(data + i + 4), m1);
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, _mm256_max_pd(m0, m1));
+	return max(max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3])), maxValueScalar(data + i, n - i));
+}
+
+
+
+MSNUMPRESS_TARGET("avx512f")
+static double maxValueAVX512(
+		const double *data,
+		size_t n
+) {
+	__m512d m0 = _mm512_set1_pd(-HUGE_VAL);
+	__m512d m1 = m0;
+	size_t i = 0;
+
+	for (; i+16 <= n; i+=16) {
+		m0 = _mm512_mask_max_pd(m0, 0xff, _mm512_loadu_pd(data + i), m0);
+		m1 = _mm512_mask_max_pd(m1, 0xff, _mm512_loadu_pd(data + i + 8), m1);
+	}
+	double lanes[8];
+	_mm512_storeu_pd(lanes, _mm512_mask_max_pd(m0, 0xff, m0, m1));
+	return max(maxValueScalar(lanes, 8), maxValueScalar(data + i, n - i));
+}
+
+
+
+/**
+ * Natural logarithm of positive, finite, normal x, to within a few ulp. 
+ *
+ * x = 2^e * m with m in (sqrt(2)/2, sqrt(2)], and log(m) = 2 atanh(s) for 
+ * s = (m - 1) / (m + 1), |s| < 0.172, from its series up to s^19.
+ */
+MSNUMPRESS_TARGET("avx2")
+static inline __m256d logAVX2(
+		__m256d x
+) {
+	const __m256i mantissa 	= _mm256_set1_epi64x(0x000fffffffffffffLL);
+	const __m256i oneBits 	= _mm256_set1_epi64x(0x3ff0000000000000LL);
+	const __m256i magicBits = _mm256_set1_epi64x(0x4330000000000000LL);
+	const __m256d bias 		= _mm256_set1_pd(4503599627370496.0 + 1023.0);
+	const __m256d one 		= _mm256_set1_pd(1.0);
+	const __m256d two 		= _mm256_set1_pd(2.0);
+	const __m256d half 		= _mm256_set1_pd(0.5);
+	const __m256d sqrt2 	= _mm256_set1_pd(1.4142135623730951);
+	const __m256d ln2Hi 	= _mm256_set1_pd(6.93147180369123816490e-01);
+	const __m256d ln2Lo 	= _mm256_set1_pd(1.90821492927058770002e-10);
+
+	__m256i bits = _mm256_castpd_si256(x);
+	__m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantissa), oneBits));
+	__m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), magicBits)), bias);
+
+	__m256d big = _mm256_cmp_pd(m, sqrt2, _CMP_GT_OQ);
+	m = _mm256_blendv_pd(m, _mm256_mul_pd(m, half), big);
+	e = _mm256_add_pd(e, _mm256_and_pd(big, one));
+
+	__m256d f = _mm256_sub_pd(m, one);
+	__m256d s = _mm256_div_pd(f, _mm256_add_pd(two, f));
+	__m256d z = _mm256_mul_pd(s, s);
+
+	__m256d p = _mm256_set1_pd(2.0 / 19);
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 17));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 15));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 13));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 11));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 9));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 7));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 5));
+	p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(2.0 / 3));
+	__m256d logm = _mm256_add_pd(_mm256_add_pd(s, s), _mm256_mul_pd(_mm256_mul_pd(s, z), p));
+
+	return _mm256_add_pd(_mm256_mul_pd(e, ln2Hi), _mm256_add_pd(_mm256_mul_pd(e, ln2Lo), logm));
+}
+
+
+
+/**
+ * As slofCodesScalar, four values at a time with logAVX2. Its error is far
+ * below SLOF_ROUNDING_MARGIN, so wherever log(x + 1) * fixedPoint + 0.5 is at
+ * least that far from an integer it truncates to the same code as with the
+ * libm log. Groups with a value that is closer (or out of range, or not a
+ * positive normal number) are done by slofCodesScalar.
+ */
+MSNUMPRESS_TARGET("avx2")
+static void slofCodesAVX2(
+		const double *data,
+		size_t n,
+		double fixedPoint,
+		unsigned char *result
+) {
+	const double SLOF_ROUNDING_MARGIN = 1e-6;
+	const __m256d one 		= _mm256_set1_pd(1.0);
+	const __m256d half 		= _mm256_set1_pd(0.5);
+	const __m256d zero 		= _mm256_setzero_pd();
+	const __m256d minX 		= _mm256_set1_pd(2.2250738585072014e-308);
+	const __m256d maxX 		= _mm256_set1_pd(1.7976931348623157e308);
+	const __m256d maxTemp 	= _mm256_set1_pd(USHRT_MAX - 1);
+	const __m256d lowFrac 	= _mm256_set1_pd(SLOF_ROUNDING_MARGIN);
+	const __m256d highFrac 	= _mm256_set1_pd(1 - SLOF_ROUNDING_MARGIN);
+	const __m256d fp 		= _mm256_set1_pd(fixedPoint);
+	size_t i = 0;
+
+	for (; i+4 <= n; i+=4) {
+		__m256d x 		= _mm256_add_pd(_mm256_loadu_pd(data + i), one);
+		__m256d temp 	= _mm256_mul_pd(logAVX2(x), fp);
+		__m256d v 		= _mm256_add_pd(temp, half);
+		__m256d frac 	= _mm256_sub_pd(v, _mm256_floor_pd(v));
+
+		__m256d ok = _mm256_and_pd(
+				_mm256_and_pd(_mm256_cmp_pd(x, minX, _CMP_GE_OQ), _mm256_cmp_pd(x, maxX, _CMP_LE_OQ)),
+				_mm256_and_pd(
+					_mm256_and_pd(_mm256_cmp_pd(temp, zero, _CMP_GE_OQ), _mm256_cmp_pd(temp, maxTemp, _CMP_LE_OQ)),
+					_mm256_and_pd(_mm256_cmp_pd(frac, lowFrac, _CMP_GE_OQ), _mm256_cmp_pd(frac, highFrac, _CMP_LE_OQ))));
+
+		if (_mm256_movemask_pd(ok) == 0xf) {
+			__m128i codes = _mm_packus_epi32(_mm256_cvttpd_epi32(v), _mm_setzero_si128());
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(result + 2*i), codes);
+		} else {
+			slofCodesScalar(data + i, 4, fixedPoint, result + 2*i);
+		}
+	}
+	slofCodesScalar(data + i, n - i, fixedPoint, result + 2*i);
+}
+
+#endif
+
+
+
+double optimalSlofFixedPoint(
+		const double *data, 
+		size_t dataSize
+) {
+	if (dataSize == 0) return 0;
+	
+	double maxDouble = 1;
+	double fp;
+
+	// log is monotonic, so the largest log(x+1) is the one of the largest x
+	maxDouble = max(maxDouble, log(kernels().maxValue(data, dataSize) + 1));
+
+	fp = floor(0xFFFF / maxDouble);
+
+	//cout << "    max val: " << maxDouble << endl;
+	//cout << "fixed point: " << fp << endl;
+
+	return fp;
+}
+
+
+
+size_t encodeSlof(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint
+) {
+	encodeFixedPoint(fixedPoint, result);
+	kernels().slofCodes(data, dataSize, fixedPoint, result + 8);
+	return 8 + 2 * dataSize;
+}
+
+
+
+// number of exp tables kept by slofTable, and number of fixed points tracked
+static const size_t SLOF_TABLE_CACHE_SIZE = 4;
+static const size_t SLOF_TRACKED_FIXED_POINTS = 16;
+
+// number of values decoded with a fixed point before its table is built
+static const size_t SLOF_TABLE_THRESHOLD = 16384;
+
+typedef std::shared_ptr<const std::vector<double> > SlofTable;
+
+struct SlofCacheEntry {
+	double fixedPoint;
+	size_t decoded;
+	SlofTable table;
+	unsigned long long lastUse;
+};
+
+static std::mutex slofCacheMutex;
+static std::vector<SlofCacheEntry> slofCache;
+static unsigned long long slofCacheClock = 0;
+
+
+
+/**
+ * Evicts the least recently used entry of slofCache that has a table if 
+ * withTable, otherwise the least recently used entry of all.
+ * slofCacheMutex must be held.
+ */
+static void evictSlofCacheEntry(
+		bool withTable
+) {
+	size_t oldest = slofCache.size();
+	for (size_t i=0; i<slofCache.size(); i++) {
+		if (withTable && !slofCache[i].table) continue;
+		if (oldest == slofCache.size() || slofCache[i].lastUse < slofCache[oldest].lastUse) {
+			oldest = i;
+		}
+	}
+	if (oldest < slofCache.size()) {
+		slofCache.erase(slofCache.begin() + oldest);
+	}
+}
+
+
+
+/**
+ * Returns the entry of slofCache for fixedPoint, adding it if needed.
+ * slofCacheMutex must be held.
+ */
+static SlofCacheEntry &slofCacheEntry(
+		double fixedPoint
+) {
+	for (size_t i=0; i<slofCache.size(); i++) {
+		if (slofCache[i].fixedPoint == fixedPoint) {
+			return slofCache[i];
+		}
+	}
+	if (slofCache.size() >= SLOF_TRACKED_FIXED_POINTS) {
+		evictSlofCacheEntry(false);
+	}
+	SlofCacheEntry e = { fixedPoint, 0, SlofTable(), 0 };
+	slofCache.push_back(e);
+	return slofCache.back();
+}
+
+
+
+/**
+ * Returns the table of exp(x / fixedPoint) - 1 for all 65536 values of x, or
+ * an empty pointer if fewer than SLOF_TABLE_THRESHOLD values have been 
+ * decoded with this fixed point so far. count is the number of values about
+ * to be decoded. 
+ *
+ * Tables are kept in a small LRU cache shared between threads.
+ */
+static SlofTable slofTable(
+		double fixedPoint,
+		size_t count
+) {
+	{
+		std::lock_guard<std::mutex> lock(slofCacheMutex);
+		SlofCacheEntry &entry = slofCacheEntry(fixedPoint);
+		entry.lastUse = ++slofCacheClock;
+		if (entry.table) {
+			return entry.table;
+		}
+		entry.decoded += count;
+		if (entry.decoded < SLOF_TABLE_THRESHOLD) {
+			return SlofTable();
+		}
+	}
+
+	// build outside of the lock, exactly as decodeSlof computes each value
+	std::shared_ptr<std::vector<double> > table(new std::vector<double>(65536));
+	for (size_t i=0; i<65536; i++) {
+		unsigned short x = static_cast<unsigned short>(i);
+		(*table)[i] = exp(x / fixedPoint) - 1;
+	}
+
+	std::lock_guard<std::mutex> lock(slofCacheMutex);
+	SlofCacheEntry *entry = &slofCacheEntry(fixedPoint);
+	if (!entry->table) { // unless another thread was first
+		size_t tables = 0;
+		for (size_t i=0; i<slofCache.size(); i++) {
+			if (slofCache[i].table) tables++;
+		}
+		if (tables >= SLOF_TABLE_CACHE_SIZE) {
+			evictSlofCacheEntry(true);
+			entry = &slofCacheEntry(fixedPoint);
+		}
+		entry->table = table;
+	}
+	entry->lastUse = ++slofCacheClock;
+	return entry->table;
+}
+
+
+
+/**
+ * Looks up the n little-endian 2 byte codes in data in table
+ */
+static void slofGatherScalar(
+		const unsigned char *data,
+		size_t n,
+		const double *table,
+		double *result
+) {
+	for (size_t i=0; i<n; i++) {
+		result[i] = table[data[2*i] | (data[2*i+1] << 8)];
+	}
+}
+
+#if MSNUMPRESS_X86
+
+MSNUMPRESS_TARGET("avx2")
+static void slofGatherAVX2(
+		const unsigned char *data,
+		size_t n,
+		const double *table,
+		double *result
+) {
+	// a gather with a source and a full mask, as the plain one has GCC warn
+	const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	size_t i = 0;
+	for (; i+4 <= n; i+=4) {
+		__m128i idx = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + 2*i)));
+		_mm256_storeu_pd(result + i, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, idx, all, 8));
+	}
+	slofGatherScalar(data + 2*i, n - i, table, result + i);
+}
+
+
+
+MSNUMPRESS_TARGET("avx512f")
+static void slofGatherAVX512(
+		const unsigned char *data,
+		size_t n,
+		const double *table,
+		double *result
+) {
+	size_t i = 0;
+	for (; i+8 <= n; i+=8) {
+		__m256i idx = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2*i)));
+		_mm512_storeu_pd(result + i, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, idx, table, 8));
+	}
+	slofGatherScalar(data + 2*i, n - i, table, result + i);
+}
+
+#endif
+
+
+
+/**
+ * Decodes the n slof codes at codes, looking them up if there is a table
+ */
+static void slofValues(
+		const unsigned char *codes,
+		size_t n,
+		double fixedPoint,
+		const SlofTable &table,
+		double *result
+) {
+	if (table) {
+		kernels().slofGather(codes, n, &(*table)[0], result);
+		return;
+	}
+	for (size_t i=0; i<n; i++) {
+		unsigned short x = static_cast<unsigned short>(codes[2*i] | (codes[2*i + 1] << 8));
+		result[i] = exp(x / fixedPoint) - 1;
+	}
+}
+
+
+
+size_t decodeSlof(
+		const unsigned char *data, 
+		const size_t dataSize, 
+		double *result
+) {
+	if (dataSize < 8) 
+		throw "[MSNumpress::decodeSlof] Corrupt input data: not enough bytes to read fixed point! ";
+	
+	size_t n = (dataSize - 8) / 2;
+	double fixedPoint = decodeFixedPoint(data);
+
+	// only 65536 different values can be decoded for a fixed point, so if it
+	// is used often enough they are all computed once and looked up
+	slofValues(data + 8, n, fixedPoint, slofTable(fixedPoint, n), result);
+	return n;
+}
+
+
+
+size_t decodeSlofSlice(
+		const unsigned char *data, 
+		const size_t dataSize, 
+		size_t begin,
+		size_t end,
+		double *result
+) {
+	if (dataSize < 8) 
+		throw "[MSNumpress::decodeSlof] Corrupt input data: not enough bytes to read fixed point! ";
+	
+	end = min(end, (dataSize - 8) / 2);
+	if (end <= begin) return 0;
+
+	double fixedPoint = decodeFixedPoint(data);
+	slofValues(data + 8 + 2*begin, end - begin, fixedPoint, slofTable(fixedPoint, end - begin), result);
+	return end - begin;
+}
+
+
+
+void encodeSlof(
+		const std::vector<double> &data,  
+		std::vector<unsigned char> &result,
+		double fixedPoint
+) {
+	size_t dataSize = data.size();
+	result.resize(dataSize * 2 + 8);
+	size_t encodedLength = encodeSlof(&data[0], dataSize, &result[0], fixedPoint);
+	result.resize(encodedLength);
+}
+
+
+
+void decodeSlof(
+		const std::vector<unsigned char> &data,  
+		std::vector<double> &result
+) {
+	size_t dataSize = data.size();
+	result.resize((dataSize - 8) / 2);
+	size_t decodedLength = decodeSlof(&data[0], dataSize, &result[0]);
+	result.resize(decodedLength);
+}
+
+/////////////////////////////////////////////////////////////
+
+/**
+ * Grows buffer to hold at least capacity elements (geometrically), keeping 
+ * the first count. The new memory is left uninitialized.
+ */
+template <typename T>
+static void growBuffer(
+		T **buffer,
+		size_t count,
+		size_t *capacity,
+		size_t needed
+) {
+	if (needed <= *capacity) return;
+
+	size_t newCapacity = max(needed, 2 * *capacity);
+	T *grown = new T[newCapacity];
+	if (count > 0) {
+		memcpy(grown, *buffer, count * sizeof(T));
+	}
+	delete[] *buffer;
+	*buffer 	= grown;
+	*capacity 	= newCapacity;
+}
+
+
+
+Codec::Codec() : 
+	append_(false), 
+	bytes_(NULL), byteCount_(0), byteCapacity_(0),
+	doubles_(NULL), doubleCount_(0), doubleCapacity_(0)
+{}
+
+
+
+Codec::~Codec() {
+	delete[] bytes_;
+	delete[] doubles_;
+}
+
+
+
+void Codec::setAppend(
+		bool append
+) {
+	append_ = append;
+}
+
+
+
+void Codec::clear() {
+	byteCount_ 		= 0;
+	doubleCount_ 	= 0;
+}
+
+
+
+unsigned char *Codec::reserveBytes(
+		size_t n
+) {
+	if (!append_) byteCount_ = 0;
+	growBuffer(&bytes_, byteCount_, &byteCapacity_, byteCount_ + n);
+	return bytes_ + byteCount_;
+}
+
+
+
+double *Codec::reserveDoubles(
+		size_t n
+) {
+	if (!append_) doubleCount_ = 0;
+	growBuffer(&doubles_, doubleCount_, &doubleCapacity_, doubleCount_ + n);
+	return doubles_ + doubleCount_;
+}
+
+
+
+Span<const unsigned char> Codec::commitBytes(
+		size_t n
+) {
+	Span<const unsigned char> span = { bytes_ + byteCount_, n };
+	byteCount_ += n;
+	return span;
+}
+
+
+
+Span<const double> Codec::commitDoubles(
+		size_t n
+) {
+	Span<const double> span = { doubles_ + doubleCount_, n };
+	doubleCount_ += n;
+	return span;
+}
+
+
+
+Span<const unsigned char> Codec::encodeLinear(
+		const double *data, 
+		size_t dataSize, 
+		double fixedPoint
+) {
+	unsigned char *result = reserveBytes(dataSize * 5 + 8);
+	return commitBytes(MSNumpress::encodeLinear(data, dataSize, result, fixedPoint));
+}
+
+
+
+Span<const unsigned char> Codec::encodePic(
+		const double *data, 
+		size_t dataSize
+) {
+	unsigned char *result = reserveBytes(dataSize * 5);
+	return commitBytes(MSNumpress::encodePic(data, dataSize, result));
+}
+
+
+
+Span<const unsigned char> Codec::encodeSlof(
+		const double *data, 
+		size_t dataSize, 
+		double fixedPoint
+) {
+	unsigned char *result = reserveBytes(dataSize * 2 + 8);
+	return commitBytes(MSNumpress::encodeSlof(data, dataSize, result, fixedPoint));
+}
+
+
+
+Span<const unsigned char> Codec::encodeSafe(
+		const double *data, 
+		size_t dataSize
+) {
+	unsigned char *result = reserveBytes(dataSize * 8);
+	return commitBytes(MSNumpress::encodeSafe(data, dataSize, result));
+}
+
+
+
+Span<const double> Codec::decodeLinear(
+		const unsigned char *data, 
+		size_t dataSize
+) {
+	double *result = reserveDoubles(dataSize > 8 ? (dataSize - 8) * 2 : 0);
+	return commitDoubles(MSNumpress::decodeLinear(data, dataSize, result));
+}
+
+
+
+Span<const double> Codec::decodePic(
+		const unsigned char *data, 
+		size_t dataSize
+) {
+	double *result = reserveDoubles(dataSize * 2);
+	return commitDoubles(MSNumpress::decodePic(data, dataSize, result));
+}
+
+
+
+Span<const double> Codec::decodeSlof(
+		const unsigned char *data, 
+		size_t dataSize
+) {
+	double *result = reserveDoubles(dataSize > 8 ? (dataSize - 7) / 2 : 0);
+	return commitDoubles(MSNumpress::decodeSlof(data, dataSize, result));
+}
+
+
+
+Span<const double> Codec::decodeSafe(
+		const unsigned char *data, 
+		size_t dataSize
+) {
+	double *result = reserveDoubles(dataSize / 8);
+	return commitDoubles(MSNumpress::decodeSafe(data, dataSize, result));
+}
+
+
+
+Span<const unsigned char> Codec::bytes() const {
+	Span<const unsigned char> span = { bytes_, byteCount_ };
+	return span;
+}
+
+
+
+Span<const double> Codec::doubles() const {
+	Span<const double> span = { doubles_, doubleCount_ };
+	return span;
+}
+
+/////////////////////////////////////////////////////////////
+
+const size_t StreamEncoder::BUFFER_SIZE;
+
+StreamEncoder::StreamEncoder(
+		ByteSink sink,
+		void *context
+) : 
+	sink_(sink), context_(context), 
+	acc_(0), bits_(0), count_(0), size_(0), emitted_(0)
+{}
+
+
+
+void StreamEncoder::flush() {
+	if (size_ > 0) {
+		sink_(context_, buffer_, size_);
+		emitted_ += size_;
+		size_ = 0;
+	}
+}
+
+
+
+// flushWord needs room for a whole word
+void StreamEncoder::emitIfFull() {
+	if (size_ + 16 > BUFFER_SIZE) {
+		flush();
+	}
+}
+
+
+
+size_t StreamEncoder::finish() {
+	HalfByteWriter writer;
+	writer.acc 	= acc_;
+	writer.bits = bits_;
+	writer.finish(buffer_, &size_);
+	acc_ 	= 0;
+	bits_ 	= 0;
+	flush();
+	return emitted_;
+}
+
+
+
+LinearEncoder::LinearEncoder(
+		double fixedPoint,
+		ByteSink sink,
+		void *context
+) : 
+	StreamEncoder(sink, context), 
+	fixedPoint_(fixedPoint)
+{
+	encodeFixedPoint(fixedPoint, buffer_);
+	size_ = 8;
+}
+
+
+
+void LinearEncoder::push(
+		const double *data,
+		size_t dataSize
+) {
+	HalfByteWriter writer;
+	writer.acc 	= acc_;
+	writer.bits = bits_;
+
+	for (size_t i=0; i<dataSize; i++, count_++) {
+		if (count_ < 2) {
+			// the first two values are stored as they are
+			ints_[count_ + 1] = static_cast<long long>(data[i] * fixedPoint_ + 0.5);
+			for (size_t j=0; j<4; j++) {
+				buffer_[size_++] = (ints_[count_ + 1] >> (j*8)) & 0xff;
+			}
+		} else {
+			writer.put(static_cast<unsigned int>(linearResidual(data[i], fixedPoint_, ints_)));
+			writer.flushWord(buffer_, &size_);
+		}
+		emitIfFull();
+	}
+
+	acc_ 	= writer.acc;
+	bits_ 	= writer.bits;
+}
+
+
+
+PicEncoder::PicEncoder(
+		ByteSink sink,
+		void *context
+) : 
+	StreamEncoder(sink, context)
+{}
+
+
+
+void PicEncoder::push(
+		const double *data,
+		size_t dataSize
+) {
+	HalfByteWriter writer;
+	writer.acc 	= acc_;
+	writer.bits = bits_;
+
+	for (size_t i=0; i<dataSize; i++, count_++) {
+		writer.put(picInt(data[i]));
+		writer.flushWord(buffer_, &size_);
+		emitIfFull();
+	}
+
+	acc_ 	= writer.acc;
+	bits_ 	= writer.bits;
+}
+
+
+/**
+ * Decodes the ints in the pending bytes, from position from on, followed by
+ * the size new bytes, as far as decodeIntTiles can without knowing what 
+ * comes next, and passes every block to emit. Only the first 16 new bytes 
+ * are copied to join the pending ones: decodeIntTiles then stops at least 
+ * 9 bytes into them, and continues on the new bytes themselves. The bytes 
+ * of the ints left are pending afterwards.
+ */
+template <typename Emit>
+static void decodeStreamInts(
+		std::vector<unsigned char> &pending,
+		size_t from,
+		size_t *half,
+		const unsigned char *bytes,
+		size_t size,
+		Emit emit
+) {
+	unsigned int ints[INT_BLOCK];
+	size_t di = from;
+	size_t n;
+
+	if (!pending.empty()) {
+		size_t old = pending.size();
+		size_t joined = min(size, static_cast<size_t>(16));
+		pending.insert(pending.end(), bytes, bytes + joined);
+		do {
+			n = decodeIntTiles(pending.data(), pending.size(), &di, half, ints, INT_BLOCK);
+			emit(ints, n);
+		} while (n == INT_BLOCK);
+
+		if (joined == size) {
+			pending.erase(pending.begin(), pending.begin() + di);
+			return;
+		}
+		di -= old;
+	}
+
+	do {
+		n = decodeIntTiles(bytes, size, &di, half, ints, INT_BLOCK);
+		emit(ints, n);
+	} while (n == INT_BLOCK);
+	pending.assign(bytes + di, bytes + size);
+}
+
+
+
+/**
+ * Decodes the ints left in the pending bytes, from position from on
+ */
+template <typename Emit>
+static void finishStreamInts(
+		std::vector<unsigned char> &pending,
+		size_t from,
+		size_t *half,
+		Emit emit
+) {
+	unsigned int ints[INT_BLOCK];
+	size_t di = from;
+	size_t n;
+	do {
+		n = decodeIntBlock(pending.data(), pending.size(), &di, half, ints, INT_BLOCK);
+		emit(ints, n);
+	} while (n == INT_BLOCK);
+	pending.clear();
+}
+
+
+
+StreamDecoder::StreamDecoder() : 
+	half_(0), count_(0)
+{}
+
+
+
+LinearDecoder::LinearDecoder() : 
+	StreamDecoder(),
+	fixedPoint_(0)
+{}
+
+
+
+void LinearDecoder::push(
+		const unsigned char *bytes,
+		size_t size,
+		std::vector<double> &result
+) {
+	size_t from = 0;
+	if (count_ < 2) {
+		// the header is collected in pending_ first
+		size_t taken = min(size, 16 - pending_.size());
+		pending_.insert(pending_.end(), bytes, bytes + taken);
+		bytes 	+= taken;
+		size 	-= taken;
+		if (pending_.size() < 16) return;
+
+		decodedCountLinear(pending_.data(), 16);
+		fixedPoint_ = decodeFixedPoint(pending_.data());
+		ints_[0] = linearHeaderInt(pending_.data(), 0);
+		ints_[1] = linearHeaderInt(pending_.data(), 1);
+		result.push_back(ints_[0] / fixedPoint_);
+		result.push_back(ints_[1] / fixedPoint_);
+		count_ = 2;
+		from = 16;
+		if (size == 0) {
+			pending_.clear();
+			return;
+		}
+	}
+
+	LinearValuesFn linearValues = kernels().linearValues;
+	decodeStreamInts(pending_, from, &half_, bytes, size, 
+		[&](const unsigned int *diffs, size_t n) {
+			result.resize(result.size() + n);
+			linearValues(diffs, n, ints_, fixedPoint_, result.data() + result.size() - n);
+			count_ += n;
+		});
+}
+
+
+
+void LinearDecoder::finish(
+		std::vector<double> &result
+) {
+	if (count_ < 2) {
+		// an array of fewer than 2 values
+		double values[1];
+		size_t n = decodeLinear(pending_.data(), pending_.size(), values);
+		result.insert(result.end(), values, values + n);
+		count_ = n;
+		pending_.clear();
+		return;
+	}
+
+	LinearValuesFn linearValues = kernels().linearValues;
+	finishStreamInts(pending_, 0, &half_, 
+		[&](const unsigned int *diffs, size_t n) {
+			result.resize(result.size() + n);
+			linearValues(diffs, n, ints_, fixedPoint_, result.data() + result.size() - n);
+			count_ += n;
+		});
+}
+
+
+
+PicDecoder::PicDecoder() : 
+	StreamDecoder()
+{}
+
+
+
+// appends the ints as values
+static void appendPicValues(
+		const unsigned int *ints,
+		size_t n,
+		std::vector<double> &result
+) {
+	size_t ri = result.size();
+	result.resize(ri + n);
+	for (size_t i=0; i<n; i++) {
+		result[ri + i] = static_cast<double>(ints[i]);
+	}
+}
+
+
+
+void PicDecoder::push(
+		const unsigned char *bytes,
+		size_t size,
+		std::vector<double> &result
+) {
+	decodeStreamInts(pending_, 0, &half_, bytes, size, 
+		[&](const unsigned int *ints, size_t n) {
+			appendPicValues(ints, n, result);
+			count_ += n;
+		});
+}
+
+
+
+void PicDecoder::finish(
+		std::vector<double> &result
+) {
+	finishStreamInts(pending_, 0, &half_, 
+		[&](const unsigned int *ints, size_t n) {
+			appendPicValues(ints, n, result);
+			count_ += n;
+		});
+}
+
+
+
+SlofDecoder::SlofDecoder() : 
+	StreamDecoder(),
+	fixedPoint_(0),
+	header_(false)
+{}
+
+
+
+void SlofDecoder::push(
+		const unsigned char *bytes,
+		size_t size,
+		std::vector<double> &result
+) {
+	// pending_ holds the fixed point until it is complete, then an odd byte
+	if (!header_) {
+		size_t taken = min(size, 8 - pending_.size());
+		pending_.insert(pending_.end(), bytes, bytes + taken);
+		bytes 	+= taken;
+		size 	-= taken;
+		if (pending_.size() < 8) return;
+
+		fixedPoint_ = decodeFixedPoint(pending_.data());
+		header_ 	= true;
+		pending_.clear();
+	}
+	if (size == 0) return;
+
+	size_t ri = result.size();
+	if (!pending_.empty()) {
+		unsigned char code[2] = { pending_[0], bytes[0] };
+		result.resize(ri + 1);
+		slofValues(code, 1, fixedPoint_, SlofTable(), &result[ri]);
+		count_++;
+		ri++;
+		bytes++;
+		size--;
+	}
+
+	size_t n = size / 2;
+	result.resize(ri + n);
+	slofValues(bytes, n, fixedPoint_, slofTable(fixedPoint_, n), result.data() + ri);
+	count_ += n;
+	pending_.assign(bytes + 2*n, bytes + size);
+}
+
+
+
+void SlofDecoder::finish(
+		std::vector<double> &
+) {
+	if (!header_) 
+		throw "[MSNumpress::decodeSlof] Corrupt input data: not enough bytes to read fixed point! ";
+	pending_.clear();
+}
+
+/////////////////////////////////////////////////////////////
+
+const size_t DecodeIterator::BATCH_SIZE;
+
+enum LazyCodec {
+	LAZY_LINEAR,
+	LAZY_PIC,
+	LAZY_SLOF
+};
+
+// index of the end iterator
+static const size_t END_INDEX = static_cast<size_t>(-1);
+
+
+
+/**
+ * The decoder behind a DecodeIterator, shared by its copies until one of 
+ * them refills
+ */
+struct DecodeIterator::State {
+	int codec;
+	const unsigned char *data;
+	size_t dataSize;
+	size_t di, half;
+	long long ints[2];
+	double fixedPoint;
+	std::shared_ptr<const std::vector<double> > table;
+	double batch[BATCH_SIZE];
+
+	// decodes the next batch, returns the number of values in it
+	size_t refill();
+};
+
+
+
+DecodeIterator::DecodeIterator() : 
+	value_(NULL), last_(NULL), index_(END_INDEX)
+{}
+
+
+
+DecodeIterator::DecodeIterator(
+		int codec,
+		const unsigned char *data,
+		size_t dataSize
+) : 
+	state_(std::make_shared<State>()), value_(NULL), last_(NULL), index_(0)
+{
+	State &state 	= *state_;
+	state.codec 	= codec;
+	state.data 		= data;
+	state.dataSize 	= dataSize;
+	state.di 		= 0;
+	state.half 		= 0;
+	state.fixedPoint = 0;
+
+	if (codec == LAZY_LINEAR) {
+		// the first two values, checked as decodeLinear does
+		size_t n = decodeLinear(data, min(dataSize, static_cast<size_t>(16)), state.batch);
+		if (n == 0) {
+			index_ = END_INDEX;
+			return;
+		}
+
+		state.fixedPoint = decodeFixedPoint(data);
+		for (size_t i=0; i<2; i++) {
+			state.ints[i] = 0;
+			for (size_t j=0; j<4 && n == 2; j++) {
+				state.ints[i] |= static_cast<long long>(data[8 + 4*i + j]) << (j*8);
+			}
+		}
+		state.di 	= 16;
+		value_ 		= state.batch;
+		last_ 		= state.batch + n;
+		return;
+	}
+
+	if (codec == LAZY_SLOF) {
+		if (dataSize < 8) 
+			throw "[MSNumpress::decodeSlof] Corrupt input data: not enough bytes to read fixed point! ";
+		state.fixedPoint 	= decodeFixedPoint(data);
+		state.table 		= slofTable(state.fixedPoint, (dataSize - 8) / 2);
+		state.di 			= 8;
+	}
+	refill();
+}
+
+
+
+void DecodeIterator::refill() {
+	// leave the batch to the copies still reading it
+	if (state_.use_count() > 1) {
+		state_ = std::make_shared<State>(*state_);
+	}
+	size_t n = state_->refill();
+	value_ 	= state_->batch;
+	last_ 	= state_->batch + n;
+	if (n == 0) {
+		index_ = END_INDEX;
+	}
+}
+
+
+
+size_t DecodeIterator::State::refill() {
+	unsigned int codes[BATCH_SIZE];
+	size_t i, n = 0;
+
+	switch (codec) {
+		case LAZY_LINEAR: 
+			n = decodeIntBlock(data, dataSize, &di, &half, codes, BATCH_SIZE);
+			kernels().linearValues(codes, n, ints, fixedPoint, batch);
+			break;
+
+		case LAZY_PIC:
+			n = decodeIntBlock(data, dataSize, &di, &half, codes, BATCH_SIZE);
+			for (i=0; i<n; i++) {
+				batch[i] = static_cast<double>(codes[i]);
+			}
+			break;
+
+		case LAZY_SLOF:
+			n = min(BATCH_SIZE, (dataSize - di) / 2);
+			slofValues(data + di, n, fixedPoint, table, batch);
+			di += 2*n;
+			break;
+	}
+	return n;
+}
+
+
+
+DecodeRange::DecodeRange(
+		int codec,
+		const unsigned char *data,
+		size_t dataSize
+) : 
+	codec_(codec), data_(data), dataSize_(dataSize)
+{
+	// throw at once on a corrupt header
+	DecodeIterator(codec, data, dataSize);
+}
+
+
+
+DecodeRange decodeLinearLazy(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	return DecodeRange(LAZY_LINEAR, data, dataSize);
+}
+
+
+
+DecodeRange decodePicLazy(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	return DecodeRange(LAZY_PIC, data, dataSize);
+}
+
+
+
+DecodeRange decodeSlofLazy(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	return DecodeRange(LAZY_SLOF, data, dataSize);
+}
+
+/////////////////////////////////////////////////////////////
+
+/**
+ * Returns the maximal number of bytes the batch codec writes for n values
+ */
+static size_t maxEncodedSize(
+		BatchCodec codec,
+		size_t n
+) {
+	switch (codec) {
+		case BATCH_LINEAR: 	return n * 5 + 8;
+		case BATCH_PIC: 	return n * 5;
+		case BATCH_SLOF: 	return n * 2 + 8;
+		case BATCH_SAFE: 	return n * 8;
+	}
+	throw "[MSNumpress::encodeBatch] Unknown codec.";
+}
+
+
+
+/**
+ * Encodes one array with the batch codec, choosing the fixed point for it
+ */
+static size_t encodeArray(
+		BatchCodec codec,
+		const double *data,
+		size_t n,
+		unsigned char *result
+) {
+	double fixedPoint;
+	switch (codec) {
+		case BATCH_LINEAR: 	
+			return encodeLinearAuto(data, n, result, &fixedPoint);
+		case BATCH_PIC: 	
+			return encodePic(data, n, result);
+		case BATCH_SLOF: 	
+			fixedPoint = optimalSlofFixedPoint(data, n);
+			return encodeSlof(data, n, result, fixedPoint);
+		case BATCH_SAFE: 	
+			return encodeSafe(data, n, result);
+	}
+	throw "[MSNumpress::encodeBatch] Unknown codec.";
+}
+
+
+
+/**
+ * Returns the number of values the batch codec decodes from one array
+ */
+static size_t decodedCount(
+		BatchCodec codec,
+		const unsigned char *data,
+		size_t n
+) {
+	switch (codec) {
+		case BATCH_LINEAR: 	
+			return decodedCountLinear(data, n);
+		case BATCH_PIC: 	
+			return decodedCountPic(data, n);
+		case BATCH_SLOF: 	
+			if (n < 8 || n % 2 != 0) 
+				throw "[MSNumpress::decodeSlof] Corrupt input data: not a fixed point followed by 2 byte values! ";
+			return (n - 8) / 2;
+		case BATCH_SAFE: 	
+			if (n % 8 != 0) 
+				throw "[MSNumpress::decodeSafe] Corrupt input data: number of bytes needs to be multiple of 8! ";
+			return n / 8;
+	}
+	throw "[MSNumpress::decodeBatch] Unknown codec.";
+}
+
+
+
+static size_t decodeArray(
+		BatchCodec codec,
+		const unsigned char *data,
+		size_t n,
+		double *result
+) {
+	switch (codec) {
+		case BATCH_LINEAR: 	return decodeLinear(data, n, result);
+		case BATCH_PIC: 	return decodePic(data, n, result);
+		case BATCH_SLOF: 	return decodeSlof(data, n, result);
+		case BATCH_SAFE: 	return decodeSafe(data, n, result);
+	}
+	throw "[MSNumpress::decodeBatch] Unknown codec.";
+}
+
+
+
+size_t maxEncodedBatchSize(
+		BatchCodec codec,
+		const size_t *offsets,
+		size_t count
+) {
+	return maxEncodedSize(codec, offsets[count] - offsets[0]) + count * maxEncodedSize(codec, 0);
+}
+
+
+
+size_t encodeBatch(
+		BatchCodec codec,
+		const double *data,
+		const size_t *offsets,
+		size_t count,
+		unsigned char *result,
+		size_t *resultOffsets,
+		size_t threads
+) {
+	// every array is encoded at the offset its maximal size would give it...
+	resultOffsets[0] = 0;
+	for (size_t k=0; k<count; k++) {
+		resultOffsets[k+1] = resultOffsets[k] + maxEncodedSize(codec, offsets[k+1] - offsets[k]);
+	}
+
+	std::vector<size_t> sizes(count);
+	parallelFor(count, threads, [&](size_t k) {
+		sizes[k] = encodeArray(codec, data + offsets[k], offsets[k+1] - offsets[k], result + resultOffsets[k]);
+	});
+
+	// ...and then moved down in order, so the result does not depend on 
+	// which thread encoded what
+	size_t ri = 0;
+	for (size_t k=0; k<count; k++) {
+		memmove(result + ri, result + resultOffsets[k], sizes[k]);
+		resultOffsets[k] = ri;
+		ri += sizes[k];
+	}
+	resultOffsets[count] = ri;
+	return ri;
+}
+
+
+
+size_t decodedCountBatch(
+		BatchCodec codec,
+		const unsigned char *data,
+		const size_t *offsets,
+		size_t count,
+		size_t *resultOffsets,
+		size_t threads
+) {
+	resultOffsets[0] = 0;
+	parallelFor(count, threads, [&](size_t k) {
+		resultOffsets[k+1] = decodedCount(codec, data + offsets[k], offsets[k+1] - offsets[k]);
+	});
+	for (size_t k=0; k<count; k++) {
+		resultOffsets[k+1] += resultOffsets[k];
+	}
+	return resultOffsets[count];
+}
+
+
+
+void decodeBatch(
+		BatchCodec codec,
+		const unsigned char *data,
+		const size_t *offsets,
+		size_t count,
+		double *result,
+		const size_t *resultOffsets,
+		size_t threads
+) {
+	parallelFor(count, threads, [&](size_t k) {
+		size_t n = offsets[k+1] - offsets[k];
+		if (resultOffsets[k+1] - resultOffsets[k] != decodedCount(codec, data + offsets[k], n)) 
+			throw "[MSNumpress::decodeBatch] Result offsets do not match the data! ";
+		decodeArray(codec, data + offsets[k], n, result + resultOffsets[k]);
+	});
+}
+
+
+
+void encodeBatch(
+		BatchCodec codec,
+		const std::vector<double> &data,
+		const std::vector<size_t> &offsets,
+		std::vector<unsigned char> &result,
+		std::vector<size_t> &resultOffsets,
+		size_t threads
+) {
+	size_t count = offsets.size() - 1;
+	result.resize(maxEncodedBatchSize(codec, &offsets[0], count));
+	resultOffsets.resize(count + 1);
+	size_t encodedLength = encodeBatch(codec, data.empty() ? NULL : &data[0], &offsets[0], count, 
+			result.empty() ? NULL : &result[0], &resultOffsets[0], threads);
+	result.resize(encodedLength);
+}
+
+
+
+void decodeBatch(
+		BatchCodec codec,
+		const std::vector<unsigned char> &data,
+		const std::vector<size_t> &offsets,
+		std::vector<double> &result,
+		std::vector<size_t> &resultOffsets,
+		size_t threads
+) {
+	size_t count = offsets.size() - 1;
+	const unsigned char *bytes = data.empty() ? NULL : &data[0];
+	resultOffsets.resize(count + 1);
+	result.resize(decodedCountBatch(codec, bytes, &offsets[0], count, &resultOffsets[0], threads));
+	decodeBatch(codec, bytes, &offsets[0], count, result.empty() ? NULL : &result[0], &resultOffsets[0], threads);
+}
+
+
+
+/////////////////////////////////////////////////////////////
+
+static const char BASE64_CHARS[] = 
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// the value of every base64 character, 0xff for the bytes that are none
+static const unsigned char BASE64_VALUE[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+	0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/**
+ * Decodes the n base64 characters in text, n a multiple of 4 and without 
+ * padding, into 3n/4 bytes. Returns false if a character is not base64.
+ */
+static bool base64DecodeScalar(
+		const char *text,
+		size_t n,
+		unsigned char *result
+) {
+	const unsigned char *t = reinterpret_cast<const unsigned char*>(text);
+	for (size_t i=0; i<n; i+=4) {
+		unsigned int a = BASE64_VALUE[t[i]];
+		unsigned int b = BASE64_VALUE[t[i+1]];
+		unsigned int c = BASE64_VALUE[t[i+2]];
+		unsigned int d = BASE64_VALUE[t[i+3]];
+		if ((a | b | c | d) & 0x80) return false;
+
+		unsigned int x = (a << 18) | (b << 12) | (c << 6) | d;
+		*result++ = static_cast<unsigned char>(x >> 16);
+		*result++ = static_cast<unsigned char>(x >> 8);
+		*result++ = static_cast<unsigned char>(x);
+	}
+	return true;
+}
+
+
+
+/**
+ * Encodes the n bytes in data, n a multiple of 3, as 4n/3 base64 characters
+ */
+static void base64EncodeScalar(
+		const unsigned char *data,
+		size_t n,
+		char *result
+) {
+	for (size_t i=0; i<n; i+=3) {
+		unsigned int x = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+		*result++ = BASE64_CHARS[x >> 18];
+		*result++ = BASE64_CHARS[(x >> 12) & 0x3f];
+		*result++ = BASE64_CHARS[(x >> 6) & 0x3f];
+		*result++ = BASE64_CHARS[x & 0x3f];
+	}
+}
+
+#if MSNUMPRESS_X86
+
+// The vector base64 codecs follow W. Mula and D. Lemire, "Faster Base64 
+// Encoding and Decoding Using AVX2 Instructions" (2018): characters are 
+// validated and mapped to their values by lookups on their halfbytes, and 
+// the 6 bit values are packed with multiply-adds (and the other way round).
+
+MSNUMPRESS_TARGET("sse4.2")
+static bool base64DecodeSSE42(
+		const char *text,
+		size_t n,
+		unsigned char *result
+) {
+	const __m128i lutLo 	= _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 
+										0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m128i lutHi 	= _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 
+										0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lutRoll 	= _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i order 	= _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m128i halfByte 	= _mm_set1_epi8(0x0f);
+
+	// 16 bytes are stored for the 12 decoded from 16 characters
+	size_t i = 0;
+	for (; i + 32 <= n; i += 16) {
+		__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+		__m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), halfByte);
+		__m128i lo = _mm_and_si128(in, halfByte);
+		if (!_mm_testz_si128(_mm_shuffle_epi8(lutLo, lo), _mm_shuffle_epi8(lutHi, hi))) break;
+
+		__m128i slash 	= _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+		__m128i values 	= _mm_add_epi8(in, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(slash, hi)));
+		__m128i pairs 	= _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+		__m128i words 	= _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(result + i / 4 * 3), _mm_shuffle_epi8(words, order));
+	}
+	return base64DecodeScalar(text + i, n - i, result + i / 4 * 3);
+}
+
+
+
+MSNUMPRESS_TARGET("sse4.2")
+static void base64EncodeSSE42(
+		const unsigned char *data,
+		size_t n,
+		char *result
+) {
+	const __m128i order 	= _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i lutShift 	= _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+										'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+										'+' - 62, '/' - 63, 'A', 0, 0);
+
+	// 16 bytes are loaded for the 12 encoded as 16 characters
+	size_t i = 0;
+	for (; i + 16 <= n; i += 12) {
+		__m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), order);
+		__m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		__m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		__m128i values = _mm_or_si128(ac, bd);
+
+		__m128i shift = _mm_subs_epu8(values, _mm_set1_epi8(51));
+		shift = _mm_or_si128(shift, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), values), _mm_set1_epi8(13)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(result + i / 3 * 4), 
+			_mm_add_epi8(values, _mm_shuffle_epi8(lutShift, shift)));
+	}
+	base64EncodeScalar(data + i, n - i, result + i / 3 * 4);
+}
+
+
+
+MSNUMPRESS_TARGET("avx2")
+static bool base64DecodeAVX2(
+		const char *text,
+		size_t n,
+		unsigned char *result
+) {
+	const __m256i lutLo 	= _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 
+										0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+										0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 
+										0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m256i lutHi 	= _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 
+										0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+										0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 
+										0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lutRoll 	= _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+										0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i order 	= _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+										2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i lanes 	= _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+	const __m256i halfByte 	= _mm256_set1_epi8(0x0f);
+
+	// 32 bytes are stored for the 24 decoded from 32 characters
+	size_t i = 0;
+	for (; i + 64 <= n; i += 32) {
+		__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), halfByte);
+		__m256i lo = _mm256_and_si256(in, halfByte);
+		if (!_mm256_testz_si256(_mm256_shuffle_epi8(lutLo, lo), _mm256_shuffle_epi8(lutHi, hi))) break;
+
+		__m256i slash 	= _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+		__m256i values 	= _mm256_add_epi8(in, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(slash, hi)));
+		__m256i pairs 	= _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+		__m256i words 	= _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+		__m256i bytes 	= _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, order), lanes);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i / 4 * 3), bytes);
+	}
+	return base64DecodeSSE42(text + i, n - i, result + i / 4 * 3);
+}
+
+
+
+MSNUMPRESS_TARGET("avx2")
+static void base64EncodeAVX2(
+		const unsigned char *data,
+		size_t n,
+		char *result
+) {
+	const __m256i order 	= _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+										10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i lutShift 	= _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+										'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+										'+' - 62, '/' - 63, 'A', 0, 0,
+										'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+										'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+										'+' - 62, '/' - 63, 'A', 0, 0);
+
+	// every lane loads 16 bytes for the 12 it encodes
+	size_t i = 0;
+	for (; i + 28 <= n; i += 24) {
+		__m256i in = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12)), 1);
+		in = _mm256_shuffle_epi8(in, order);
+		__m256i ac = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		__m256i bd = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		__m256i values = _mm256_or_si256(ac, bd);
+
+		__m256i shift = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+		shift = _mm256_or_si256(shift, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), values), _mm256_set1_epi8(13)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i / 3 * 4), 
+			_mm256_add_epi8(values, _mm256_shuffle_epi8(lutShift, shift)));
+	}
+	base64EncodeSSE42(data + i, n - i, result + i / 3 * 4);
+}
+
+#endif
+
+
+
+// base64 characters decoded at a time by the fused decoders
+static const size_t BASE64_TILE = 4096;
+
+/**
+ * Decodes base64 text into bytes a tile at a time, keeping the bytes the 
+ * caller has not used yet at the front of the tile. The text may end with
+ * padding or leave it out, but may not contain anything else.
+ */
+struct Base64Tiles {
+	const char *text;
+	size_t quadChars;
+	size_t tailChars;
+	size_t ti;
+	size_t size;
+	bool last;
+	unsigned char bytes[BASE64_TILE / 4 * 3 + 16];
+
+	Base64Tiles(const char *text_, size_t textSize) 
+			: text(text_), ti(0), size(0), last(false) {
+		if (textSize % 4 == 0 && textSize > 0 && text[textSize - 1] == '=') {
+			textSize -= (text[textSize - 2] == '=') ? 2 : 1;
+		}
+		if (textSize % 4 == 1) 
+			throw "[MSNumpress::decodeBase64] Corrupt input data: impossible base64 length! ";
+		quadChars = textSize / 4 * 4;
+		tailChars = textSize % 4;
+	}
+
+	// the number of bytes the whole text decodes to
+	size_t byteCount() const {
+		return quadChars / 4 * 3 + (tailChars > 0 ? tailChars - 1 : 0);
+	}
+
+	// moves the bytes from from on to the front and decodes the next tile 
+	// after them
+	void refill(size_t from) {
+		size_t keep = size - from;
+		memmove(bytes, bytes + from, keep);
+		size = keep;
+
+		size_t chars = min(BASE64_TILE, quadChars - ti);
+		if (!kernels().base64Decode(text + ti, chars, bytes + size)) 
+			throw "[MSNumpress::decodeBase64] Corrupt input data: not a base64 character! ";
+		ti += chars;
+		size += chars / 4 * 3;
+
+		if (ti == quadChars) {
+			const unsigned char *t = reinterpret_cast<const unsigned char*>(text + ti);
+			unsigned int x = 0;
+			for (size_t i=0; i<tailChars; i++) {
+				if (BASE64_VALUE[t[i]] & 0x80) 
+					throw "[MSNumpress::decodeBase64] Corrupt input data: not a base64 character! ";
+				x |= BASE64_VALUE[t[i]] << (18 - 6 * i);
+			}
+			for (size_t i=1; i<tailChars; i++) {
+				bytes[size++] = static_cast<unsigned char>(x >> (24 - 8 * i));
+			}
+			last = true;
+		}
+	}
+};
+
+
+
+/**
+ * Base64 encodes the bytes passed to put, as a ByteSink would get them
+ */
+struct Base64Writer {
+	char *result;
+	size_t ri;
+	unsigned char carry[3];
+	size_t carrySize;
+
+	explicit Base64Writer(char *result_) 
+			: result(result_), ri(0), carrySize(0) {
+	}
+
+	void put(const unsigned char *bytes, size_t size) {
+		if (carrySize > 0) {
+			while (carrySize < 3 && size > 0) {
+				carry[carrySize++] = *bytes++;
+				size--;
+			}
+			if (carrySize < 3) return;
+			base64EncodeScalar(carry, 3, result + ri);
+			ri += 4;
+			carrySize = 0;
+		}
+
+		size_t whole = size / 3 * 3;
+		kernels().base64Encode(bytes, whole, result + ri);
+		ri += whole / 3 * 4;
+
+		carrySize = size - whole;
+		memcpy(carry, bytes + whole, carrySize);
+	}
+
+	// pads the last bytes, returns the number of characters
+	size_t finish() {
+		if (carrySize > 0) {
+			carry[1] = (carrySize > 1) ? carry[1] : 0;
+			carry[2] = 0;
+			base64EncodeScalar(carry, 3, result + ri);
+			result[ri + 3] = '=';
+			if (carrySize == 1) result[ri + 2] = '=';
+			ri += 4;
+			carrySize = 0;
+		}
+		return ri;
+	}
+};
+
+static void base64WriterSink(
+		void *context, 
+		const unsigned char *bytes, 
+		size_t size
+) {
+	static_cast<Base64Writer*>(context)->put(bytes, size);
+}
+
+
+
+/**
+ * Gives the fused decoders their output: the given array, or a vector that
+ * grows as needed.
+ */
+struct FixedOutput {
+	double *result;
+	double *operator()(size_t) { return result; }
+};
+
+struct VectorOutput {
+	std::vector<double> *result;
+	double *operator()(size_t needed) {
+		if (result->size() < needed) {
+			result->resize(max(needed, 2 * result->size()));
+		}
+		return result->data();
+	}
+};
+
+
+
+/**
+ * Decodes base64 text of an encodeLinear array, decoding its residuals a
+ * tile of text at a time.
+ */
+template <typename Output>
+static size_t decodeLinearBase64Into(
+		const char *text,
+		size_t textSize,
+		Output output
+) {
+	Base64Tiles tiles(text, textSize);
+	tiles.refill(0);
+
+	// a first tile holds the header, unless the array is shorter
+	size_t headerCount = decodedCountLinear(tiles.bytes, min(tiles.size, static_cast<size_t>(16)));
+	if (headerCount == 0) return 0;
+
+	double fixedPoint = decodeFixedPoint(tiles.bytes);
+	long long ints[2] = { linearHeaderInt(tiles.bytes, 0), 0 };
+	double *out = output(headerCount);
+	out[0] = ints[0] / fixedPoint;
+	if (headerCount == 1) return 1;
+
+	ints[1] = linearHeaderInt(tiles.bytes, 1);
+	out[1] = ints[1] / fixedPoint;
+
+	LinearValuesFn linearValues = kernels().linearValues;
+	unsigned int diffs[INT_BLOCK];
+	size_t di = 16;
+	size_t half = 0;
+	size_t ri = 2;
+	size_t n;
+	for (;;) {
+		do {
+			n = tiles.last ? decodeIntBlock(tiles.bytes, tiles.size, &di, &half, diffs, INT_BLOCK)
+				: decodeIntTiles(tiles.bytes, tiles.size, &di, &half, diffs, INT_BLOCK);
+			linearValues(diffs, n, ints, fixedPoint, output(ri + n) + ri);
+			ri += n;
+		} while (n == INT_BLOCK);
+
+		if (tiles.last) return ri;
+		tiles.refill(di);
+		di = 0;
+	}
+}
+
+
+
+/**
+ * Decodes base64 text of an encodePic array a tile of text at a time
+ */
+template <typename Output>
+static size_t decodePicBase64Into(
+		const char *text,
+		size_t textSize,
+		Output output
+) {
+	Base64Tiles tiles(text, textSize);
+	tiles.refill(0);
+
+	unsigned int ints[INT_BLOCK];
+	size_t di = 0;
+	size_t half = 0;
+	size_t ri = 0;
+	size_t n;
+	for (;;) {
+		do {
+			n = tiles.last ? decodeIntBlock(tiles.bytes, tiles.size, &di, &half, ints, INT_BLOCK)
+				: decodeIntTiles(tiles.bytes, tiles.size, &di, &half, ints, INT_BLOCK);
+			double *out = output(ri + n) + ri;
+			for (size_t i=0; i<n; i++) {
+				out[i] = static_cast<double>(ints[i]);
+			}
+			ri += n;
+		} while (n == INT_BLOCK);
+
+		if (tiles.last) return ri;
+		tiles.refill(di);
+		di = 0;
+	}
+}
+
+
+
+/**
+ * Decodes base64 text of an encodeSlof array a tile of text at a time
+ */
+template <typename Output>
+static size_t decodeSlofBase64Into(
+		const char *text,
+		size_t textSize,
+		Output output
+) {
+	Base64Tiles tiles(text, textSize);
+	tiles.refill(0);
+
+	if (tiles.size < 8) 
+		throw "[MSNumpress::decodeSlof] Corrupt input data: not enough bytes to read fixed point! ";
+
+	double fixedPoint = decodeFixedPoint(tiles.bytes);
+	size_t count = (tiles.byteCount() - 8) / 2;
+	SlofTable table = slofTable(fixedPoint, count);
+	size_t di = 8;
+	size_t ri = 0;
+	for (;;) {
+		size_t n = min((tiles.size - di) / 2, count - ri);
+		slofValues(tiles.bytes + di, n, fixedPoint, table, output(ri + n) + ri);
+		ri += n;
+		di += 2 * n;
+
+		if (tiles.last) return ri;
+		tiles.refill(di);
+		di = 0;
+	}
+}
+
+
+
+size_t decodeLinearBase64(
+		const char *text,
+		size_t textSize,
+		double *result
+) {
+	FixedOutput output = { result };
+	return decodeLinearBase64Into(text, textSize, output);
+}
+
+
+
+void decodeLinearBase64(
+		const char *text,
+		size_t textSize,
+		std::vector<double> &result
+) {
+	result.clear();
+	VectorOutput output = { &result };
+	result.resize(decodeLinearBase64Into(text, textSize, output));
+}
+
+
+
+size_t decodePicBase64(
+		const char *text,
+		size_t textSize,
+		double *result
+) {
+	FixedOutput output = { result };
+	return decodePicBase64Into(text, textSize, output);
+}
+
+
+
+void decodePicBase64(
+		const char *text,
+		size_t textSize,
+		std::vector<double> &result
+) {
+	result.clear();
+	VectorOutput output = { &result };
+	result.resize(decodePicBase64Into(text, textSize, output));
+}
+
+
+
+size_t decodeSlofBase64(
+		const char *text,
+		size_t textSize,
+		double *result
+) {
+	FixedOutput output = { result };
+	return decodeSlofBase64Into(text, textSize, output);
+}
+
+
+
+void decodeSlofBase64(
+		const char *text,
+		size_t textSize,
+		std::vector<double> &result
+) {
+	result.clear();
+	VectorOutput output = { &result };
+	result.resize(decodeSlofBase64Into(text, textSize, output));
+}
+
+
+
+size_t maxBase64Size(
+		size_t byteCount
+) {
+	return (byteCount + 2) / 3 * 4;
+}
+
+
+
+size_t encodeLinearBase64(
+		const double *data,
+		size_t dataSize,
+		char *result,
+		double fixedPoint
+) {
+	Base64Writer writer(result);
+	LinearEncoder encoder(fixedPoint, base64WriterSink, &writer);
+	encoder.push(data, dataSize);
+	encoder.finish();
+	return writer.finish();
+}
+
+
+
+size_t encodePicBase64(
+		const double *data,
+		size_t dataSize,
+		char *result
+) {
+	Base64Writer writer(result);
+	PicEncoder encoder(base64WriterSink, &writer);
+	encoder.push(data, dataSize);
+	encoder.finish();
+	return writer.finish();
+}
+
+
+
+size_t encodeSlofBase64(
+		const double *data,
+		size_t dataSize,
+		char *result,
+		double fixedPoint
+) {
+	unsigned char bytes[BASE64_TILE / 4 * 3];
+	Base64Writer writer(result);
+
+	encodeFixedPoint(fixedPoint, bytes);
+	writer.put(bytes, 8);
+	for (size_t i=0; i<dataSize; i+=sizeof(bytes) / 2) {
+		size_t n = min(sizeof(bytes) / 2, dataSize - i);
+		kernels().slofCodes(data + i, n, fixedPoint, bytes);
+		writer.put(bytes, 2 * n);
+	}
+	return writer.finish();
+}
+
+
+
+void encodeLinearBase64(
+		const std::vector<double> &data,
+		std::string &result,
+		double fixedPoint
+) {
+	result.resize(maxBase64Size(8 + 5 * data.size()));
+	result.resize(encodeLinearBase64(data.data(), data.size(), &result[0], fixedPoint));
+}
+
+
+
+void encodePicBase64(
+		const std::vector<double> &data,
+		std::string &result
+) {
+	result.resize(maxBase64Size(5 * data.size()));
+	result.resize(encodePicBase64(data.data(), data.size(), &result[0]));
+}
+
+
+
+void encodeSlofBase64(
+		const std::vector<double> &data,
+		std::string &result,
+		double fixedPoint
+) {
+	result.resize(maxBase64Size(8 + 2 * data.size()));
+	result.resize(encodeSlofBase64(data.data(), data.size(), &result[0], fixedPoint));
+}
+
+
+
+/////////////////////////////////////////////////////////////
+
+// tag and value count
+static const size_t PIC_SV_HEADER_SIZE = 16;
+
+// the number of data bytes of the ints with each control code
+static const unsigned char PIC_SV_LENGTH[4] = { 0, 1, 2, 4 };
+
+/**
+ * For every control byte, the number of data bytes of its 4 ints and the 
+ * shuffle that moves them to 4 little-endian 32 bit words.
+ */
+struct PicSvTables {
+	unsigned char length[256];
+	unsigned char shuffle[256][16];
+
+	PicSvTables() {
+		for (size_t c=0; c<256; c++) {
+			size_t offset = 0;
+			for (size_t k=0; k<4; k++) {
+				size_t n = PIC_SV_LENGTH[(c >> (2 * k)) & 3];
+				for (size_t b=0; b<4; b++) {
+					shuffle[c][4*k + b] = (b < n) ? static_cast<unsigned char>(offset + b) : 0x80;
+				}
+				offset += n;
+			}
+			length[c] = static_cast<unsigned char>(offset);
+		}
+	}
+};
+
+static const PicSvTables &picSvTables() {
+	static const PicSvTables tables;
+	return tables;
+}
+
+
+
+size_t maxPicSVSize(
+		size_t dataSize
+) {
+	return PIC_SV_HEADER_SIZE + (dataSize + 3) / 4 + 4 * dataSize;
+}
+
+
+
+size_t encodePicSV(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result
+) {
+	encodeFrameTag(FRAME_PIC_SV, result);
+	storeLittleEndian(dataSize, result + 8);
+
+	unsigned char *control = result + PIC_SV_HEADER_SIZE;
+	size_t controlSize = (dataSize + 3) / 4;
+	memset(control, 0, controlSize);
+
+	// all 4 bytes are written, the next int overwrites the ones not used
+	unsigned char *out = control + controlSize;
+	for (size_t i=0; i<dataSize; i++) {
+		unsigned int x = picInt(data[i]);
+		unsigned int code = (x > 0) + (x > 0xff) + (x > 0xffff);
+		control[i >> 2] |= static_cast<unsigned char>(code << (2 * (i & 3)));
+		out[0] = static_cast<unsigned char>(x);
+		out[1] = static_cast<unsigned char>(x >> 8);
+		out[2] = static_cast<unsigned char>(x >> 16);
+		out[3] = static_cast<unsigned char>(x >> 24);
+		out += PIC_SV_LENGTH[code];
+	}
+	return out - result;
+}
+
+
+
+void encodePicSV(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result
+) {
+	result.resize(maxPicSVSize(data.size()));
+	result.resize(encodePicSV(data.data(), data.size(), &result[0]));
+}
+
+
+
+/**
+ * Checks the header of the PicSV array in data, returns its number of 
+ * values and sets the number of control bytes.
+ */
+static size_t picSvHeader(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *controlSize
+) {
+	if (decodeFrameTag(data, dataSize) != FRAME_PIC_SV) 
+		throw "[MSNumpress::decodePicSV] Corrupt input data: not a PicSV array! ";
+	if (dataSize < PIC_SV_HEADER_SIZE) 
+		throw "[MSNumpress::decodePicSV] Corrupt input data: not enough bytes to read header! ";
+
+	unsigned long long count = loadLittleEndian(data + 8);
+	if (count / 4 + (count % 4 != 0) > dataSize - PIC_SV_HEADER_SIZE) 
+		throw "[MSNumpress::decodePicSV] Corrupt input data: not enough control bytes! ";
+
+	*controlSize = static_cast<size_t>((count + 3) / 4);
+	return static_cast<size_t>(count);
+}
+
+
+
+size_t decodedCountPicSV(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	size_t controlSize;
+	return picSvHeader(data, dataSize, &controlSize);
+}
+
+
+
+/**
+ * Decodes count ints from their control bytes and their dataSize data bytes
+ * into result. The data bytes have been checked to be exactly the ones the
+ * control bytes give.
+ */
+static void picSvValuesScalar(
+		const unsigned char *control,
+		const unsigned char *data,
+		size_t,
+		size_t count,
+		double *result
+) {
+	for (size_t i=0; i<count; i++) {
+		unsigned int code = (control[i >> 2] >> (2 * (i & 3))) & 3;
+		unsigned int x = 0;
+		for (size_t b=0; b<PIC_SV_LENGTH[code]; b++) {
+			x |= static_cast<unsigned int>(data[b]) << (8 * b);
+		}
+		data += PIC_SV_LENGTH[code];
+		result[i] = static_cast<double>(x);
+	}
+}
+
+#if MSNUMPRESS_X86
+
+/**
+ * Stores the 4 unsigned ints in x as doubles. cvtepi32 converts them as 
+ * signed, so 2^32 is added to the ones that come out negative.
+ */
+MSNUMPRESS_TARGET("sse4.2")
+static inline void storeUnsignedSSE42(
+		__m128i x,
+		double *result
+) {
+	const __m128d wrap = _mm_set1_pd(4294967296.0);
+	__m128d lo = _mm_cvtepi32_pd(x);
+	__m128d hi = _mm_cvtepi32_pd(_mm_srli_si128(x, 8));
+	lo = _mm_add_pd(lo, _mm_and_pd(_mm_cmplt_pd(lo, _mm_setzero_pd()), wrap));
+	hi = _mm_add_pd(hi, _mm_and_pd(_mm_cmplt_pd(hi, _mm_setzero_pd()), wrap));
+	_mm_storeu_pd(result, lo);
+	_mm_storeu_pd(result + 2, hi);
+}
+
+
+
+// 4 ints per shuffle, as long as 16 data bytes can be loaded
+MSNUMPRESS_TARGET("sse4.2")
+static void picSvValuesSSE42(
+		const unsigned char *control,
+		const unsigned char *data,
+		size_t dataSize,
+		size_t count,
+		double *result
+) {
+	const PicSvTables &tables = picSvTables();
+	const unsigned char *end = data + dataSize;
+
+	size_t i = 0;
+	for (; i + 4 <= count && data + 16 <= end; i += 4) {
+		unsigned char c = control[i >> 2];
+		__m128i in 		= _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		__m128i order 	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle[c]));
+		storeUnsignedSSE42(_mm_shuffle_epi8(in, order), result + i);
+		data += tables.length[c];
+	}
+	picSvValuesScalar(control + (i >> 2), data, end - data, count - i, result + i);
+}
+
+
+
+// 8 ints per shuffle, the two lanes loading the data of one control byte each
+MSNUMPRESS_TARGET("avx2")
+static void picSvValuesAVX2(
+		const unsigned char *control,
+		const unsigned char *data,
+		size_t dataSize,
+		size_t count,
+		double *result
+) {
+	const PicSvTables &tables = picSvTables();
+	const unsigned char *end = data + dataSize;
+	const __m256d wrap = _mm256_set1_pd(4294967296.0);
+
+	size_t i = 0;
+	for (; i + 8 <= count && data + 32 <= end; i += 8) {
+		unsigned char c0 = control[i >> 2];
+		unsigned char c1 = control[(i >> 2) + 1];
+		__m256i in = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + tables.length[c0])), 1);
+		__m256i order = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle[c0]))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle[c1])), 1);
+		__m256i x = _mm256_shuffle_epi8(in, order);
+		data += tables.length[c0] + tables.length[c1];
+
+		__m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(x));
+		__m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1));
+		lo = _mm256_add_pd(lo, _mm256_and_pd(_mm256_cmp_pd(lo, _mm256_setzero_pd(), _CMP_LT_OQ), wrap));
+		hi = _mm256_add_pd(hi, _mm256_and_pd(_mm256_cmp_pd(hi, _mm256_setzero_pd(), _CMP_LT_OQ), wrap));
+		_mm256_storeu_pd(result + i, lo);
+		_mm256_storeu_pd(result + i + 4, hi);
+	}
+	picSvValuesSSE42(control + (i >> 2), data, end - data, count - i, result + i);
+}
+
+#endif
+
+
+
+size_t decodePicSV(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result
+) {
+	size_t controlSize;
+	size_t count = picSvHeader(data, dataSize, &controlSize);
+	const unsigned char *control = data + PIC_SV_HEADER_SIZE;
+
+	// the data bytes must be exactly the ones the control bytes give, which 
+	// lets the kernels do without bounds checks
+	const PicSvTables &tables = picSvTables();
+	size_t length = 0;
+	for (size_t i=0; i<controlSize; i++) {
+		length += tables.length[control[i]];
+	}
+	size_t unused = 4 * controlSize - count;
+	if (unused > 0 && (control[controlSize - 1] >> (2 * (4 - unused))) != 0) 
+		throw "[MSNumpress::decodePicSV] Corrupt input data: control codes after the last value! ";
+	if (length != dataSize - PIC_SV_HEADER_SIZE - controlSize) 
+		throw "[MSNumpress::decodePicSV] Corrupt input data: data bytes do not match control bytes! ";
+
+	kernels().picSvValues(control, control + controlSize, length, count, result);
+	return count;
+}
+
+
+
+void decodePicSV(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result
+) {
+	result.resize(decodedCountPicSV(data.data(), data.size()));
+	decodePicSV(data.data(), data.size(), result.data());
+}
+
+
+
+/////////////////////////////////////////////////////////////
+
+// tag and value count
+static const size_t PIC_FOR_HEADER_SIZE = 16;
+
+// values per block, each with its own minimum and bit width
+static const size_t PIC_FOR_BLOCK = 128;
+
+// minimum, bit width, exception count and exception bit width
+static const size_t PIC_FOR_BLOCK_HEADER_SIZE = 7;
+
+size_t maxPicFORSize(
+		size_t dataSize
+) {
+	size_t blockCount = (dataSize + PIC_FOR_BLOCK - 1) / PIC_FOR_BLOCK;
+	return PIC_FOR_HEADER_SIZE + PIC_FOR_BLOCK_HEADER_SIZE * blockCount + 4 * dataSize;
+}
+
+
+
+/**
+ * Picks the bit width for the n offsets of a block that takes the fewest
+ * bytes, the offsets that do not fit being exceptions, and sets the number
+ * of exceptions and the bit width of their high parts.
+ */
+static unsigned int picForWidth(
+		const unsigned int *offsets,
+		size_t n,
+		size_t *exceptionCount,
+		unsigned int *exceptionWidth
+) {
+	// the number of offsets of every bit length
+	size_t lengths[33] = { 0 };
+	unsigned int longest = 0;
+	for (size_t i=0; i<n; i++) {
+		unsigned int length = (offsets[i] == 0) ? 0 : 64 - countLeadingZeros(offsets[i]);
+		lengths[length]++;
+		longest = max(longest, length);
+	}
+
+	// an exception costs its position and the bits above the width
+	unsigned int best = longest;
+	size_t bestSize = (n * longest + 7) / 8;
+	size_t above = n;
+	*exceptionCount = 0;
+	*exceptionWidth = 0;
+	for (unsigned int width=0; width<longest; width++) {
+		above -= lengths[width];
+		size_t size = (n * width + 7) / 8 + above + (above * (longest - width) + 7) / 8;
+		if (size < bestSize) {
+			best 		= width;
+			bestSize 	= size;
+			*exceptionCount = above;
+			*exceptionWidth = longest - width;
+		}
+	}
+	return best;
+}
+
+
+
+/**
+ * Packs the low width bits of the n values at out, least significant bits
+ * first, and returns the end of the packed bytes.
+ */
+static unsigned char *picForPack(
+		const unsigned int *values,
+		size_t n,
+		unsigned int width,
+		unsigned char *out
+) {
+	unsigned long long acc = 0;
+	unsigned int bits = 0;
+	unsigned long long mask = (1ULL << width) - 1;
+	for (size_t i=0; i<n; i++) {
+		acc |= (values[i] & mask) << bits;
+		bits += width;
+		while (bits >= 8) {
+			*out++ = static_cast<unsigned char>(acc);
+			acc >>= 8;
+			bits -= 8;
+		}
+	}
+	if (bits > 0) {
+		*out++ = static_cast<unsigned char>(acc);
+	}
+	return out;
+}
+
+
+
+/**
+ * Reads the i-th value of width bits from the size bytes packed by 
+ * picForPack, byte by byte.
+ */
+static unsigned long long picForUnpack(
+		const unsigned char *packed,
+		size_t size,
+		size_t i,
+		unsigned int width
+) {
+	unsigned long long w = 0;
+	size_t first = i * width >> 3;
+	for (size_t k=first; k<first + 5 && k<size; k++) {
+		w |= static_cast<unsigned long long>(packed[k]) << (8 * (k - first));
+	}
+	return (w >> ((i * width) & 7)) & ((1ULL << width) - 1);
+}
+
+
+
+size_t encodePicFOR(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result
+) {
+	encodeFrameTag(FRAME_PIC_FOR, result);
+	storeLittleEndian(dataSize, result + 8);
+	unsigned char *out = result + PIC_FOR_HEADER_SIZE;
+
+	unsigned int offsets[PIC_FOR_BLOCK];
+	for (size_t b=0; b<dataSize; b+=PIC_FOR_BLOCK) {
+		size_t n = min(PIC_FOR_BLOCK, dataSize - b);
+		unsigned int minimum = UINT_MAX;
+		for (size_t i=0; i<n; i++) {
+			offsets[i] = picInt(data[b + i]);
+			minimum = min(minimum, offsets[i]);
+		}
+		for (size_t i=0; i<n; i++) {
+			offsets[i] -= minimum;
+		}
+
+		size_t exceptionCount;
+		unsigned int exceptionWidth;
+		unsigned int width = picForWidth(offsets, n, &exceptionCount, &exceptionWidth);
+		for (size_t k=0; k<4; k++) {
+			out[k] = static_cast<unsigned char>(minimum >> (8 * k));
+		}
+		out[4] = static_cast<unsigned char>(width);
+		out[5] = static_cast<unsigned char>(exceptionCount);
+		out[6] = static_cast<unsigned char>(exceptionWidth);
+		out += PIC_FOR_BLOCK_HEADER_SIZE;
+
+		// the low width bits of every offset
+		out = picForPack(offsets, n, width, out);
+
+		// then the positions and the high bits of the ones that do not fit
+		unsigned int highs[PIC_FOR_BLOCK];
+		size_t e = 0;
+		for (size_t i=0; i<n && e<exceptionCount; i++) {
+			if ((offsets[i] >> width) != 0) {
+				*out++ = static_cast<unsigned char>(i);
+				highs[e++] = offsets[i] >> width;
+			}
+		}
+		out = picForPack(highs, exceptionCount, exceptionWidth, out);
+	}
+	return out - result;
+}
+
+
+
+void encodePicFOR(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result
+) {
+	result.resize(maxPicFORSize(data.size()));
+	result.resize(encodePicFOR(data.data(), data.size(), &result[0]));
+}
+
+
+
+size_t decodedCountPicFOR(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	if (decodeFrameTag(data, dataSize) != FRAME_PIC_FOR) 
+		throw "[MSNumpress::decodePicFOR] Corrupt input data: not a PicFOR array! ";
+	if (dataSize < PIC_FOR_HEADER_SIZE) 
+		throw "[MSNumpress::decodePicFOR] Corrupt input data: not enough bytes to read header! ";
+
+	// every block takes at least its header
+	unsigned long long count = loadLittleEndian(data + 8);
+	unsigned long long blockCount = count / PIC_FOR_BLOCK + (count % PIC_FOR_BLOCK != 0);
+	if (blockCount > (dataSize - PIC_FOR_HEADER_SIZE) / PIC_FOR_BLOCK_HEADER_SIZE) 
+		throw "[MSNumpress::decodePicFOR] Corrupt input data: not enough bytes for the blocks! ";
+	return static_cast<size_t>(count);
+}
+
+
+
+/**
+ * Unpacks n offsets of width bits from packed and adds minimum to them.
+ * Reads whole words, so 8 bytes must be readable from the first byte of 
+ * every offset on.
+ */
+static void picForValuesScalar(
+		const unsigned char *packed,
+		size_t n,
+		unsigned int width,
+		unsigned int minimum,
+		double *result
+) {
+	unsigned long long mask = (1ULL << width) - 1;
+	for (size_t i=0; i<n; i++) {
+		size_t bit = i * width;
+		unsigned long long w = loadLittleEndian(packed + (bit >> 3)) >> (bit & 7);
+		result[i] = static_cast<double>(minimum) + static_cast<double>(w & mask);
+	}
+}
+
+#if MSNUMPRESS_X86
+
+// 4 offsets per step, gathered as words from their first bytes and turned
+// into doubles by putting them under the mantissa of 2^52
+MSNUMPRESS_TARGET("avx2")
+static void picForValuesAVX2(
+		const unsigned char *packed,
+		size_t n,
+		unsigned int width,
+		unsigned int minimum,
+		double *result
+) {
+	const __m256i mask 		= _mm256_set1_epi64x((1LL << width) - 1);
+	const __m256i exponent 	= _mm256_set1_epi64x(0x4330000000000000LL);
+	const __m256d offset 	= _mm256_set1_pd(4503599627370496.0 - minimum);
+	const __m256i step 		= _mm256_set1_epi64x(4 * width);
+	__m256i bit = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i w = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(packed), 
+			_mm256_srli_epi64(bit, 3), 1);
+		w = _mm256_and_si256(_mm256_srlv_epi64(w, _mm256_and_si256(bit, _mm256_set1_epi64x(7))), mask);
+		__m256d d = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(w, exponent)), offset);
+		_mm256_storeu_pd(result + i, d);
+		bit = _mm256_add_epi64(bit, step);
+	}
+	for (; i<n; i++) {
+		size_t b = i * width;
+		unsigned long long w = loadLittleEndian(packed + (b >> 3)) >> (b & 7);
+		result[i] = static_cast<double>(minimum) + static_cast<double>(w & ((1ULL << width) - 1));
+	}
+}
+
+#endif
+
+
+
+size_t decodePicFOR(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result
+) {
+	size_t count = decodedCountPicFOR(data, dataSize);
+	PicForValuesFn picForValues = kernels().picForValues;
+	const unsigned char *end = data + dataSize;
+	const unsigned char *p = data + PIC_FOR_HEADER_SIZE;
+
+	for (size_t b=0; b<count; b+=PIC_FOR_BLOCK) {
+		size_t n = min(PIC_FOR_BLOCK, count - b);
+		if (static_cast<size_t>(end - p) < PIC_FOR_BLOCK_HEADER_SIZE) 
+			throw "[MSNumpress::decodePicFOR] Corrupt input data: not enough bytes for the blocks! ";
+
+		unsigned int minimum 		= static_cast<unsigned int>(loadLittleEndian32(p));
+		unsigned int width 			= p[4];
+		size_t exceptionCount 		= p[5];
+		unsigned int exceptionWidth = p[6];
+		size_t packedSize 			= (n * width + 7) / 8;
+		size_t highsSize 			= (exceptionCount * exceptionWidth + 7) / 8;
+		p += PIC_FOR_BLOCK_HEADER_SIZE;
+		if (width + exceptionWidth > 32 || exceptionCount > n ||
+				static_cast<size_t>(end - p) < packedSize + exceptionCount + highsSize) 
+			throw "[MSNumpress::decodePicFOR] Corrupt input data: block does not fit! ";
+
+		// the last offsets of the last block are read byte by byte
+		size_t fast = n;
+		while (fast > 0 && ((fast - 1) * width >> 3) + 8 > static_cast<size_t>(end - p)) {
+			fast--;
+		}
+		picForValues(p, fast, width, minimum, result + b);
+		for (size_t i=fast; i<n; i++) {
+			result[b + i] = static_cast<double>(minimum) + 
+				static_cast<double>(picForUnpack(p, packedSize, i, width));
+		}
+		p += packedSize;
+
+		// patching the exceptions adds their high bits above the low ones, 
+		// which is exact as offsets have at most 32 bits
+		const unsigned char *highs = p + exceptionCount;
+		unsigned long long acc = 0;
+		unsigned int bits = 0;
+		unsigned long long mask = (1ULL << exceptionWidth) - 1;
+		for (size_t e=0; e<exceptionCount; e++) {
+			if (p[e] >= n) 
+				throw "[MSNumpress::decodePicFOR] Corrupt input data: exception outside its block! ";
+			while (bits < exceptionWidth) {
+				acc |= static_cast<unsigned long long>(*highs++) << bits;
+				bits += 8;
+			}
+			result[b + p[e]] += static_cast<double>((acc & mask) << width);
+			acc >>= exceptionWidth;
+			bits -= exceptionWidth;
+		}
+		p += exceptionCount + highsSize;
+	}
+
+	if (p != end) 
+		throw "[MSNumpress::decodePicFOR] Corrupt input data: bytes after the last block! ";
+	return count;
+}
+
+
+
+void decodePicFOR(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result
+) {
+	result.resize(decodedCountPicFOR(data.data(), data.size()));
+	decodePicFOR(data.data(), data.size(), result.data());
+}
+
+
+
+/////////////////////////////////////////////////////////////
+
+// tag and value count
+static const size_t PIC_ZR_HEADER_SIZE = 16;
+
+// the ints from PIC_ZR_RUN on are run tokens, encoded as 0xf and a halfbyte k:
+// a run of k + 2 zeros, or for k = 15 a run of the next int + 17 zeros
+static const unsigned int PIC_ZR_RUN = 0xfffffff0;
+static const unsigned int PIC_ZR_SHORT_RUNS = 15;
+
+size_t maxPicZRSize(
+		size_t dataSize
+) {
+	return PIC_ZR_HEADER_SIZE + 5 * dataSize;
+}
+
+
+
+size_t encodePicZR(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result
+) {
+	encodeFrameTag(FRAME_PIC_ZR, result);
+	storeLittleEndian(dataSize, result + 8);
+
+	// whole words are flushed while they cannot pass the end of the maximal size
+	size_t limit = maxPicZRSize(dataSize) - 8;
+	size_t ri = PIC_ZR_HEADER_SIZE;
+	HalfByteWriter writer;
+	for (size_t i=0; i<dataSize; ) {
+		unsigned int x = picInt(data[i]);
+		size_t run = 1;
+		if (x == 0) {
+			while (i + run < dataSize && picInt(data[i + run]) == 0) {
+				run++;
+			}
+		}
+		
+		if (x >= PIC_ZR_RUN) {
+			throw "[MSNumpress::encodePicZR] Cannot encode a number this large.";
+		} else if (run == 1) {
+			writer.put(x);
+		} else if (run - 2 < PIC_ZR_SHORT_RUNS) {
+			writer.put(PIC_ZR_RUN + static_cast<unsigned int>(run - 2));
+		} else {
+			if (run - 17 > 0xffffffffULL) {
+				// a run longer than an int can count is cut in two
+				run = 0xffffffffULL + 17;
+			}
+			writer.put(PIC_ZR_RUN + PIC_ZR_SHORT_RUNS);
+			writer.put(static_cast<unsigned int>(run - 17));
+		}
+		i += run;
+
+		if (ri <= limit) {
+			writer.flushWord(result, &ri);
+		} else {
+			writer.flushBytes(result, &ri);
+		}
+	}
+	writer.finish(result, &ri);
+	return ri;
+}
+
+
+
+void encodePicZR(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result
+) {
+	result.resize(maxPicZRSize(data.size()));
+	result.resize(encodePicZR(data.data(), data.size(), &result[0]));
+}
+
+
+
+size_t decodedCountPicZR(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	if (decodeFrameTag(data, dataSize) != FRAME_PIC_ZR) 
+		throw "[MSNumpress::decodePicZR] Corrupt input data: not a PicZR array! ";
+	if (dataSize < PIC_ZR_HEADER_SIZE) 
+		throw "[MSNumpress::decodePicZR] Corrupt input data: not enough bytes to read header! ";
+	return static_cast<size_t>(loadLittleEndian(data + 8));
+}
+
+
+
+/**
+ * Decodes the ints of a PicZR array, passing every stretch of n values 
+ * between runs to values(index, ints, n) and every run to run(index, length).
+ * Checks that they add up to the count in the header.
+ */
+template <typename Values, typename Run>
+static size_t decodePicZRInts(
+		const unsigned char *data,
+		size_t dataSize,
+		Values values,
+		Run run
+) {
+	size_t count = decodedCountPicZR(data, dataSize);
+	unsigned int ints[INT_BLOCK];
+	size_t di = PIC_ZR_HEADER_SIZE;
+	size_t half = 0;
+	size_t index = 0;
+	bool longRun = false;
+	size_t n;
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, ints, INT_BLOCK);
+		size_t i = 0;
+		while (i < n) {
+			size_t length;
+			if (longRun) {
+				length = static_cast<size_t>(ints[i++]) + 17;
+				longRun = false;
+			} else {
+				// the values up to the next token are passed on at once
+				size_t j = i;
+				while (j < n && ints[j] < PIC_ZR_RUN) {
+					j++;
+				}
+				if (j - i > count - index) 
+					throw "[MSNumpress::decodePicZR] Corrupt input data: more values than the header says! ";
+				if (j > i) {
+					values(index, ints + i, j - i);
+					index += j - i;
+				}
+				if (j == n) break;
+
+				unsigned int x = ints[j];
+				i = j + 1;
+				if (x - PIC_ZR_RUN < PIC_ZR_SHORT_RUNS) {
+					length = x - PIC_ZR_RUN + 2;
+				} else {
+					longRun = true;
+					continue;
+				}
+			}
+
+			if (length > count - index) 
+				throw "[MSNumpress::decodePicZR] Corrupt input data: more values than the header says! ";
+			run(index, length);
+			index += length;
+		}
+	} while (n == INT_BLOCK);
+
+	if (longRun || index != count) 
+		throw "[MSNumpress::decodePicZR] Corrupt input data: fewer values than the header says! ";
+	return count;
+}
+
+
+
+/**
+ * Decodes a PicZR array into output (see FixedOutput), which is only asked 
+ * for room for the values the ints decoded so far can give, as the count 
+ * in the header is not trusted before the runs add up to it.
+ */
+template <typename Output>
+static size_t decodePicZRInto(
+		const unsigned char *data,
+		size_t dataSize,
+		Output output
+) {
+	size_t count = decodedCountPicZR(data, dataSize);
+	unsigned int ints[INT_BLOCK];
+	size_t di = PIC_ZR_HEADER_SIZE;
+	size_t half = 0;
+	size_t index = 0;
+	bool longRun = false;
+
+	// the values from index up to zeroed are zero, which is all a run needs
+	size_t zeroed = 0;
+	auto zero = [&](size_t end) {
+		double *result = output(end);
+		zeroed = max(zeroed, index);
+		if (end > zeroed) {
+			memset(result + zeroed, 0, (end - zeroed) * sizeof(double));
+			zeroed = end;
+		}
+		return result;
+	};
+	auto longRunOf = [&](unsigned int x) {
+		size_t length = static_cast<size_t>(x) + 17;
+		if (length > count - index) 
+			throw "[MSNumpress::decodePicZR] Corrupt input data: more values than the header says! ";
+		zero(index + length);
+		index += length;
+	};
+
+	size_t n;
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, ints, INT_BLOCK);
+		size_t i = 0;
+		if (longRun && n > 0) {
+			longRunOf(ints[i++]);
+			longRun = false;
+		}
+
+		// the values up to the first token are converted as decodePic does,
+		// which for a block without tokens is all there is to do
+		size_t limit = i + min(n - i, count - index);
+		double *values = output(index + (limit - i)) + index;
+		size_t j = i;
+		for (; j<limit && ints[j] < PIC_ZR_RUN; j++) {
+			values[j - i] = static_cast<double>(ints[j]);
+		}
+		index += j - i;
+		i = j;
+
+		while (i < n) {
+			// a value or a short run moves on by at most PIC_ZR_SHORT_RUNS + 1,
+			// and with that room zeroed the two only differ in how far, which
+			// spares a branch on every token
+			size_t room = min(count, index + (PIC_ZR_SHORT_RUNS + 1) * (n - i));
+			double *result = zero(room);
+			for (; i<n && index<room; i++) {
+				unsigned int x = ints[i];
+				if (x == PIC_ZR_RUN + PIC_ZR_SHORT_RUNS) break;
+				unsigned int run = 0u - static_cast<unsigned int>(x >= PIC_ZR_RUN);
+				result[index] = static_cast<double>(x & ~run);
+				index += 1 + (run & (x - PIC_ZR_RUN + 1));
+			}
+			if (index > count || (i < n && ints[i] != PIC_ZR_RUN + PIC_ZR_SHORT_RUNS)) 
+				throw "[MSNumpress::decodePicZR] Corrupt input data: more values than the header says! ";
+			if (i == n) break;
+
+			// a long run has its length in the next int, which may be in the next block
+			if (++i == n) {
+				longRun = true;
+			} else {
+				longRunOf(ints[i++]);
+			}
+		}
+	} while (n == INT_BLOCK);
+
+	if (longRun || index != count) 
+		throw "[MSNumpress::decodePicZR] Corrupt input data: fewer values than the header says! ";
+	return count;
+}
+
+
+
+size_t decodePicZR(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result
+) {
+	FixedOutput output = { result };
+	return decodePicZRInto(data, dataSize, output);
+}
+
+
+
+void decodePicZR(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result
+) {
+	result.clear();
+	VectorOutput output = { &result };
+	result.resize(decodePicZRInto(data.data(), data.size(), output));
+}
+
+
+
+size_t decodePicZRSparse(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *indices,
+		double *values
+) {
+	size_t k = 0;
+	decodePicZRInts(data, dataSize, 
+		[&](size_t index, const unsigned int *ints, size_t n) { 
+			for (size_t i=0; i<n; i++) {
+				if (ints[i] != 0) {
+					indices[k] 	= index + i;
+					values[k] 	= static_cast<double>(ints[i]);
+					k++;
+				}
+			}
+		},
+		[](size_t, size_t) {});
+	return k;
+}
+
+
+
+void decodePicZRSparse(
+		const std::vector<unsigned char> &data,
+		std::vector<size_t> &indices,
+		std::vector<double> &values
+) {
+	indices.clear();
+	values.clear();
+	decodePicZRInts(data.data(), data.size(), 
+		[&](size_t index, const unsigned int *ints, size_t n) { 
+			for (size_t i=0; i<n; i++) {
+				if (ints[i] != 0) {
+					indices.push_back(index + i);
+					values.push_back(static_cast<double>(ints[i]));
+				}
+			}
+		},
+		[](size_t, size_t) {});
+}
+
+
+
+/////////////////////////////////////////////////////////////
+
+// tag, fixed point and value count
+static const size_t LINEAR_RL_HEADER_SIZE = 24;
+
+// the residuals -7 and -8 are run tokens, followed by an int: the number of
+// values after the token minus 1. A stride run continues the last difference
+// (residuals of 0), a repeat run repeats the last value. Residuals from -9 on
+// down are written 2 lower to make room for them.
+static const unsigned int LINEAR_RL_STRIDE = 0xfffffff9;
+static const unsigned int LINEAR_RL_REPEAT = 0xfffffff8;
+
+// residuals of 0 for stride runs, which linearValues turns into values
+static const unsigned int LINEAR_RL_ZEROS[INT_BLOCK] = { 0 };
+
+size_t maxLinearRLSize(
+		size_t dataSize
+) {
+	return LINEAR_RL_HEADER_SIZE + 8 + 5 * dataSize;
+}
+
+
+
+/**
+ * The fixed point value of d, as encodeLinear computes it
+ */
+static inline long long linearRLInt(
+		double d,
+		double fixedPoint
+) {
+	if (THROW_ON_OVERFLOW && d * fixedPoint + 0.5 > LLONG_MAX) {
+		throw "[MSNumpress::encodeLinearRL] Next number overflows LLONG_MAX.";
+	}
+	return static_cast<long long>(d * fixedPoint + 0.5);
+}
+
+
+
+/**
+ * Returns the number of halfbytes encodeInt uses for x
+ */
+static inline size_t intHalfBytes(
+		unsigned int x
+) {
+	return 9 - leadingHalfBytes(x);
+}
+
+
+
+size_t encodeLinearRL(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint
+) {
+	encodeFrameTag(FRAME_LINEAR_RL, result);
+	encodeFixedPoint(fixedPoint, result + 8);
+	storeLittleEndian(dataSize, result + 16);
+
+	size_t ri = LINEAR_RL_HEADER_SIZE;
+	long long prev = 0;
+	long long last = 0;
+	for (size_t i=0; i<2 && i<dataSize; i++) {
+		prev = last;
+		last = linearRLInt(data[i], fixedPoint);
+		for (size_t j=0; j<4; j++) {
+			result[ri++] = (last >> (j*8)) & 0xff;
+		}
+	}
+
+	// whole words are flushed while they cannot pass the end of the maximal size
+	size_t limit = maxLinearRLSize(dataSize) - 8;
+	HalfByteWriter writer;
+	for (size_t i=2; i<dataSize; ) {
+		// unsigned, as the decoder relies on long long arithmetic wrapping
+		unsigned long long step = static_cast<unsigned long long>(last - prev);
+		unsigned long long next = static_cast<unsigned long long>(last) + step;
+		long long y = linearRLInt(data[i], fixedPoint);
+		
+		size_t stride = 0;
+		for (unsigned long long x = next; 
+				i + stride < dataSize && linearRLInt(data[i + stride], fixedPoint) == static_cast<long long>(x); 
+				x += step) {
+			stride++;
+		}
+		size_t repeat = 0;
+		while (step != 0 && i + repeat < dataSize && linearRLInt(data[i + repeat], fixedPoint) == last) {
+			repeat++;
+		}
+
+		// a token is written where it takes fewer halfbytes than the residuals
+		long long r = y - static_cast<long long>(next);
+		unsigned int residual = static_cast<unsigned int>((r >= -6) ? r : r - 2);
+
+		size_t run = max(stride, repeat);
+		if (run > 0xffffffffULL) {
+			// a run longer than an int can count is cut in two
+			run = 0xffffffffULL;
+		}
+		size_t plain = (stride > 0) ? run : intHalfBytes(residual) + run - 1;
+		if (run > 0 && 2 + intHalfBytes(static_cast<unsigned int>(run - 1)) < plain) {
+			writer.put((stride > 0) ? LINEAR_RL_STRIDE : LINEAR_RL_REPEAT);
+			writer.put(static_cast<unsigned int>(run - 1));
+			if (stride > 0) {
+				prev = static_cast<long long>(static_cast<unsigned long long>(last) + (run - 1) * step);
+				last = static_cast<long long>(static_cast<unsigned long long>(prev) + step);
+			} else {
+				prev = last;
+			}
+			i += run;
+		} else {
+			if (THROW_ON_OVERFLOW && (r > INT_MAX || r < INT_MIN + 2)) {
+				throw "[MSNumpress::encodeLinearRL] Cannot encode a number that exceeds the bounds of [-INT_MAX+1, INT_MAX].";
+			}
+			writer.put(residual);
+			prev = last;
+			last = y;
+			i++;
+		}
+
+		if (ri <= limit) {
+			writer.flushWord(result, &ri);
+		} else {
+			writer.flushBytes(result, &ri);
+		}
+	}
+	writer.finish(result, &ri);
+	return ri;
+}
+
+
+
+void encodeLinearRL(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result,
+		double fixedPoint
+) {
+	result.resize(maxLinearRLSize(data.size()));
+	result.resize(encodeLinearRL(data.data(), data.size(), &result[0], fixedPoint));
+}
+
+
+
+size_t decodedCountLinearRL(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	if (decodeFrameTag(data, dataSize) != FRAME_LINEAR_RL) 
+		throw "[MSNumpress::decodeLinearRL] Corrupt input data: not a LinearRL array! ";
+	if (dataSize < LINEAR_RL_HEADER_SIZE) 
+		throw "[MSNumpress::decodeLinearRL] Corrupt input data: not enough bytes to read header! ";
+	return static_cast<size_t>(loadLittleEndian(data + 16));
+}
+
+
+
+/**
+ * Decodes a LinearRL array into output (see FixedOutput), which is only 
+ * asked for room for the values decoded so far, as the count in the header
+ * is not trusted before the runs add up to it.
+ */
+template <typename Output>
+static size_t decodeLinearRLInto(
+		const unsigned char *data,
+		size_t dataSize,
+		Output output
+) {
+	size_t count = decodedCountLinearRL(data, dataSize);
+	double fixedPoint = decodeFixedPoint(data + 8);
+	size_t di = LINEAR_RL_HEADER_SIZE;
+
+	long long ints[2] = { 0, 0 };
+	for (size_t i=0; i<2 && i<count; i++) {
+		if (di + 4 > dataSize) 
+			throw "[MSNumpress::decodeLinearRL] Corrupt input data: not enough bytes to read first values! ";
+		ints[0] = ints[1];
+		ints[1] = loadLittleEndian32(data + di);
+		output(i + 1)[i] = ints[1] / fixedPoint;
+		di += 4;
+	}
+	if (count <= 2) {
+		if (di != dataSize) 
+			throw "[MSNumpress::decodeLinearRL] Corrupt input data: more values than the header says! ";
+		return count;
+	}
+
+	// residuals are passed on to linearValues in the runs between tokens
+	LinearValuesFn linearValues = kernels().linearValues;
+	unsigned int diffs[INT_BLOCK];
+	size_t half = 0;
+	size_t ri = 2;
+	unsigned int token = 0;
+	size_t n;
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, diffs, INT_BLOCK);
+		size_t begin = 0;
+		for (size_t i=0; i<=n; i++) {
+			unsigned int x = (i < n) ? diffs[i] : 0;
+			if (i < n && token == 0 && x != LINEAR_RL_STRIDE && x != LINEAR_RL_REPEAT) {
+				diffs[i] = (static_cast<int>(x) >= -6) ? x : x + 2;
+				continue;
+			}
+
+			if (i - begin > count - ri) 
+				throw "[MSNumpress::decodeLinearRL] Corrupt input data: more values than the header says! ";
+			linearValues(diffs + begin, i - begin, ints, fixedPoint, output(ri + i - begin) + ri);
+			ri += i - begin;
+			begin = i + 1;
+			if (i == n) {
+				break;
+			}
+			if (token == 0) {
+				token = x;
+				continue;
+			}
+
+			size_t run = static_cast<size_t>(x) + 1;
+			if (run > count - ri) 
+				throw "[MSNumpress::decodeLinearRL] Corrupt input data: more values than the header says! ";
+			double *result = output(ri + run);
+			if (token == LINEAR_RL_STRIDE) {
+				for (size_t r=0; r<run; r+=INT_BLOCK) {
+					linearValues(LINEAR_RL_ZEROS, min(INT_BLOCK, run - r), ints, fixedPoint, result + ri + r);
+				}
+			} else {
+				std::fill(result + ri, result + ri + run, ints[1] / fixedPoint);
+				ints[0] = ints[1];
+			}
+			ri += run;
+			token = 0;
+		}
+	} while (n == INT_BLOCK);
+
+	if (token != 0 || ri != count) 
+		throw "[MSNumpress::decodeLinearRL] Corrupt input data: fewer values than the header says! ";
+	return count;
+}
+
+
+
+size_t decodeLinearRL(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result
+) {
+	FixedOutput output = { result };
+	return decodeLinearRLInto(data, dataSize, output);
+}
+
+
+
+void decodeLinearRL(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result
+) {
+	result.clear();
+	VectorOutput output = { &result };
+	result.resize(decodeLinearRLInto(data.data(), data.size(), output));
+}
+
+
+
+/////////////////////////////////////////////////////////////
+
+// tag, fixed point and value count
+static const size_t LINEAR_LOG_HEADER_SIZE = 24;
+
+// bound on the error of log, of the division by the fixed point and of exp,
+// in the log domain, which the fixed point leaves room for 
+static const double LINEAR_LOG_SLACK = 1e-13;
+
+double optimalLinearLogFixedPoint(
+		double ppm
+) {
+	double tolerance = log1p(ppm * 1e-6);
+	if (!(tolerance > 10 * LINEAR_LOG_SLACK) || ppm > 1e6) return -1;
+	return 0.5 / (tolerance - LINEAR_LOG_SLACK);
+}
+
+
+
+size_t maxLinearLogSize(
+		size_t dataSize
+) {
+	return LINEAR_LOG_HEADER_SIZE + 16 + 5 * dataSize;
+}
+
+
 
-	if (dataSize < 8) 
-		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read fixed point! ";
-	
-	fixedPoint = decodeFixedPoint(data);
+/**
+ * Computes the fixed point values of log(data[i]) of encodeLinearLog, 
+ * rounded to nearest.
+ */
+static void logIntsScalar(
+		const double *data,
+		size_t n,
+		double fixedPoint,
+		long long *result
+) {
+	for (size_t i=0; i<n; i++) {
+		if (!(data[i] > 0)) 
+			throw "[MSNumpress::encodeLinearLog] Cannot encode a number that is not positive.";
+		double temp = log(data[i]) * fixedPoint;
+		if (THROW_ON_OVERFLOW && abs(temp) > 9e18) 
+			throw "[MSNumpress::encodeLinearLog] Next number overflows LLONG_MAX.";
+		result[i] = static_cast<long long>(floor(temp + 0.5));
+	}
+}
 
 
-	if (dataSize < 12) 
-		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read first value! ";
 
-	ints[1] = 0;
-	for (i=0; i<4; i++) {
-		ints[1] = ints[1] | ((0xff & (init = data[8+i])) << (i*8));
-	}
-	result[0] = ints[1] / fixedPoint;
+// the series of exp(r) of expPoly and expAVX2, from r^13 down
+static const double EXP_SERIES[14] = {
+	1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 
+	1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 
+	1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0
+};
 
-	if (dataSize == 12) return 1;
-	if (dataSize < 16) 
-		throw "[MSNumpress::decodeLinear] Corrupt input data: not enough bytes to read second value! ";
+static const double EXP_MAGIC = 6755399441055744.0;
+static const double EXP_LOG2E = 1.4426950408889634;
+static const double EXP_LN2_HI = 6.93147180369123816490e-01;
+static const double EXP_LN2_LO = 1.90821492927058770002e-10;
+static const double EXP_MAX_X = 708.0;
 
-	ints[2] = 0;
-	for (i=0; i<4; i++) {
-		ints[2] = ints[2] | ((0xff & (init = data[12+i])) << (i*8));
-	}
-	result[1] = ints[2] / fixedPoint;
-		
-	half = 0;
-	ri = 2;
-	di = 16;
-	
-	//printf("   di     ri      half    int[0]    int[1]    extrapol   diff\n");
-	
-	while (di < dataSize) {
-		if (di == (dataSize - 1) && half == 1) {
-			if ((data[di] & 0xf) == 0x0) {
-				break;
-			}
-		}
-		//printf("%7d %7d %7d %lu %lu %ld", di, ri, half, ints[0], ints[1], extrapol);
-		
-		ints[0] = ints[1];
-		ints[1] = ints[2];
-		decodeInt(data, &di, dataSize, &half, &buff);
-		diff = static_cast<int>(buff);
+// rounding through EXP_MAGIC needs doubles evaluated as doubles, not as x87 
+// extended precision, so there the libm exp is used on every tier
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+#define MSNUMPRESS_EXP_POLY 0
+#else
+#define MSNUMPRESS_EXP_POLY 1
+#endif
+
+/**
+ * exp of x with |x| <= EXP_MAX_X, to within a few ulp.
+ *
+ * x = k ln(2) + r with |r| <= ln(2)/2, and exp(r) from its series up to 
+ * r^13, scaled by 2^k through the exponent bits. Every step is a single 
+ * IEEE multiply or add, in the order expAVX2 takes them, so the two agree
+ * to the bit.
+ */
+MSNUMPRESS_NO_CONTRACT
+static inline double expPoly(
+		double x
+) {
+	double t = x * EXP_LOG2E;
+	t = t + EXP_MAGIC;
+	double k = t - EXP_MAGIC;
+	double hi = k * EXP_LN2_HI;
+	double lo = k * EXP_LN2_LO;
+	double r = x - hi;
+	r = r - lo;
 
-		extrapol = ints[1] + (ints[1] - ints[0]);
-		y = extrapol + diff;
-		//printf(" %d \n", diff);
-		result[ri++] 	= y / fixedPoint;
-		ints[2] 		= y;
+	double p = EXP_SERIES[0];
+	for (size_t j=1; j<14; j++) {
+		p = p * r;
+		p = p + EXP_SERIES[j];
 	}
 
-	return ri;
+	unsigned long long bits = static_cast<unsigned long long>(static_cast<long long>(k) + 1023) << 52;
+	double scale;
+	memcpy(&scale, &bits, 8);
+	return p * scale;
 }
 
 
 
-void encodeLinear(
-		const std::vector<double> &data, 
-		std::vector<unsigned char> &result,
-		double fixedPoint
+/**
+ * Computes exp(values[i]) in place, with expPoly where it holds and the 
+ * libm exp elsewhere (and for NaN).
+ */
+static void expValuesScalar(
+		double *values,
+		size_t n
 ) {
-	size_t dataSize = data.size();
-	result.resize(dataSize * 5 + 8);
-	size_t encodedLength = encodeLinear(&data[0], dataSize, &result[0], fixedPoint);
-	result.resize(encodedLength);
+	for (size_t i=0; i<n; i++) {
+		double x = values[i];
+		values[i] = (MSNUMPRESS_EXP_POLY && x >= -EXP_MAX_X && x <= EXP_MAX_X) ? expPoly(x) : exp(x);
+	}
 }
 
 
 
-void decodeLinear(
-		const std::vector<unsigned char> &data,
-		std::vector<double> &result
+#if MSNUMPRESS_X86
+
+/**
+ * As logIntsScalar, four values at a time with logAVX2, and with the same
+ * fallback for values that round differently (see slofCodesAVX2), so that
+ * the ints are those of the libm log.
+ */
+MSNUMPRESS_TARGET("avx2")
+static void logIntsAVX2(
+		const double *data,
+		size_t n,
+		double fixedPoint,
+		long long *result
 ) {
-	size_t dataSize = data.size();
-	result.resize((dataSize - 8) * 2);
-	size_t decodedLength = decodeLinear(&data[0], dataSize, &result[0]);
-	result.resize(decodedLength);
+	// the error of logAVX2 grows with the value, so the margin does too
+	const double LOG_ROUNDING_MARGIN = 1e-6;
+	const double LOG_RELATIVE_MARGIN = 1e-14;
+	const __m256i magicBits = _mm256_set1_epi64x(0x4338000000000000LL);
+	const __m256d magic 	= _mm256_set1_pd(6755399441055744.0);
+	const __m256d half 		= _mm256_set1_pd(0.5);
+	const __m256d minX 		= _mm256_set1_pd(2.2250738585072014e-308);
+	const __m256d maxX 		= _mm256_set1_pd(1.7976931348623157e308);
+	const __m256d maxTemp 	= _mm256_set1_pd(1e15);
+	const __m256d minTemp 	= _mm256_set1_pd(-1e15);
+	const __m256d margin 	= _mm256_set1_pd(LOG_ROUNDING_MARGIN);
+	const __m256d relative 	= _mm256_set1_pd(LOG_RELATIVE_MARGIN);
+	const __m256d one 		= _mm256_set1_pd(1.0);
+	const __m256d fp 		= _mm256_set1_pd(fixedPoint);
+	size_t i = 0;
+
+	for (; i+4 <= n; i+=4) {
+		__m256d x 		= _mm256_loadu_pd(data + i);
+		__m256d temp 	= _mm256_mul_pd(logAVX2(x), fp);
+		__m256d v 		= _mm256_floor_pd(_mm256_add_pd(temp, half));
+		__m256d frac 	= _mm256_sub_pd(_mm256_add_pd(temp, half), v);
+		__m256d lowFrac = _mm256_add_pd(margin, _mm256_mul_pd(_mm256_max_pd(temp, _mm256_sub_pd(_mm256_setzero_pd(), temp)), relative));
+		__m256d highFrac = _mm256_sub_pd(one, lowFrac);
+
+		__m256d ok = _mm256_and_pd(
+				_mm256_and_pd(_mm256_cmp_pd(x, minX, _CMP_GE_OQ), _mm256_cmp_pd(x, maxX, _CMP_LE_OQ)),
+				_mm256_and_pd(
+					_mm256_and_pd(_mm256_cmp_pd(temp, minTemp, _CMP_GE_OQ), _mm256_cmp_pd(temp, maxTemp, _CMP_LE_OQ)),
+					_mm256_and_pd(_mm256_cmp_pd(frac, lowFrac, _CMP_GE_OQ), _mm256_cmp_pd(frac, highFrac, _CMP_LE_OQ))));
+
+		if (_mm256_movemask_pd(ok) == 0xf) {
+			// integral doubles below 2^51 to int64 through the bits of 1.5 * 2^52
+			__m256i y = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(v, magic)), magicBits);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(result + i), y);
+		} else {
+			logIntsScalar(data + i, 4, fixedPoint, result + i);
+		}
+	}
+	logIntsScalar(data + i, n - i, fixedPoint, result + i);
 }
 
-/////////////////////////////////////////////////////////////
 
 
-size_t encodeSafe(
-		const double *data, 
-		const size_t dataSize, 
-		unsigned char *result
+#if MSNUMPRESS_EXP_POLY
+
+/**
+ * expPoly of four values.
+ */
+MSNUMPRESS_TARGET("avx2") MSNUMPRESS_NO_CONTRACT
+static inline __m256d expAVX2(
+		__m256d x
 ) {
-	size_t i, j, ri = 0;
-	double latest[3];
-	double extrapol, diff;
-	const unsigned char *fp; 
-	
-	//printf("d0 d1 d2 extrapol diff\n");
-		
-	if (dataSize == 0) return ri;
+	const __m256d magic = _mm256_set1_pd(EXP_MAGIC);
 
-	latest[1] = data[0];
-	fp = (unsigned char*)data;
-	for (i=0; i<8; i++) {
-		result[ri++] = fp[IS_LITTLE_ENDIAN ? (7-i) : i];
-	}
-	
-	if (dataSize == 1) return ri;
+	__m256d t = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(EXP_LOG2E)), magic);
+	__m256d k = _mm256_sub_pd(t, magic);
+	__m256d hi = _mm256_mul_pd(k, _mm256_set1_pd(EXP_LN2_HI));
+	__m256d lo = _mm256_mul_pd(k, _mm256_set1_pd(EXP_LN2_LO));
+	__m256d r = _mm256_sub_pd(_mm256_sub_pd(x, hi), lo);
 
-	latest[2] = data[1];
-	fp = (unsigned char*)&(data[1]);
-	for (i=0; i<8; i++) {
-		result[ri++] = fp[IS_LITTLE_ENDIAN ? (7-i) : i];
+	__m256d p = _mm256_set1_pd(EXP_SERIES[0]);
+	for (size_t j=1; j<14; j++) {
+		p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_SERIES[j]));
 	}
 
-	fp = (unsigned char*)&diff;
-	for (i=2; i<dataSize; i++) {
-		latest[0] = latest[1];
-		latest[1] = latest[2];
-		latest[2] = data[i];
-		extrapol = latest[1] + (latest[1] - latest[0]);
-		diff = latest[2] - extrapol;
-		//printf("%f %f %f %f %f\n", latest[0], latest[1], latest[2], extrapol, diff);
-		for (j=0; j<8; j++) {
-			result[ri++] = fp[IS_LITTLE_ENDIAN ? (7-j) : j];
-		}
-	}
-	
-	return ri;
+	// k is integral, so t holds it in the low bits of 1.5 * 2^52
+	__m256i ki = _mm256_sub_epi64(_mm256_castpd_si256(t), _mm256_castpd_si256(magic));
+	__m256i scale = _mm256_slli_epi64(_mm256_add_epi64(ki, _mm256_set1_epi64x(1023)), 52);
+	return _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
 }
 
 
 
-size_t decodeSafe(
-		const unsigned char *data,
-		const size_t dataSize,
-		double *result
+/**
+ * As expValuesScalar, four values at a time with expAVX2. Groups with a 
+ * value out of its range (or NaN) are done by expValuesScalar.
+ */
+MSNUMPRESS_TARGET("avx2")
+static void expValuesAVX2(
+		double *values,
+		size_t n
 ) {
-	size_t i, di, ri;
-	double extrapol, diff;
-	double latest[3];
-	unsigned char *fp;
-	
-	if (dataSize % 8 != 0) 
-		throw "[MSNumpress::decodeSafe] Corrupt input data: number of bytes needs to be multiple of 8! ";
-	
-	//printf("d0 d1 extrapol diff\td2\n");
-	
-	try {
-		fp = (unsigned char*)&(latest[1]);
-		for (i=0; i<8; i++) {
-			fp[i] = data[IS_LITTLE_ENDIAN ? (7-i) : i];
-		}
-		result[0] = latest[1];
+	const __m256d maxX = _mm256_set1_pd(EXP_MAX_X);
+	const __m256d minX = _mm256_set1_pd(-EXP_MAX_X);
+	size_t i = 0;
 
-		if (dataSize == 8) return 1;
-
-		fp = (unsigned char*)&(latest[2]);
-		for (i=0; i<8; i++) {
-			fp[i] = data[8 + (IS_LITTLE_ENDIAN ? (7-i) : i)];
-		}
-		result[1] = latest[2];
-		
-		ri = 2;
-		
-		fp = (unsigned char*)&diff;
-		for (di = 16; di < dataSize; di += 8) {
-			latest[0] = latest[1];
-			latest[1] = latest[2];
-			
-			for (i=0; i<8; i++) {
-				fp[i] = data[di + (IS_LITTLE_ENDIAN ? (7-i) : i)];
-			}
-			
-			extrapol = latest[1] + (latest[1] - latest[0]);
-			latest[2] = extrapol + diff;
-			
-			//printf("%f %f %f %f\t%f \n", latest[0], latest[1], extrapol, diff, latest[2]);
-		
-			result[ri++] = latest[2];
+	for (; i+4 <= n; i+=4) {
+		__m256d x = _mm256_loadu_pd(values + i);
+		__m256d ok = _mm256_and_pd(_mm256_cmp_pd(x, minX, _CMP_GE_OQ), _mm256_cmp_pd(x, maxX, _CMP_LE_OQ));
+		if (_mm256_movemask_pd(ok) == 0xf) {
+			_mm256_storeu_pd(values + i, expAVX2(x));
+		} else {
+			expValuesScalar(values + i, 4);
 		}
-	} catch (...) {
-		throw "[MSNumpress::decodeSafe] Unknown error during decode! ";
 	}
-	
-	return ri;
+	expValuesScalar(values + i, n - i);
 }
 
-/////////////////////////////////////////////////////////////
+#endif
 
+#endif
 
-size_t encodePic(
+
+
+size_t encodeLinearLog(
 		const double *data, 
 		size_t dataSize, 
-		unsigned char *result
+		unsigned char *result,
+		double ppm
 ) {
-	size_t i, ri;
-	unsigned int x;
-	unsigned char halfBytes[10];
-	size_t halfByteCount;
-	size_t hbi;
+	double fixedPoint = optimalLinearLogFixedPoint(ppm);
+	if (fixedPoint < 0) 
+		throw "[MSNumpress::encodeLinearLog] Cannot reach this ppm tolerance.";
 
-	//printf("Encoding %d doubles\n", (int)dataSize);
+	encodeFrameTag(FRAME_LINEAR_LOG, result);
+	encodeFixedPoint(fixedPoint, result + 8);
+	storeLittleEndian(dataSize, result + 16);
 
-	halfByteCount = 0;
-	ri = 0;
+	// the logs are taken a block at a time, the residuals as in encodeLinear
+	const Kernels &k = kernels();
+	long long ints[INT_BLOCK];
+	long long prev = 0;
+	long long last = 0;
+	size_t limit = maxLinearLogSize(dataSize) - 8;
+	size_t ri = LINEAR_LOG_HEADER_SIZE;
+	HalfByteWriter writer;
+	for (size_t i=0; i<dataSize; i+=INT_BLOCK) {
+		size_t n = min(INT_BLOCK, dataSize - i);
+		k.logInts(data + i, n, fixedPoint, ints);
 
-	for (i=0; i<dataSize; i++) {
-		
-		if (THROW_ON_OVERFLOW && 
-				(data[i] + 0.5 > INT_MAX || data[i] < -0.5)		){
-			throw "[MSNumpress::encodePic] Cannot use Pic to encode a number larger than INT_MAX or smaller than 0.";
-		}
-		x = static_cast<unsigned int>(data[i] + 0.5);
-		//printf("%d %d %d,   extrapol: %d    diff: %d \n", ints[0], ints[1], ints[2], extrapol, diff);
-		encodeInt(x, &halfBytes[halfByteCount], &halfByteCount);
-		
-		for (hbi=1; hbi < halfByteCount; hbi+=2) {
-			result[ri] = static_cast<unsigned char>(
-					(halfBytes[hbi-1] << 4) | (halfBytes[hbi] & 0xf)
-				);
-			//printf("%x \n", result[ri]);
-			ri++;
-		}
-		if (halfByteCount % 2 != 0) {
-			halfBytes[0] = halfBytes[halfByteCount-1];
-			halfByteCount = 1;
-		} else {
-			halfByteCount = 0;
+		for (size_t j=0; j<n; j++) {
+			if (i + j < 2) {
+				storeLittleEndian(static_cast<unsigned long long>(ints[j]), result + ri);
+				ri += 8;
+			} else {
+				long long extrapol = last + (last - prev);
+				if (THROW_ON_OVERFLOW && (ints[j] - extrapol > INT_MAX || ints[j] - extrapol < INT_MIN)) 
+					throw "[MSNumpress::encodeLinearLog] Cannot encode a number that exceeds the bounds of [-INT_MAX, INT_MAX].";
+				writer.put(static_cast<unsigned int>(ints[j] - extrapol));
+				if (ri <= limit) {
+					writer.flushWord(result, &ri);
+				} else {
+					writer.flushBytes(result, &ri);
+				}
+			}
+			prev = last;
+			last = ints[j];
 		}
 	}
-	if (halfByteCount == 1) {
-		result[ri] = static_cast<unsigned char>(halfBytes[0] << 4);
-		ri++;
-	}
+	writer.finish(result, &ri);
 	return ri;
 }
 
 
 
-size_t decodePic(
-		const unsigned char *data,
-		const size_t dataSize,
-		double *result
+void encodeLinearLog(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result,
+		double ppm
 ) {
-	size_t ri;
-	unsigned int x;
-	size_t di;
-	size_t half;
+	result.resize(maxLinearLogSize(data.size()));
+	result.resize(encodeLinearLog(data.data(), data.size(), &result[0], ppm));
+}
 
-	//printf("ri      di      half    dSize   count\n");
-	
-	half = 0;
-	ri = 0;
-	di = 0;
-	
-	while (di < dataSize) {
-		if (di == (dataSize - 1) && half == 1) {
-			if ((data[di] & 0xf) == 0x0) {
-				break;
-			}
-		}
-		
-		decodeInt(&data[0], &di, dataSize, &half, &x);
-		
-		//printf("%7d %7d %7d %7d %7d\n", ri, di, half, dataSize, count);
-		
-		//printf("count: %d \n", count);
-		result[ri++] = static_cast<double>(x);
-	}
 
-	return ri;
+
+size_t decodedCountLinearLog(
+		const unsigned char *data,
+		size_t dataSize
+) {
+	if (decodeFrameTag(data, dataSize) != FRAME_LINEAR_LOG) 
+		throw "[MSNumpress::decodeLinearLog] Corrupt input data: not a LinearLog array! ";
+	if (dataSize < LINEAR_LOG_HEADER_SIZE) 
+		throw "[MSNumpress::decodeLinearLog] Corrupt input data: not enough bytes to read header! ";
+	if (!(decodeFixedPoint(data + 8) > 0)) 
+		throw "[MSNumpress::decodeLinearLog] Corrupt input data: fixed point is not positive! ";
+
+	// every value after the first two takes at least a halfbyte
+	unsigned long long count = loadLittleEndian(data + 16);
+	size_t first = LINEAR_LOG_HEADER_SIZE + 16;
+	if (count > 2 && (dataSize < first || count - 2 > 2 * static_cast<unsigned long long>(dataSize - first))) 
+		throw "[MSNumpress::decodeLinearLog] Corrupt input data: not enough bytes for the values! ";
+	return static_cast<size_t>(count);
 }
 
 
 
-void encodePic(
-		const std::vector<double> &data,  
-		std::vector<unsigned char> &result
+size_t decodeLinearLog(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result
 ) {
-	size_t dataSize = data.size();
-	result.resize(dataSize * 5);
-	size_t encodedLength = encodePic(&data[0], dataSize, &result[0]);
-	result.resize(encodedLength);
+	size_t count = decodedCountLinearLog(data, dataSize);
+	double fixedPoint = decodeFixedPoint(data + 8);
+	size_t di = LINEAR_LOG_HEADER_SIZE;
+	const Kernels &k = kernels();
+
+	long long ints[2] = { 0, 0 };
+	for (size_t i=0; i<2 && i<count; i++) {
+		if (di + 8 > dataSize) 
+			throw "[MSNumpress::decodeLinearLog] Corrupt input data: not enough bytes to read first values! ";
+		ints[0] = ints[1];
+		ints[1] = static_cast<long long>(loadLittleEndian(data + di));
+		result[i] = ints[1] / fixedPoint;
+		di += 8;
+	}
+	k.expValues(result, min(count, static_cast<size_t>(2)));
+	if (count <= 2) {
+		if (di != dataSize) 
+			throw "[MSNumpress::decodeLinearLog] Corrupt input data: more values than the header says! ";
+		return count;
+	}
+
+	// the logs are reconstructed as by decodeLinear, then exp is taken of them
+	unsigned int diffs[INT_BLOCK];
+	size_t half = 0;
+	size_t ri = 2;
+	size_t n;
+	do {
+		n = decodeIntBlock(data, dataSize, &di, &half, diffs, INT_BLOCK);
+		if (n > count - ri) 
+			throw "[MSNumpress::decodeLinearLog] Corrupt input data: more values than the header says! ";
+		k.linearValues(diffs, n, ints, fixedPoint, result + ri);
+		k.expValues(result + ri, n);
+		ri += n;
+	} while (n == INT_BLOCK);
+
+	if (ri != count) 
+		throw "[MSNumpress::decodeLinearLog] Corrupt input data: fewer values than the header says! ";
+	return count;
 }
 
 
 
-void decodePic(
-		const std::vector<unsigned char> &data,  
+void decodeLinearLog(
+		const std::vector<unsigned char> &data,
 		std::vector<double> &result
 ) {
-	size_t dataSize = data.size();
-	result.resize(dataSize * 2);
-	size_t decodedLength = decodePic(&data[0], dataSize, &result[0]);
-	result.resize(decodedLength);
+	result.resize(decodedCountLinearLog(data.data(), data.size()));
+	decodeLinearLog(data.data(), data.size(), result.data());
 }
 
 
+
 /////////////////////////////////////////////////////////////
 
+static const Kernels SCALAR_KERNELS = {
+	intLengthsScalar, 
+	linearValuesScalar, 
+	safeResidualsScalar, 
+	safeValuesScalar,
+	maxValueScalar, 
+	slofCodesScalar, 
+	slofGatherScalar,
+	base64DecodeScalar,
+	base64EncodeScalar,
+	picSvValuesScalar,
+	picForValuesScalar,
+	logIntsScalar,
+	expValuesScalar
+};
 
-double optimalSlofFixedPoint(
-		const double *data, 
-		size_t dataSize
-) {
-	if (dataSize == 0) return 0;
-	
-	double maxDouble = 1;
-	double x;
-	double fp;
+#if MSNUMPRESS_X86
 
-	for (size_t i=0; i<dataSize; i++) {
-		x = log(data[i]+1);
-		maxDouble = max(maxDouble, x);
-	}
+#if MSNUMPRESS_LITTLE_ENDIAN
+#define MSNUMPRESS_SAFE_KERNELS(tier) safeResiduals##tier, safeValues##tier
+#else
+#define MSNUMPRESS_SAFE_KERNELS(tier) safeResidualsScalar, safeValuesScalar
+#endif
 
-	fp = floor(0xFFFF / maxDouble);
+#if MSNUMPRESS_EXP_POLY
+#define MSNUMPRESS_EXP_VALUES expValuesAVX2
+#else
+#define MSNUMPRESS_EXP_VALUES expValuesScalar
+#endif
 
-	//cout << "    max val: " << maxDouble << endl;
-	//cout << "fixed point: " << fp << endl;
+static const Kernels SSE42_KERNELS = {
+	intLengthsSSSE3, 
+	linearValuesSSE42, 
+	MSNUMPRESS_SAFE_KERNELS(SSSE3),
+	maxValueSSE2, 
+	slofCodesScalar, 
+	slofGatherScalar,
+	base64DecodeSSE42,
+	base64EncodeSSE42,
+	picSvValuesSSE42,
+	picForValuesScalar,
+	logIntsScalar,
+	expValuesScalar
+};
 
-	return fp;
-}
+static const Kernels AVX2_KERNELS = {
+	intLengthsAVX2, 
+	linearValuesAVX2, 
+	MSNUMPRESS_SAFE_KERNELS(AVX2),
+	maxValueAVX2, 
+	slofCodesAVX2, 
+	slofGatherAVX2,
+	base64DecodeAVX2,
+	base64EncodeAVX2,
+	picSvValuesAVX2,
+	picForValuesAVX2,
+	logIntsAVX2,
+	MSNUMPRESS_EXP_VALUES
+};
 
+// the AVX2 Slof codes are bound by the log polynomial, not the vector width
+static const Kernels AVX512_KERNELS = {
+	intLengthsAVX512, 
+	linearValuesAVX512, 
+	MSNUMPRESS_SAFE_KERNELS(AVX512),
+	maxValueAVX512, 
+	slofCodesAVX2, 
+	slofGatherAVX512,
+	base64DecodeAVX2,
+	base64EncodeAVX2,
+	picSvValuesAVX2,
+	picForValuesAVX2,
+	logIntsAVX2,
+	MSNUMPRESS_EXP_VALUES
+};
 
+#undef MSNUMPRESS_SAFE_KERNELS
+#undef MSNUMPRESS_EXP_VALUES
 
-size_t encodeSlof(
-		const double *data, 
-		size_t dataSize, 
-		unsigned char *result,
-		double fixedPoint
-) {
-	size_t i, ri;
-	double temp;
-	unsigned short x;
-	encodeFixedPoint(fixedPoint, result);
+#endif
 
-	ri = 8;
-	for (i=0; i<dataSize; i++) {
-		temp = log(data[i]+1) * fixedPoint;
 
-		if (THROW_ON_OVERFLOW && 
-				temp > USHRT_MAX		) {
-			throw "[MSNumpress::encodeSlof] Cannot encode a number that overflows USHRT_MAX.";
-		}
 
-		x = static_cast<unsigned short>(temp + 0.5);
-		result[ri++] = x & 0xff;
-		result[ri++] = (x >> 8) & 0xff; 
+static SimdTier supportedSimdTier() {
+#if MSNUMPRESS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+			__builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+		return SIMD_AVX512;
 	}
-	return ri;
+	if (__builtin_cpu_supports("avx2")) {
+		return SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("ssse3")) {
+		return SIMD_SSE42;
+	}
+#endif
+	return SIMD_SCALAR;
 }
 
 
 
-size_t decodeSlof(
-		const unsigned char *data, 
-		const size_t dataSize, 
-		double *result
+static const Kernels *tierKernels(
+		SimdTier tier
 ) {
-	size_t i, ri;
-	unsigned short x;
-	double fixedPoint;
-
-	if (dataSize < 8) 
-		throw "[MSNumpress::decodeSlof] Corrupt input data: not enough bytes to read fixed point! ";
-	
-	ri = 0;
-	fixedPoint = decodeFixedPoint(data);
-
-	for (i=8; i<dataSize; i+=2) {
-		x = static_cast<unsigned short>(data[i] | (data[i+1] << 8));
-		result[ri++] = exp(x / fixedPoint) - 1;
+	switch (tier) {
+#if MSNUMPRESS_X86
+		case SIMD_AVX512: 	return &AVX512_KERNELS;
+		case SIMD_AVX2: 	return &AVX2_KERNELS;
+		case SIMD_SSE42: 	return &SSE42_KERNELS;
+#endif
+		default: 			return &SCALAR_KERNELS;
 	}
-	return ri;
 }
 
 
 
-void encodeSlof(
-		const std::vector<double> &data,  
-		std::vector<unsigned char> &result,
-		double fixedPoint
+static std::atomic<int> activeSimdTier(-1);
+static std::atomic<const Kernels*> activeKernels(NULL);
+
+
+
+SimdTier setSimdTier(
+		SimdTier tier
 ) {
-	size_t dataSize = data.size();
-	result.resize(dataSize * 2 + 8);
-	size_t encodedLength = encodeSlof(&data[0], dataSize, &result[0], fixedPoint);
-	result.resize(encodedLength);
+	tier = min(tier, supportedSimdTier());
+	activeKernels.store(tierKernels(tier));
+	activeSimdTier.store(tier);
+	return tier;
 }
 
 
 
-void decodeSlof(
-		const std::vector<unsigned char> &data,  
-		std::vector<double> &result
-) {
-	size_t dataSize = data.size();
-	result.resize((dataSize - 8) / 2);
-	size_t decodedLength = decodeSlof(&data[0], dataSize, &result[0]);
-	result.resize(decodedLength);
+SimdTier simdTier() {
+	int tier = activeSimdTier.load();
+	if (tier >= 0) {
+		return static_cast<SimdTier>(tier);
+	}
+
+	SimdTier wanted = SIMD_AVX512;
+	const char *env = getenv("MSNUMPRESS_SIMD");
+	if (env) {
+		if 		(strcmp(env, "scalar") == 0)	wanted = SIMD_SCALAR;
+		else if (strcmp(env, "sse42") == 0) 	wanted = SIMD_SSE42;
+		else if (strcmp(env, "avx2") == 0) 		wanted = SIMD_AVX2;
+	}
+	return setSimdTier(wanted);
+}
+
+
+
+static const Kernels &kernels() {
+	const Kernels *k = activeKernels.load(std::memory_order_acquire);
+	if (k == NULL) {
+		simdTier();
+		k = activeKernels.load();
+	}
+	return *k;
 }
 
+// detect at load; kernels() covers calls from other static initializers
+static const SimdTier loadSimdTier = simdTier();
+
 }
 } // namespace numpress
 } // namespace ms
@@ -42,6 +42,9 @@
 #define _MSNUMPRESS_HPP_
 
 #include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
 #include <vector>
 
 // defines whether to throw an exception when a number cannot be encoded safely
@@ -112,6 +115,20 @@ namespace MSNumpress {
 		unsigned char *result,
 		double fixedPoint);
 	
+	/**
+	 * Computes the number of bytes encodeLinear would write, without writing
+	 * them. Throws where encodeLinear would.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @fixedPoint	the scaling factor used for getting the fixed point repr.
+	 * @return		the number of bytes encodeLinear returns
+	 */
+	size_t encodedSizeLinear(
+		const double *data, 
+		size_t dataSize, 
+		double fixedPoint);
+
 	/**
 	 * Calls lower level encodeLinear while handling vector sizes appropriately
 	 *
@@ -124,6 +141,68 @@ namespace MSNumpress {
 		double fixedPoint);
 
 	/**
+	 * Encodes data as encodeLinear with the fixed point of 
+	 * optimalLinearFixedPoint, but reading data only once: the fixed point 
+	 * implied by the first two values is assumed and checked block by block 
+	 * while encoding. Only if a later residual lowers it is data encoded 
+	 * again. The result is the same as that of the two calls.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (8 + dataSize * 5 bytes)
+	 * @fixedPoint	set to the fixed point used
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodeLinearAuto(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double *fixedPoint);
+
+	/**
+	 * Calls lower level encodeLinearAuto while handling vector sizes appropriately
+	 *
+	 * @data		vector of doubles to be encoded
+	 * @result		vector of resulting bytes (will be resized to the number of bytes)
+	 * @return		the fixed point used
+	 */
+	double encodeLinearAuto(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result);
+
+	/**
+	 * Encodes data as encodeLinear with the fixed point of 
+	 * optimalLinearFixedPointMass, reading data once. Stops at the first 
+	 * block of data for which the accuracy cannot be reached.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (8 + dataSize * 5 bytes)
+	 * @mass_acc	desired m/z accuracy in Th
+	 * @fixedPoint	set to the fixed point used, or -1 in case of failure
+	 * @return		the number of encoded bytes, or 0 in case of failure
+	 */
+	size_t encodeLinearAutoMass(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double mass_acc,
+		double *fixedPoint);
+
+	/**
+	 * Calls lower level encodeLinearAutoMass while handling vector sizes appropriately
+	 *
+	 * @data		vector of doubles to be encoded
+	 * @result		vector of resulting bytes (will be resized to the number of bytes, 0 on failure)
+	 * @mass_acc	desired m/z accuracy in Th
+	 * @return		the fixed point used, or -1 in case of failure
+	 */
+	double encodeLinearAutoMass(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double mass_acc);
+
+	/**
      * Decodes data encoded by encodeLinear. 
 	 *
 	 * result vector guaranteed to be shorter or equal to (|data| - 8) * 2
@@ -141,6 +220,51 @@ namespace MSNumpress {
 		const unsigned char *data,
 		const size_t dataSize,
 		double *result);
+
+	/**
+	 * Computes the number of doubles decodeLinear would decode, reading only
+	 * the header halfbytes of the encoded ints. Throws where decodeLinear would.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @return		the number of doubles decodeLinear returns
+	 */
+	size_t decodedCountLinear(
+		const unsigned char *data,
+		const size_t dataSize);
+
+	/**
+	 * The indices [begin, end) of a slice of a decoded array.
+	 */
+	struct IndexRange {
+		size_t begin;
+		size_t end;
+	};
+
+	/**
+	 * Decodes only the values of a sorted (e.g. m/z) array encoded by 
+	 * encodeLinear that lie in [lo, hi]. Values below lo are reconstructed 
+	 * but not converted to doubles, and decoding stops at the first value 
+	 * above hi, so the rest of the data is neither read nor checked for
+	 * corruption. The returned indices give the slice to decode from the 
+	 * matching intensity array with decodePicSlice or decodeSlofSlice.
+	 *
+	 * Values are compared as decodeLinear would return them.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @lo			smallest value to decode
+	 * @hi			largest value to decode
+	 * @result		pointer to were the end - begin resulting doubles should be 
+	 *				stored (needs room for decodeLinear's result)
+	 * @return		the indices of the decoded values in the whole array
+	 */
+	IndexRange decodeLinearRange(
+		const unsigned char *data,
+		const size_t dataSize,
+		double lo,
+		double hi,
+		double *result);
 	
 	/**
 	 * Calls lower level decodeLinear while handling vector sizes appropriately
@@ -213,6 +337,18 @@ namespace MSNumpress {
 		const double *data, 
 		const size_t dataSize, 
 		unsigned char *result);
+
+	/**
+	 * Computes the number of bytes encodePic would write, without writing
+	 * them. Throws where encodePic would.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @return		the number of bytes encodePic returns
+	 */
+	size_t encodedSizePic(
+		const double *data, 
+		size_t dataSize);
 		
 	/**
 	 * Calls lower level encodePic while handling vector sizes appropriately
@@ -242,6 +378,37 @@ namespace MSNumpress {
 		const unsigned char *data,
 		const size_t dataSize,
 		double *result);
+
+	/**
+	 * Computes the number of doubles decodePic would decode, reading only the
+	 * header halfbytes of the encoded ints. Throws where decodePic would.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @return		the number of doubles decodePic returns
+	 */
+	size_t decodedCountPic(
+		const unsigned char *data,
+		const size_t dataSize);
+
+	/**
+	 * Decodes the values with indices [begin, end) of an array encoded by 
+	 * encodePic, only walking the header halfbytes of the ints before begin.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @begin		index of the first value to decode
+	 * @end			index after the last value to decode
+	 * @result		pointer to were resulting doubles should be stored
+	 * @return		the number of decoded doubles, less than end - begin if 
+	 *				the array is shorter
+	 */
+	size_t decodePicSlice(
+		const unsigned char *data,
+		const size_t dataSize,
+		size_t begin,
+		size_t end,
+		double *result);
 	
 	/**
 	 * Calls lower level decodePic while handling vector sizes appropriately
@@ -299,6 +466,11 @@ namespace MSNumpress {
 	 *
 	 * The return will include exactly (|data| - 8) / 2 doubles.
 	 *
+	 * Once a fixed point has been used for a few ten thousand values, all 65536 
+	 * possible values for it are computed once and then looked up. The 512 kB 
+	 * tables of the 4 most recently used fixed points are kept between calls
+	 * (shared by all threads).
+	 *
 	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
 	 *
 	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
@@ -310,6 +482,25 @@ namespace MSNumpress {
 		const unsigned char *data, 
 		const size_t dataSize, 
 		double *result);
+
+	/**
+	 * Decodes the values with indices [begin, end) of an array encoded by 
+	 * encodeSlof, reading only their bytes.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @begin		index of the first value to decode
+	 * @end			index after the last value to decode
+	 * @result		pointer to were resulting doubles should be stored
+	 * @return		the number of decoded doubles, less than end - begin if 
+	 *				the array is shorter
+	 */
+	size_t decodeSlofSlice(
+		const unsigned char *data, 
+		const size_t dataSize, 
+		size_t begin,
+		size_t end,
+		double *result);
 	
 	/**
 	 * Calls lower level decodeSlof while handling vector sizes appropriately
@@ -323,6 +514,1568 @@ namespace MSNumpress {
 		const std::vector<unsigned char> &data,
 		std::vector<double> &result);
 
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * Framed Linear and Pic arrays are split into blocks of a fixed number of
+	 * values, each encoded by encodeLinear or encodePic on its own and found
+	 * through a table of block offsets, so that the blocks of one large array
+	 * can be decoded in parallel. 
+	 *
+	 * A framed array starts with the bytes 0xff 0xf8 'N' 'P', a format byte,
+	 * a version byte and 2 reserved bytes. Where a classic Linear array stores 
+	 * its fixed point these read as NaN, which decodeLinear rejects, and 
+	 * encodePic never starts an array with them. See isFramed.
+	 *
+	 * Each block carries its own 8 bytes of fixed point (Linear), and the 
+	 * frame adds 32 bytes plus 8 per block.
+	 */
+
+	/**
+	 * Returns whether data starts with the tag of a framed array
+	 */
+	bool isFramed(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Returns the maximal number of bytes encodeLinearFramed or encodePicFramed
+	 * write for dataSize values in blocks of blockSize.
+	 */
+	size_t maxFramedSize(
+		size_t dataSize,
+		size_t blockSize);
+
+	/**
+	 * Encodes data as encodeLinear would, but in independent blocks.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxFramedSize bytes)
+	 * @fixedPoint	the scaling factor used for getting the fixed point repr. 
+	 * @blockSize	number of values per block, e.g. 65536
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodeLinearFramed(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint,
+		size_t blockSize);
+
+	/**
+	 * Calls lower level encodeLinearFramed while handling vector sizes appropriately
+	 */
+	void encodeLinearFramed(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		size_t blockSize);
+
+	/**
+	 * Decodes data encoded by encodeLinearFramed, the blocks spread over up
+	 * to threads threads.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to were resulting doubles should be stored (decodedCountFramed of them)
+	 * @threads		maximal number of threads to use, 0 for one per core
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodeLinearFramed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads);
+
+	/**
+	 * Calls lower level decodeLinearFramed while handling vector sizes appropriately
+	 */
+	void decodeLinearFramed(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result,
+		size_t threads);
+
+	/**
+	 * Encodes data as encodePic would, but in independent blocks.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxFramedSize bytes)
+	 * @blockSize	number of values per block, e.g. 65536
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodePicFramed(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		size_t blockSize);
+
+	/**
+	 * Calls lower level encodePicFramed while handling vector sizes appropriately
+	 */
+	void encodePicFramed(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		size_t blockSize);
+
+	/**
+	 * Decodes data encoded by encodePicFramed, the blocks spread over up
+	 * to threads threads.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to were resulting doubles should be stored (decodedCountFramed of them)
+	 * @threads		maximal number of threads to use, 0 for one per core
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodePicFramed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads);
+
+	/**
+	 * Calls lower level decodePicFramed while handling vector sizes appropriately
+	 */
+	void decodePicFramed(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result,
+		size_t threads);
+
+	/**
+	 * Returns the number of values in a framed array, reading only its header
+	 * and checking its block offsets.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountFramed(
+		const unsigned char *data,
+		size_t dataSize);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * Indexed Linear arrays hold a classic encodeLinear array behind a table
+	 * of checkpoints, one every interval values, each with the position of 
+	 * the value's residual (byte offset and halfbyte), the ints of the two 
+	 * values before it and the value itself. Any value can then be decoded
+	 * after reconstructing at most interval - 1 others, and a sorted (m/z)
+	 * array can be searched by binary search over the checkpoints.
+	 *
+	 * They start with a tag like framed arrays (see isFramed), so that 
+	 * decodeLinear and decodeLinearFramed reject them, and add 24 bytes plus
+	 * 32 per checkpoint to the classic array.
+	 */
+
+	/**
+	 * Returns the maximal number of bytes encodeLinearIndexed writes for 
+	 * dataSize values with a checkpoint every interval values.
+	 */
+	size_t maxIndexedSize(
+		size_t dataSize,
+		size_t interval);
+
+	/**
+	 * Encodes data as encodeLinear would, followed by checkpoints.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxIndexedSize bytes)
+	 * @fixedPoint	the scaling factor used for getting the fixed point repr. 
+	 * @interval	number of values per checkpoint, at least 2, e.g. 256
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodeLinearIndexed(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint,
+		size_t interval);
+
+	/**
+	 * Calls lower level encodeLinearIndexed while handling vector sizes appropriately
+	 */
+	void encodeLinearIndexed(
+		const std::vector<double> &data, 
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		size_t interval);
+
+	/**
+	 * Returns the number of values in an indexed Linear array, reading only
+	 * its header.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountIndexed(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Decodes all values of an array encoded by encodeLinearIndexed.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to were resulting doubles should be stored (decodedCountIndexed of them)
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodeLinearIndexed(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodeLinearIndexed while handling vector sizes appropriately
+	 */
+	void decodeLinearIndexed(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result);
+
+	/**
+	 * Decodes the values with indices [begin, end) of an array encoded by 
+	 * encodeLinearIndexed, starting from the checkpoint before begin. Only 
+	 * the checkpoint and the bytes up to the last value are read.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @begin		index of the first value to decode
+	 * @end			index after the last value to decode
+	 * @result		pointer to were resulting doubles should be stored
+	 * @return		the number of decoded doubles, less than end - begin if 
+	 *				the array is shorter
+	 */
+	size_t decodeLinearIndexedSlice(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t begin,
+		size_t end,
+		double *result);
+
+	/**
+	 * Returns the index of the first value of a sorted array encoded by 
+	 * encodeLinearIndexed that is not less than value (as decoded), or the 
+	 * number of values if there is none. Binary searches the checkpoints, 
+	 * then reconstructs the ints of at most one interval.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t lowerBoundLinearIndexed(
+		const unsigned char *data,
+		size_t dataSize,
+		double value);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * A seek index is a sidecar to a classic encodeLinear or encodePic array
+	 * holding the same checkpoints as an indexed Linear array (positions only
+	 * for Pic), so that arrays already stored can be decoded from any value
+	 * and in parallel without being rewritten. It is built in one pass that
+	 * decodes the ints of Linear arrays but no doubles, and only walks the 
+	 * header halfbytes of Pic arrays.
+	 *
+	 * It takes 32 bytes plus 32 (Linear) or 8 (Pic) per checkpoint, and is
+	 * checked against the size of the array it is used with.
+	 */
+
+	/**
+	 * Returns the maximal number of bytes seekIndexLinear or seekIndexPic 
+	 * write for an array of dataSize bytes.
+	 */
+	size_t maxSeekIndexSize(
+		size_t dataSize,
+		size_t interval);
+
+	/**
+	 * Builds the seek index of an array encoded by encodeLinear.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be indexed (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to index
+	 * @interval	number of values per checkpoint, at least 2, e.g. 256
+	 * @index		pointer to where the index should be stored (maxSeekIndexSize bytes)
+	 * @return		the number of bytes in the index
+	 */
+	size_t seekIndexLinear(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t interval,
+		unsigned char *index);
+
+	/**
+	 * Calls lower level seekIndexLinear while handling vector sizes appropriately
+	 */
+	void seekIndexLinear(
+		const std::vector<unsigned char> &data,
+		size_t interval,
+		std::vector<unsigned char> &index);
+
+	/**
+	 * Builds the seek index of an array encoded by encodePic.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be indexed (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to index
+	 * @interval	number of values per checkpoint, at least 1, e.g. 256
+	 * @index		pointer to where the index should be stored (maxSeekIndexSize bytes)
+	 * @return		the number of bytes in the index
+	 */
+	size_t seekIndexPic(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t interval,
+		unsigned char *index);
+
+	/**
+	 * Calls lower level seekIndexPic while handling vector sizes appropriately
+	 */
+	void seekIndexPic(
+		const std::vector<unsigned char> &data,
+		size_t interval,
+		std::vector<unsigned char> &index);
+
+	/**
+	 * Returns the number of values in the array a seek index belongs to.
+	 *
+	 * Note that this method may throw a const char* if it deems the index to be corrupt.
+	 */
+	size_t decodedCountSeek(
+		const unsigned char *index,
+		size_t indexSize);
+
+	/**
+	 * Decodes the values with indices [begin, end) of an array encoded by 
+	 * encodeLinear, starting from the checkpoint of its seek index before 
+	 * begin, see decodeLinearIndexedSlice.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @index		pointer to the seek index built by seekIndexLinear for data
+	 * @indexSize	number of bytes in the index
+	 * @begin		index of the first value to decode
+	 * @end			index after the last value to decode
+	 * @result		pointer to were resulting doubles should be stored
+	 * @return		the number of decoded doubles, less than end - begin if 
+	 *				the array is shorter
+	 */
+	size_t decodeLinearSlice(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		size_t begin,
+		size_t end,
+		double *result);
+
+	/**
+	 * Returns the index of the first value of a sorted array encoded by 
+	 * encodeLinear that is not less than value, using its seek index, see
+	 * lowerBoundLinearIndexed.
+	 */
+	size_t lowerBoundLinear(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		double value);
+
+	/**
+	 * Decodes the values with indices [begin, end) of an array encoded by 
+	 * encodePic, starting from the checkpoint of its seek index before begin.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @index		pointer to the seek index built by seekIndexPic for data
+	 * @indexSize	number of bytes in the index
+	 * @begin		index of the first value to decode
+	 * @end			index after the last value to decode
+	 * @result		pointer to were resulting doubles should be stored
+	 * @return		the number of decoded doubles, less than end - begin if 
+	 *				the array is shorter
+	 */
+	size_t decodePicSlice(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		size_t begin,
+		size_t end,
+		double *result);
+
+	/**
+	 * Decodes an array encoded by encodeLinear in parts starting at the 
+	 * checkpoints of its seek index, spread over up to threads threads.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @index		pointer to the seek index built by seekIndexLinear for data
+	 * @indexSize	number of bytes in the index
+	 * @result		pointer to were resulting doubles should be stored (decodedCountSeek of them)
+	 * @threads		maximal number of threads to use, 0 for one per core
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodeLinearParallel(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		double *result,
+		size_t threads);
+
+	/**
+	 * Decodes an array encoded by encodePic in parts starting at the 
+	 * checkpoints of its seek index, spread over up to threads threads.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @index		pointer to the seek index built by seekIndexPic for data
+	 * @indexSize	number of bytes in the index
+	 * @result		pointer to were resulting doubles should be stored (decodedCountSeek of them)
+	 * @threads		maximal number of threads to use, 0 for one per core
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodePicParallel(
+		const unsigned char *data,
+		size_t dataSize,
+		const unsigned char *index,
+		size_t indexSize,
+		double *result,
+		size_t threads);
+
+	/**
+	 * Decodes an array encoded by encodePic on up to threads threads without
+	 * a seek index, giving exactly what decodePic gives.
+	 *
+	 * The array is cut into chunks of bytes that are first walked from a 
+	 * guessed int boundary each, then reconciled with the true int boundaries,
+	 * which the guesses usually meet after a few ints, and then decoded from
+	 * where they truly start. Chunks where the guess does not meet the true 
+	 * boundaries soon are walked again serially, so the speedup depends on 
+	 * the data but the result does not.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to were resulting doubles should be stored (decodedCountPic of them)
+	 * @threads		maximal number of threads to use, 0 for one per core
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodePicParallel(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result,
+		size_t threads);
+
+	/**
+	 * Calls lower level decodePicParallel while handling vector sizes appropriately
+	 */
+	void decodePicParallel(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result,
+		size_t threads);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * The batch functions en- or decode many arrays in one call, spread over
+	 * several threads. The arrays are stored back to back, array k being 
+	 * elements offsets[k] to offsets[k+1] of data, and so are the results.
+	 * The results do not depend on the number of threads.
+	 *
+	 * Linear arrays are encoded with the fixed point of optimalLinearFixedPoint
+	 * (see encodeLinearAuto), Slof arrays with that of optimalSlofFixedPoint.
+	 */
+	enum BatchCodec {
+		BATCH_LINEAR,
+		BATCH_PIC,
+		BATCH_SLOF,
+		BATCH_SAFE
+	};
+
+	/**
+	 * Returns the maximal number of bytes encodeBatch writes for the arrays
+	 * given by offsets.
+	 */
+	size_t maxEncodedBatchSize(
+		BatchCodec codec,
+		const size_t *offsets,
+		size_t count);
+
+	/**
+	 * Encodes count arrays with the given codec.
+	 *
+	 * @codec			the codec to encode the arrays with
+	 * @data			pointer to the doubles of all arrays
+	 * @offsets			count + 1 offsets into data where the arrays start and end
+	 * @count			number of arrays
+	 * @result			pointer to where resulting bytes should be stored (maxEncodedBatchSize of them)
+	 * @resultOffsets	set to the count + 1 offsets of the encoded arrays in result
+	 * @threads			maximal number of threads to use, 0 for one per core
+	 * @return			the number of encoded bytes
+	 */
+	size_t encodeBatch(
+		BatchCodec codec,
+		const double *data,
+		const size_t *offsets,
+		size_t count,
+		unsigned char *result,
+		size_t *resultOffsets,
+		size_t threads);
+
+	/**
+	 * Calls lower level encodeBatch while handling vector sizes appropriately
+	 *
+	 * @offsets			offsets of the arrays in data (one more than there are arrays)
+	 */
+	void encodeBatch(
+		BatchCodec codec,
+		const std::vector<double> &data,
+		const std::vector<size_t> &offsets,
+		std::vector<unsigned char> &result,
+		std::vector<size_t> &resultOffsets,
+		size_t threads);
+
+	/**
+	 * Computes where decodeBatch will put the values of each array.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @resultOffsets	set to the count + 1 offsets of the decoded arrays 
+	 * @return			the total number of decoded doubles
+	 */
+	size_t decodedCountBatch(
+		BatchCodec codec,
+		const unsigned char *data,
+		const size_t *offsets,
+		size_t count,
+		size_t *resultOffsets,
+		size_t threads);
+
+	/**
+	 * Decodes count arrays encoded with the given codec.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 *
+	 * @codec			the codec the arrays are encoded with
+	 * @data			pointer to the bytes of all arrays
+	 * @offsets			count + 1 offsets into data where the arrays start and end
+	 * @count			number of arrays
+	 * @result			pointer to where resulting doubles should be stored
+	 * @resultOffsets	the offsets computed by decodedCountBatch
+	 * @threads			maximal number of threads to use, 0 for one per core
+	 */
+	void decodeBatch(
+		BatchCodec codec,
+		const unsigned char *data,
+		const size_t *offsets,
+		size_t count,
+		double *result,
+		const size_t *resultOffsets,
+		size_t threads);
+
+	/**
+	 * Calls lower level decodedCountBatch and decodeBatch while handling 
+	 * vector sizes appropriately
+	 */
+	void decodeBatch(
+		BatchCodec codec,
+		const std::vector<unsigned char> &data,
+		const std::vector<size_t> &offsets,
+		std::vector<double> &result,
+		std::vector<size_t> &resultOffsets,
+		size_t threads);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * The base64 functions combine numpress with the base64 text it is 
+	 * usually stored as (e.g. in mzML). The decoders decode the text a tile
+	 * of a few kB at a time straight into the values, instead of first 
+	 * decoding all of it into a byte buffer, and the encoders encode the 
+	 * bytes as they are produced. Both give exactly what base64 with the
+	 * standard alphabet and the classic functions give.
+	 *
+	 * The text may end with or without '=' padding, but may not contain 
+	 * whitespace or any other character outside the alphabet; such text 
+	 * throws.
+	 */
+
+	/**
+	 * Decodes base64 text of an array encoded by encodeLinear.
+	 *
+	 * @text		pointer to the base64 characters
+	 * @textSize	number of characters
+	 * @result		pointer to where resulting doubles should be stored,
+	 *				room for textSize * 3 / 2 doubles always suffices
+	 * @return		the number of decoded doubles
+	 */
+	size_t decodeLinearBase64(
+		const char *text,
+		size_t textSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodeLinearBase64 while handling vector sizes appropriately
+	 */
+	void decodeLinearBase64(
+		const char *text,
+		size_t textSize,
+		std::vector<double> &result);
+
+	/**
+	 * Decodes base64 text of an array encoded by encodePic. See decodeLinearBase64.
+	 */
+	size_t decodePicBase64(
+		const char *text,
+		size_t textSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodePicBase64 while handling vector sizes appropriately
+	 */
+	void decodePicBase64(
+		const char *text,
+		size_t textSize,
+		std::vector<double> &result);
+
+	/**
+	 * Decodes base64 text of an array encoded by encodeSlof. See decodeLinearBase64.
+	 */
+	size_t decodeSlofBase64(
+		const char *text,
+		size_t textSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodeSlofBase64 while handling vector sizes appropriately
+	 */
+	void decodeSlofBase64(
+		const char *text,
+		size_t textSize,
+		std::vector<double> &result);
+
+	/**
+	 * The number of base64 characters, padding included, for byteCount bytes.
+	 * The result of encodeLinearBase64 fits in maxBase64Size(dataSize * 5 + 8)
+	 * characters, that of encodePicBase64 in maxBase64Size(dataSize * 5)
+	 * and that of encodeSlofBase64 in maxBase64Size(dataSize * 2 + 8).
+	 */
+	size_t maxBase64Size(
+		size_t byteCount);
+
+	/**
+	 * Encodes data as encodeLinear does, straight into padded base64 text.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting characters should be stored
+	 * @fixedPoint	the scaling factor used for getting the fixed point repr. 
+	 * @return		the number of encoded characters
+	 */
+	size_t encodeLinearBase64(
+		const double *data,
+		size_t dataSize,
+		char *result,
+		double fixedPoint);
+
+	/**
+	 * Calls lower level encodeLinearBase64 while handling string sizes appropriately
+	 */
+	void encodeLinearBase64(
+		const std::vector<double> &data,
+		std::string &result,
+		double fixedPoint);
+
+	/**
+	 * Encodes data as encodePic does, straight into padded base64 text. 
+	 * See encodeLinearBase64.
+	 */
+	size_t encodePicBase64(
+		const double *data,
+		size_t dataSize,
+		char *result);
+
+	/**
+	 * Calls lower level encodePicBase64 while handling string sizes appropriately
+	 */
+	void encodePicBase64(
+		const std::vector<double> &data,
+		std::string &result);
+
+	/**
+	 * Encodes data as encodeSlof does, straight into padded base64 text. 
+	 * See encodeLinearBase64.
+	 */
+	size_t encodeSlofBase64(
+		const double *data,
+		size_t dataSize,
+		char *result,
+		double fixedPoint);
+
+	/**
+	 * Calls lower level encodeSlofBase64 while handling string sizes appropriately
+	 */
+	void encodeSlofBase64(
+		const std::vector<double> &data,
+		std::string &result,
+		double fixedPoint);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * PicSV is an alternative to Pic for the same non-negative ints, laid 
+	 * out after Stream VByte (D. Lemire, N. Kurz, C. Rupp, "Stream VByte: 
+	 * Faster Byte-Oriented Integer Compression", 2018): the lengths of the 
+	 * ints are kept apart from their bytes, so that the decoder knows where
+	 * every int is before reading it, and moves 4 or 8 of them into place 
+	 * with one byte shuffle.
+	 *
+	 * The array starts with a tag like framed arrays (see isFramed) and the
+	 * number of values (8 bytes). Then follows a 2 bit code per value, 4 to
+	 * a control byte starting at the low bits, for 0, 1, 2 or 4 little-endian
+	 * data bytes, and then the data bytes. Zeros take 2 bits, ints below 256 
+	 * 10 bits and below 65536 18 bits, against Pic's 4, 12 and 20.
+	 */
+
+	/**
+	 * Returns the maximal number of bytes encodePicSV writes for dataSize values
+	 */
+	size_t maxPicSVSize(
+		size_t dataSize);
+
+	/**
+	 * Encodes ion counts as ints like encodePic, in the PicSV layout.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxPicSVSize bytes)
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodePicSV(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result);
+
+	/**
+	 * Calls lower level encodePicSV while handling vector sizes appropriately
+	 */
+	void encodePicSV(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result);
+
+	/**
+	 * Returns the number of values in a PicSV array, reading only its header.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountPicSV(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Decodes data encoded by encodePicSV, giving the values decodePic gives
+	 * for the same ints.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to where resulting doubles should be stored (decodedCountPicSV doubles)
+	 * @return		the number of decoded doubles
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt, 
+	 * i.e. if its data bytes are not exactly the ones its control bytes give.
+	 */
+	size_t decodePicSV(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodePicSV while handling vector sizes appropriately
+	 */
+	void decodePicSV(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * PicFOR is another alternative to Pic for the same ints, which suits 
+	 * arrays with narrow local ranges such as profile intensities. The ints
+	 * are stored in blocks of 128 by frame of reference with patching 
+	 * (PFOR, M. Zukowski et al., "Super-Scalar RAM-CPU Cache Compression", 
+	 * 2006): the block minimum and, for every int, the low bits of its 
+	 * offset from it, packed at a width chosen per block. The offsets that
+	 * do not fit are exceptions: after the packed bits come their positions
+	 * and the bits of their offsets above the width, which the decoder 
+	 * patches in.
+	 *
+	 * The array starts with a tag like framed arrays (see isFramed) and the
+	 * number of values (8 bytes). Every block then has its minimum (4 bytes),
+	 * bit width, exception count and exception bit width (a byte each), the 
+	 * packed offsets, least significant bits first, the positions of the 
+	 * exceptions (a byte each) and their high bits, packed the same way at 
+	 * the exception bit width.
+	 */
+
+	/**
+	 * Returns the maximal number of bytes encodePicFOR writes for dataSize values
+	 */
+	size_t maxPicFORSize(
+		size_t dataSize);
+
+	/**
+	 * Encodes ion counts as ints like encodePic, in the PicFOR layout.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxPicFORSize bytes)
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodePicFOR(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result);
+
+	/**
+	 * Calls lower level encodePicFOR while handling vector sizes appropriately
+	 */
+	void encodePicFOR(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result);
+
+	/**
+	 * Returns the number of values in a PicFOR array, reading only its header.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountPicFOR(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Decodes data encoded by encodePicFOR, giving the values decodePic gives
+	 * for the same ints.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to where resulting doubles should be stored (decodedCountPicFOR doubles)
+	 * @return		the number of decoded doubles
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodePicFOR(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodePicFOR while handling vector sizes appropriately
+	 */
+	void decodePicFOR(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * PicZR is Pic with zero runs, for sparse arrays such as profile 
+	 * intensities that are mostly zero. A run of zeros is one token: the 
+	 * int header 0xf, which Pic never writes for ints up to INT_MAX, and a 
+	 * halfbyte k for a run of k + 2 zeros, or for k = 15 a run of 17 plus
+	 * the next int. Other ints are as in Pic, so a run of 2 takes a byte 
+	 * like two zeros, a run of 16 a byte instead of 8, and a run of 1000 
+	 * 3 bytes instead of 500.
+	 *
+	 * The array starts with a tag like framed arrays (see isFramed) and the
+	 * number of values (8 bytes), followed by the halfbytes.
+	 */
+
+	/**
+	 * Returns the maximal number of bytes encodePicZR writes for dataSize values
+	 */
+	size_t maxPicZRSize(
+		size_t dataSize);
+
+	/**
+	 * Encodes ion counts as ints like encodePic, with runs of zeros as tokens.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxPicZRSize bytes)
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodePicZR(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result);
+
+	/**
+	 * Calls lower level encodePicZR while handling vector sizes appropriately
+	 */
+	void encodePicZR(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result);
+
+	/**
+	 * Returns the number of values in a PicZR array, reading only its header.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountPicZR(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Decodes data encoded by encodePicZR, giving the values decodePic gives
+	 * for the same ints. Runs are written as blocks of zero bytes.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to where resulting doubles should be stored (decodedCountPicZR doubles)
+	 * @return		the number of decoded doubles
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt,
+	 * i.e. if its values do not add up to the count in its header.
+	 */
+	size_t decodePicZR(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodePicZR while handling vector sizes appropriately
+	 */
+	void decodePicZR(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result);
+
+	/**
+	 * Decodes only the values of a PicZR array that are not zero, with their 
+	 * indices, skipping runs without writing anything for them.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @indices		pointer to where the indices of the values should be stored
+	 * @values		pointer to where the values should be stored; both need room
+	 *				for 2 * dataSize entries, or decodedCountPicZR if fewer
+	 * @return		the number of values that are not zero
+	 */
+	size_t decodePicZRSparse(
+		const unsigned char *data,
+		size_t dataSize,
+		size_t *indices,
+		double *values);
+
+	/**
+	 * Calls lower level decodePicZRSparse while handling vector sizes appropriately
+	 */
+	void decodePicZRSparse(
+		const std::vector<unsigned char> &data,
+		std::vector<size_t> &indices,
+		std::vector<double> &values);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * LinearRL is Linear with runs, for retention time and ion mobility 
+	 * arrays that are evenly spaced, or repeat values, for many points. 
+	 * Residuals are as in Linear, except for two tokens followed by a count:
+	 * one for values that continue the last difference (residuals of 0), 
+	 * one for values that repeat the last value. The tokens take the 
+	 * residuals -7 and -8, and residuals from -9 on down are written 2
+	 * lower, so a residual must lie in [-INT_MAX+1, INT_MAX].
+	 *
+	 * The array starts with a tag like framed arrays (see isFramed), the 
+	 * fixed point (8 bytes) and the number of values (8 bytes), followed by
+	 * the first two values as in Linear and the halfbytes.
+	 */
+
+	/**
+	 * Returns the maximal number of bytes encodeLinearRL writes for dataSize values
+	 */
+	size_t maxLinearRLSize(
+		size_t dataSize);
+
+	/**
+	 * Encodes data as encodeLinear does, with runs as tokens wherever that
+	 * takes fewer halfbytes.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxLinearRLSize bytes)
+	 * @fixedPoint	the scaling factor used for getting the fixed point repr. 
+	 * 				This is stored in the binary and automatically extracted
+	 * 				on decoding (see optimalLinearFixedPoint).
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodeLinearRL(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double fixedPoint);
+
+	/**
+	 * Calls lower level encodeLinearRL while handling vector sizes appropriately
+	 */
+	void encodeLinearRL(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result,
+		double fixedPoint);
+
+	/**
+	 * Returns the number of values in a LinearRL array, reading only its header.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountLinearRL(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Decodes data encoded by encodeLinearRL, giving the values decodeLinear
+	 * gives for the same ints. Runs are filled by the same vectorized code
+	 * as other values, without decoding a residual per value.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to where resulting doubles should be stored (decodedCountLinearRL doubles)
+	 * @return		the number of decoded doubles
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt,
+	 * i.e. if its values do not add up to the count in its header.
+	 */
+	size_t decodeLinearRL(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodeLinearRL while handling vector sizes appropriately
+	 */
+	void decodeLinearRL(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * LinearLog is Linear on log(m/z). Instrument error is relative, and a
+	 * fixed point in the log domain is a constant error in ppm over the
+	 * whole range, where Linear is as precise at m/z 100 as at m/z 2000. 
+	 * The fixed point is chosen from a ppm tolerance.
+	 *
+	 * The array starts with a tag like framed arrays (see isFramed), the 
+	 * fixed point (8 bytes) and the number of values (8 bytes), followed by
+	 * the fixed point logs of the first two values (8 bytes each) and the
+	 * residuals as in Linear.
+	 */
+
+	/**
+	 * Returns the fixed point for log(m/z) that keeps every decoded value 
+	 * within ppm of the original, or -1 if ppm is not in (0, 1e6] or too 
+	 * small for doubles to reach (below about 1e-6 ppm).
+	 */
+	double optimalLinearLogFixedPoint(
+		double ppm);
+
+	/**
+	 * Returns the maximal number of bytes encodeLinearLog writes for dataSize values
+	 */
+	size_t maxLinearLogSize(
+		size_t dataSize);
+
+	/**
+	 * Encodes the logs of data with optimalLinearLogFixedPoint(ppm), so that
+	 * |decoded / data[i] - 1| <= ppm * 1e-6 for every value.
+	 *
+	 * @data		pointer to array of positive doubles to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		pointer to where resulting bytes should be stored (maxLinearLogSize bytes)
+	 * @ppm			the tolerance in parts per million
+	 * @return		the number of encoded bytes
+	 */
+	size_t encodeLinearLog(
+		const double *data, 
+		size_t dataSize, 
+		unsigned char *result,
+		double ppm);
+
+	/**
+	 * Calls lower level encodeLinearLog while handling vector sizes appropriately
+	 */
+	void encodeLinearLog(
+		const std::vector<double> &data,
+		std::vector<unsigned char> &result,
+		double ppm);
+
+	/**
+	 * Returns the number of values in a LinearLog array, reading only its header.
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt.
+	 */
+	size_t decodedCountLinearLog(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Decodes data encoded by encodeLinearLog.
+	 *
+	 * @data		pointer to array of bytes to be decoded (need memorycont. repr.)
+	 * @dataSize	number of bytes from *data to decode
+	 * @result		pointer to where resulting doubles should be stored (decodedCountLinearLog doubles)
+	 * @return		the number of decoded doubles
+	 *
+	 * Note that this method may throw a const char* if it deems the input data to be corrupt,
+	 * i.e. if its values do not add up to the count in its header.
+	 */
+	size_t decodeLinearLog(
+		const unsigned char *data,
+		size_t dataSize,
+		double *result);
+
+	/**
+	 * Calls lower level decodeLinearLog while handling vector sizes appropriately
+	 */
+	void decodeLinearLog(
+		const std::vector<unsigned char> &data,
+		std::vector<double> &result);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * A view of size consecutive elements owned by someone else
+	 */
+	template <typename T>
+	struct Span {
+		T *data;
+		size_t size;
+
+		T *begin() const { return data; }
+		T *end() const { return data + size; }
+		T &operator[](size_t i) const { return data[i]; }
+	};
+
+	/**
+	 * En- and decoding context that keeps its output buffers between calls,
+	 * so that en- or decoding many small arrays does not allocate (or zero)
+	 * memory for each of them.
+	 *
+	 * Every call writes to the end of the byte (encoders) or double (decoders)
+	 * buffer, which only grows, and is never initialized beyond what is 
+	 * written. By default the buffers are emptied before each call; in append
+	 * mode the results of consecutive calls are kept back to back until 
+	 * clear() is called. The returned spans, and those of bytes() and 
+	 * doubles(), are valid until the next call that writes to the same buffer.
+	 *
+	 * The methods throw as the functions of the same name do. A Codec must 
+	 * not be used by several threads at once.
+	 */
+	class Codec {
+	public:
+		Codec();
+		~Codec();
+
+		/**
+		 * Keeps (append) or discards (!append) earlier results before each call
+		 */
+		void setAppend(
+			bool append);
+
+		/**
+		 * Empties both buffers, keeping the memory for later calls
+		 */
+		void clear();
+
+		Span<const unsigned char> encodeLinear(
+			const double *data, 
+			size_t dataSize, 
+			double fixedPoint);
+
+		Span<const unsigned char> encodePic(
+			const double *data, 
+			size_t dataSize);
+
+		Span<const unsigned char> encodeSlof(
+			const double *data, 
+			size_t dataSize, 
+			double fixedPoint);
+
+		Span<const unsigned char> encodeSafe(
+			const double *data, 
+			size_t dataSize);
+
+		Span<const double> decodeLinear(
+			const unsigned char *data, 
+			size_t dataSize);
+
+		Span<const double> decodePic(
+			const unsigned char *data, 
+			size_t dataSize);
+
+		Span<const double> decodeSlof(
+			const unsigned char *data, 
+			size_t dataSize);
+
+		Span<const double> decodeSafe(
+			const unsigned char *data, 
+			size_t dataSize);
+
+		/**
+		 * All encoded bytes in the buffer
+		 */
+		Span<const unsigned char> bytes() const;
+
+		/**
+		 * All decoded doubles in the buffer
+		 */
+		Span<const double> doubles() const;
+
+	private:
+		Codec(const Codec&);
+		Codec &operator=(const Codec&);
+
+		unsigned char *reserveBytes(size_t n);
+		double *reserveDoubles(size_t n);
+		Span<const unsigned char> commitBytes(size_t n);
+		Span<const double> commitDoubles(size_t n);
+
+		bool append_;
+		unsigned char *bytes_;
+		size_t byteCount_, byteCapacity_;
+		double *doubles_;
+		size_t doubleCount_, doubleCapacity_;
+	};
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * Receives the bytes of a streaming encoder, in order, size > 0
+	 */
+	typedef void (*ByteSink)(
+		void *context,
+		const unsigned char *bytes,
+		size_t size);
+
+	/**
+	 * Common part of LinearEncoder and PicEncoder: the pending halfbytes and
+	 * a small buffer of complete bytes, which are passed on to the sink when 
+	 * it fills up, or on flush() or finish().
+	 */
+	class StreamEncoder {
+	public:
+		/**
+		 * Passes all complete bytes to the sink. A last odd halfbyte is kept 
+		 * until more values are pushed or finish() is called.
+		 */
+		void flush();
+
+		/**
+		 * Pads and passes the remaining bytes to the sink. Nothing may be
+		 * pushed afterwards.
+		 *
+		 * @return		the number of bytes encoded in total
+		 */
+		size_t finish();
+
+	protected:
+		StreamEncoder(
+			ByteSink sink,
+			void *context);
+
+		void emitIfFull();
+
+		static const size_t BUFFER_SIZE = 4096;
+
+		ByteSink sink_;
+		void *context_;
+		unsigned long long acc_;
+		unsigned int bits_;
+		size_t count_;
+		size_t size_;
+		size_t emitted_;
+		unsigned char buffer_[BUFFER_SIZE];
+	};
+
+	/**
+	 * Encodes values as encodeLinear does, but as they arrive: values can be
+	 * pushed in chunks of any size, and the bytes go to sink as they are 
+	 * completed. After finish() the sink has received exactly the bytes 
+	 * encodeLinear would have written for all values pushed.
+	 *
+	 * If push throws (see encodeLinear), the encoder cannot be used further.
+	 */
+	class LinearEncoder : public StreamEncoder {
+	public:
+		LinearEncoder(
+			double fixedPoint,
+			ByteSink sink,
+			void *context);
+
+		void push(
+			const double *data,
+			size_t dataSize);
+
+	private:
+		double fixedPoint_;
+		long long ints_[3];
+	};
+
+	/**
+	 * Encodes values as encodePic does, but as they arrive. See LinearEncoder.
+	 */
+	class PicEncoder : public StreamEncoder {
+	public:
+		PicEncoder(
+			ByteSink sink,
+			void *context);
+
+		void push(
+			const double *data,
+			size_t dataSize);
+	};
+
+	/**
+	 * Common part of LinearDecoder, PicDecoder and SlofDecoder: the bytes
+	 * received that do not complete a value yet.
+	 */
+	class StreamDecoder {
+	public:
+		/**
+		 * The number of values decoded so far
+		 */
+		size_t count() const { return count_; }
+
+	protected:
+		StreamDecoder();
+
+		std::vector<unsigned char> pending_;
+		size_t half_;
+		size_t count_;
+	};
+
+	/**
+	 * Decodes an array encoded by encodeLinear as its bytes arrive: bytes can
+	 * be pushed in chunks of any size, and the values they complete are 
+	 * appended to result. After finish() exactly the values decodeLinear 
+	 * gives for all bytes pushed have been appended. Only the bytes of the 
+	 * last, incomplete value are copied and kept between pushes.
+	 *
+	 * If push or finish throws (see decodeLinear), the decoder cannot be 
+	 * used further.
+	 */
+	class LinearDecoder : public StreamDecoder {
+	public:
+		LinearDecoder();
+
+		void push(
+			const unsigned char *bytes,
+			size_t size,
+			std::vector<double> &result);
+
+		void finish(
+			std::vector<double> &result);
+
+	private:
+		double fixedPoint_;
+		long long ints_[2];
+	};
+
+	/**
+	 * Decodes an array encoded by encodePic as its bytes arrive. See LinearDecoder.
+	 */
+	class PicDecoder : public StreamDecoder {
+	public:
+		PicDecoder();
+
+		void push(
+			const unsigned char *bytes,
+			size_t size,
+			std::vector<double> &result);
+
+		void finish(
+			std::vector<double> &result);
+	};
+
+	/**
+	 * Decodes an array encoded by encodeSlof as its bytes arrive. See 
+	 * LinearDecoder. A last odd byte is ignored.
+	 */
+	class SlofDecoder : public StreamDecoder {
+	public:
+		SlofDecoder();
+
+		void push(
+			const unsigned char *bytes,
+			size_t size,
+			std::vector<double> &result);
+
+		void finish(
+			std::vector<double> &result);
+
+	private:
+		double fixedPoint_;
+		bool header_;
+	};
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * Forward iterator over the values of a Linear, Pic or Slof array, 
+	 * decoding them as it goes, a batch of BATCH_SIZE at a time. The values
+	 * are those decodeLinear, decodePic or decodeSlof would give. 
+	 *
+	 * Incrementing may throw a const char* where the decoder would. Copies 
+	 * share the decoder and its batch until one of them needs the next 
+	 * batch, which it then decodes into a decoder of its own, so copies are
+	 * cheap and advance independently.
+	 */
+	class DecodeIterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef double value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const double *pointer;
+		typedef const double &reference;
+
+		static const size_t BATCH_SIZE = 128;
+
+		// the end of every array
+		DecodeIterator();
+
+		reference operator*() const { return *value_; }
+		pointer operator->() const { return value_; }
+
+		DecodeIterator &operator++() {
+			index_++;
+			if (++value_ == last_) refill();
+			return *this;
+		}
+
+		DecodeIterator operator++(int) {
+			DecodeIterator previous(*this);
+			++*this;
+			return previous;
+		}
+
+		// iterators are only compared within an array, by position
+		bool operator==(const DecodeIterator &other) const { return index_ == other.index_; }
+		bool operator!=(const DecodeIterator &other) const { return index_ != other.index_; }
+
+	private:
+		friend class DecodeRange;
+		struct State;
+
+		DecodeIterator(
+			int codec,
+			const unsigned char *data,
+			size_t dataSize);
+
+		void refill();
+
+		std::shared_ptr<State> state_;
+		const double *value_;
+		const double *last_;
+		size_t index_;
+	};
+
+	/**
+	 * The values of an encoded array, as a range of DecodeIterator. The 
+	 * encoded bytes must outlive the range and its iterators. Each begin() 
+	 * starts decoding afresh, so the range can be iterated over repeatedly.
+	 */
+	class DecodeRange {
+	public:
+		DecodeIterator begin() const { return DecodeIterator(codec_, data_, dataSize_); }
+		DecodeIterator end() const { return DecodeIterator(); }
+
+	private:
+		friend DecodeRange decodeLinearLazy(const unsigned char*, size_t);
+		friend DecodeRange decodePicLazy(const unsigned char*, size_t);
+		friend DecodeRange decodeSlofLazy(const unsigned char*, size_t);
+
+		DecodeRange(
+			int codec,
+			const unsigned char *data,
+			size_t dataSize);
+
+		int codec_;
+		const unsigned char *data_;
+		size_t dataSize_;
+	};
+
+	/**
+	 * Returns the values of data encoded by encodeLinear, decoded as iterated 
+	 * over. Throws at once if the fixed point or first values are corrupt.
+	 */
+	DecodeRange decodeLinearLazy(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Returns the values of data encoded by encodePic, decoded as iterated over
+	 */
+	DecodeRange decodePicLazy(
+		const unsigned char *data,
+		size_t dataSize);
+
+	/**
+	 * Returns the values of data encoded by encodeSlof, decoded as iterated 
+	 * over. Throws at once if there is no fixed point.
+	 */
+	DecodeRange decodeSlofLazy(
+		const unsigned char *data,
+		size_t dataSize);
+
+/////////////////////////////////////////////////////////////
+
+	/**
+	 * The instruction set extensions the codecs' SIMD kernels may use. Each
+	 * tier produces the same bytes and doubles as SIMD_SCALAR.
+	 */
+	enum SimdTier {
+		SIMD_SCALAR = 0,
+		SIMD_SSE42 	= 1,
+		SIMD_AVX2 	= 2,
+		SIMD_AVX512 = 3
+	};
+
+	/**
+	 * Returns the tier in use. Unless set by setSimdTier, this is the best tier
+	 * the CPU supports, capped by the environment variable MSNUMPRESS_SIMD 
+	 * (scalar, sse42, avx2 or avx512) if set when first called.
+	 */
+	SimdTier simdTier();
+
+	/**
+	 * Uses the kernels of tier, or of the best tier the CPU supports if that is
+	 * lower. Not meant to be called while other threads are en- or decoding.
+	 *
+	 * @tier		the desired tier
+	 * @return		the tier now in use
+	 */
+	SimdTier setSimdTier(
+		SimdTier tier);
+
 } // namespace MSNumpress
 } // namespace msdata
 } // namespace pwiz
@@ -0,0 +1,185 @@
+/*
+	MSNumpressBenchmark.cpp
+	johan.teleman@immun.lth.se
+
+	Copyright 2013 Johan Teleman
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+	Compares the size and speed of the ion count codecs. Compile and run (on
+	LINUX) with
+
+	> g++ -O2 MSNumpress.cpp MSNumpressBenchmark.cpp -o benchmark && ./benchmark [files]
+
+	Every file holds one intensity array as raw little-endian doubles, e.g.
+	dumped from the spectra of a corpus. Without files, synthetic profile
+	and centroided arrays are used.
+ */
+
+#include "MSNumpress.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace ms::numpress::MSNumpress;
+
+typedef size_t (*EncodeFn)(const double*, size_t, unsigned char*);
+typedef size_t (*DecodeFn)(const unsigned char*, size_t, double*);
+
+struct IntCodec {
+	const char *name;
+	EncodeFn encode;
+	DecodeFn decode;
+};
+
+static const IntCodec CODECS[] = {
+	{ "Pic", 	encodePic, 		decodePic },
+	{ "PicSV", 	encodePicSV, 	decodePicSV },
+	{ "PicFOR", encodePicFOR, 	decodePicFOR },
+	{ "PicZR", 	encodePicZR, 	decodePicZR }
+};
+
+
+
+double seconds(
+		std::chrono::steady_clock::time_point start
+) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+
+/**
+ * Encodes and decodes all arrays with the codec until at least a second has
+ * passed, and prints the compressed size and the throughput in values.
+ */
+void benchmark(
+		const IntCodec &codec,
+		const std::vector<std::vector<double> > &arrays
+) {
+	size_t values = 0;
+	for (size_t a=0; a<arrays.size(); a++) {
+		values += arrays[a].size();
+	}
+
+	std::vector<std::vector<unsigned char> > encoded(arrays.size());
+	std::vector<double> decoded;
+	size_t bytes = 0;
+	for (size_t a=0; a<arrays.size(); a++) {
+		encoded[a].resize(16 + 8 * arrays[a].size());
+		encoded[a].resize(codec.encode(arrays[a].data(), arrays[a].size(), &encoded[a][0]));
+		bytes += encoded[a].size();
+	}
+
+	size_t rounds = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	do {
+		for (size_t a=0; a<arrays.size(); a++) {
+			codec.encode(arrays[a].data(), arrays[a].size(), &encoded[a][0]);
+		}
+		rounds++;
+	} while (seconds(start) < 1.0);
+	double encodeRate = rounds * values / seconds(start) / 1e6;
+
+	rounds = 0;
+	start = std::chrono::steady_clock::now();
+	do {
+		for (size_t a=0; a<arrays.size(); a++) {
+			decoded.resize(arrays[a].size());
+			codec.decode(encoded[a].data(), encoded[a].size(), decoded.data());
+		}
+		rounds++;
+	} while (seconds(start) < 1.0);
+	double decodeRate = rounds * values / seconds(start) / 1e6;
+
+	printf("%-8s %6.2f%% %8.2f bits/value %9.1f Mvalues/s encode %9.1f Mvalues/s decode\n",
+		codec.name, 100.0 * bytes / (8.0 * values), 8.0 * bytes / values, encodeRate, decodeRate);
+}
+
+
+
+/**
+ * Profile spectra: a noisy baseline, mostly zero, with Gaussian peaks
+ */
+std::vector<double> profileArray(
+		size_t n
+) {
+	std::vector<double> array(n);
+	for (size_t i=0; i<n; i+=500) {
+		double height = exp(rand() % 12);
+		for (size_t j=i; j<n && j<i+500; j++) {
+			double x = (j - i - 250.0) / 4.0;
+			array[j] = floor(height * exp(-0.5 * x * x) + ((rand() % 3 == 0) ? rand() % 200 : 0));
+		}
+	}
+	return array;
+}
+
+
+
+/**
+ * Centroided spectra: log-normally distributed peak intensities
+ */
+std::vector<double> centroidedArray(
+		size_t n
+) {
+	std::vector<double> array(n);
+	for (size_t i=0; i<n; i++) {
+		array[i] = floor(exp(4 + (rand() % 1000) / 100.0));
+	}
+	return array;
+}
+
+
+
+int main(int argc, const char* argv[]) {
+	std::vector<std::vector<double> > arrays;
+	for (int a=1; a<argc; a++) {
+		std::ifstream file(argv[a], std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		std::vector<double> array(bytes.size() / 8);
+		if (!array.empty()) {
+			memcpy(&array[0], bytes.data(), 8 * array.size());
+		}
+		arrays.push_back(array);
+	}
+
+	if (arrays.empty()) {
+		srand(123459);
+		printf("synthetic profile spectra\n");
+		for (size_t s=0; s<200; s++) {
+			arrays.push_back(profileArray(20000));
+		}
+		for (size_t c=0; c<sizeof(CODECS)/sizeof(CODECS[0]); c++) {
+			benchmark(CODECS[c], arrays);
+		}
+
+		arrays.clear();
+		printf("\nsynthetic centroided spectra\n");
+		for (size_t s=0; s<2000; s++) {
+			arrays.push_back(centroidedArray(500));
+		}
+	}
+
+	for (size_t c=0; c<sizeof(CODECS)/sizeof(CODECS[0]); c++) {
+		benchmark(CODECS[c], arrays);
+	}
+	return 0;
+}
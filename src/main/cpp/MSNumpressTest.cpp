@@ -29,7 +29,15 @@
 #include <iostream>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <stdio.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#if __cplusplus >= 202002L
+#include <iterator>
+#include <ranges>
+#endif
 
 using std::cout;
 using std::endl;
@@ -440,6 +448,41 @@ void encodeDecodeSafeStraight() {
 
 
 
+void encodeSafeBytes() {
+	double mzs[3];
+	
+	mzs[0] = 1.0;
+	mzs[1] = 2.0;
+	mzs[2] = 4.0;
+	
+	unsigned char encoded[24];
+	size_t encodedBytes = ms::numpress::MSNumpress::encodeSafe(&mzs[0], 3, &encoded[0]);
+	
+	// big-endian 1.0, 2.0 and the residual 4.0 - (2.0 + (2.0 - 1.0)) = 1.0
+	assert(24 == encodedBytes);
+	assert(0x3f == encoded[0]);
+	assert(0xf0 == encoded[1]);
+	assert(0x40 == encoded[8]);
+	assert(0x00 == encoded[9]);
+	assert(0x3f == encoded[16]);
+	assert(0xf0 == encoded[17]);
+	for (size_t i=2; i<8; i++) {
+		assert(0x00 == encoded[i]);
+		assert(0x00 == encoded[8+i]);
+		assert(0x00 == encoded[16+i]);
+	}
+	
+	double decoded[3];
+	assert(0 == ms::numpress::MSNumpress::decodeSafe(&encoded[0], 0, &decoded[0]));
+	assert(3 == ms::numpress::MSNumpress::decodeSafe(&encoded[0], encodedBytes, &decoded[0]));
+	assert(1.0 == decoded[0]);
+	assert(2.0 == decoded[1]);
+	assert(4.0 == decoded[2]);
+	
+	cout << "+ pass    encodeSafeBytes " << endl << endl;
+}
+
+
 void encodeDecodeSafe() {
 	srand(123459);
 	
@@ -510,6 +553,93 @@ void encodeDecodeLinear() {
 
 
 
+void decodeLinearExact() {
+	srand(123662);
+	
+	size_t n = 2800;
+	double mzs[2800];
+	double decoded[2800];
+	unsigned char encoded[14000];
+	
+	mzs[0] = 100 + (rand() % 1000) / 1000.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 1000) / 1000.0;
+	
+	// every value must be exactly its fixed point int divided by the fixed point
+	double fixedPoint = ms::numpress::MSNumpress::optimalLinearFixedPoint(&mzs[0], n);
+	size_t encodedBytes = ms::numpress::MSNumpress::encodeLinear(&mzs[0], n, &encoded[0], fixedPoint);
+	size_t numDecoded = ms::numpress::MSNumpress::decodeLinear(&encoded[0], encodedBytes, &decoded[0]);
+	
+	assert(n == numDecoded);
+	for (size_t i=0; i<n; i++) 
+		assert(decoded[i] == static_cast<long long>(mzs[i] * fixedPoint + 0.5) / fixedPoint);
+	
+	// a constant second difference of 2^30 takes the values past 2^51
+	for (size_t i=0; i<n; i++) 
+		mzs[i] = static_cast<double>(i * i) * 536870912.0;
+	
+	encodedBytes = ms::numpress::MSNumpress::encodeLinear(&mzs[0], n, &encoded[0], 1.0);
+	numDecoded = ms::numpress::MSNumpress::decodeLinear(&encoded[0], encodedBytes, &decoded[0]);
+	
+	assert(n == numDecoded);
+	for (size_t i=0; i<n; i++) 
+		assert(decoded[i] == mzs[i]);
+	
+	cout << "+ pass    decodeLinearExact " << endl << endl;
+}
+
+
+void encodeLinearAuto() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 10000;
+	std::vector<double> mzs(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 1000) / 10000.0;
+	
+	// a residual larger than the first values, late enough to roll back
+	std::vector<double> jump(mzs);
+	jump[0] = 0.5;
+	jump[1] = 0.7;
+	for (size_t i=7000; i<n; i++) 
+		jump[i] += 500.0;
+	
+	std::vector<double> *inputs[2] = { &mzs, &jump };
+	for (size_t k=0; k<2; k++) {
+		const std::vector<double> &data = *inputs[k];
+		std::vector<unsigned char> expected, encoded;
+		
+		double fixedPoint = optimalLinearFixedPoint(&data[0], n);
+		encodeLinear(data, expected, fixedPoint);
+		assert(encodeLinearAuto(data, encoded) == fixedPoint);
+		assert(encoded == expected);
+		
+		fixedPoint = optimalLinearFixedPointMass(&data[0], n, 0.0001);
+		assert(fixedPoint > 0);
+		encodeLinear(data, expected, fixedPoint);
+		assert(encodeLinearAutoMass(data, encoded, 0.0001) == fixedPoint);
+		assert(encoded == expected);
+	}
+	
+	std::vector<unsigned char> encoded;
+	assert(optimalLinearFixedPointMass(&jump[0], n, 1e-7) == -1);
+	assert(encodeLinearAutoMass(jump, encoded, 1e-7) == -1);
+	assert(encoded.size() == 0);
+	
+	for (size_t k=0; k<3; k++) {
+		unsigned char expected[16], few[16];
+		double fixedPoint;
+		size_t expectedBytes = encodeLinear(&mzs[0], k, expected, optimalLinearFixedPoint(&mzs[0], k));
+		assert(encodeLinearAuto(&mzs[0], k, few, &fixedPoint) == expectedBytes);
+		assert(memcmp(few, expected, expectedBytes) == 0);
+	}
+	
+	cout << "+ pass    encodeLinearAuto " << endl << endl;
+}
+
+
 void encodeDecodeLinear5() {
 	srand(123662);
 	
@@ -554,6 +684,48 @@ void encodeDecodeLinear5() {
 
 
 
+void encodePicBytes() {
+	double ics[4];
+	
+	ics[0] = 23.0;
+	ics[1] = 0.0;
+	ics[2] = 268435457.0;
+	ics[3] = 1.0;
+	
+	unsigned char encoded[20];
+	size_t encodedBytes = ms::numpress::MSNumpress::encodePic(&ics[0], 4, &encoded[0]);
+	
+	// 0x6 0x7 0x1 | 0x8 | 0x0 0x1 0x0 0x0 0x0 0x0 0x0 0x0 0x1 | 0x7 0x1
+	assert(8 == encodedBytes);
+	assert(0x67 == encoded[0]);
+	assert(0x18 == encoded[1]);
+	assert(0x01 == encoded[2]);
+	assert(0x00 == encoded[3]);
+	assert(0x00 == encoded[4]);
+	assert(0x00 == encoded[5]);
+	assert(0x17 == encoded[6]);
+	assert(0x10 == encoded[7]);
+	
+	double mzs[5];
+	
+	mzs[0] = 10.0;
+	mzs[1] = 20.0;
+	mzs[2] = 29.0;
+	mzs[3] = 22.0;
+	mzs[4] = 15.0;
+	
+	encodedBytes = ms::numpress::MSNumpress::encodeLinear(&mzs[0], 5, &encoded[0], 1.0);
+	
+	// residuals -1 => 0xf 0xf, -16 => 0xf 0x0, 0 => 0x8
+	assert(19 == encodedBytes);
+	assert(0xff == encoded[16]);
+	assert(0xf0 == encoded[17]);
+	assert(0x80 == encoded[18]);
+	
+	cout << "+ pass    encodePicBytes " << endl << endl;
+}
+
+
 void encodeDecodePic() {
 	srand(123459);
 	
@@ -578,6 +750,32 @@ void encodeDecodePic() {
 
 
 
+void encodeDecodePicAllLengths() {
+	srand(123459);
+	
+	// ints of every halfbyte length, at every array length across the point
+	// where decodePic switches from block to bytewise decoding
+	size_t n = 3000;
+	double ics[3000];
+	for (size_t i=0; i<n; i++) 
+		ics[i] = (rand() % 2 == 0) ? 0 : rand() % (1u << (rand() % 31));
+	
+	unsigned char encoded[15000];
+	double decoded[3000];
+	
+	for (size_t m=0; m<n; m += (m < 64) ? 1 : 97) {
+		size_t encodedBytes = ms::numpress::MSNumpress::encodePic(&ics[0], m, &encoded[0]);
+		size_t numDecoded = ms::numpress::MSNumpress::decodePic(&encoded[0], encodedBytes, &decoded[0]);
+		
+		assert(m == numDecoded);
+		for (size_t i=0; i<m; i++) 
+			assert(ics[i] == decoded[i]);
+	}
+	
+	cout << "+ pass    encodeDecodePicAllLengths " << endl << endl;
+}
+
+
 void encodeDecodePic5() {
 	srand(123459);
 	
@@ -686,6 +884,78 @@ void encodeDecodeSlof() {
 
 
 
+void decodeSlofTable() {
+	srand(123459);
+	
+	// enough values for decodeSlof to switch to a table of the fixed point
+	size_t n = 40000;
+	std::vector<double> ics(n);
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % 1000000;
+	
+	double fixedPoint = ms::numpress::MSNumpress::optimalSlofFixedPoint(&ics[0], n);
+	
+	std::vector<unsigned char> encoded;
+	std::vector<double> decoded;
+	ms::numpress::MSNumpress::encodeSlof(ics, encoded, fixedPoint);
+	
+	for (size_t k=0; k<3; k++) {
+		ms::numpress::MSNumpress::decodeSlof(encoded, decoded);
+		
+		assert(n == decoded.size());
+		for (size_t i=0; i<n; i++) {
+			unsigned short x = static_cast<unsigned short>(encoded[8+2*i] | (encoded[9+2*i] << 8));
+			assert(decoded[i] == exp(x / fixedPoint) - 1);
+		}
+	}
+	
+	cout << "+ pass    decodeSlofTable " << endl << endl;
+}
+
+
+void encodeSlofRounding() {
+	
+	// for every code, the values around where log(x+1) * fixedPoint rounds 
+	// up to it must get the same code as with the plain libm computation
+	double fixedPoints[3];
+	fixedPoints[0] = 4743.0;
+	fixedPoints[1] = 8123.5;
+	fixedPoints[2] = 65535.0 / log(10.0);
+	
+	for (size_t k=0; k<3; k++) {
+		double fixedPoint = fixedPoints[k];
+		std::vector<double> ics;
+		
+		for (size_t c=0; c<65535; c++) {
+			double x = exp((c + 0.5) / fixedPoint) - 1;
+			if (log(x + 1) * fixedPoint > 65535) break;
+			
+			double below = x, above = x;
+			ics.push_back(x);
+			for (size_t j=0; j<3; j++) {
+				below = nextafter(below, 0.0);
+				above = nextafter(above, 1e300);
+				ics.push_back(below);
+				ics.push_back(above);
+			}
+			ics.push_back(x * 0.999);
+		}
+		
+		std::vector<unsigned char> encoded;
+		ms::numpress::MSNumpress::encodeSlof(ics, encoded, fixedPoint);
+		
+		assert(encoded.size() == 8 + 2 * ics.size());
+		for (size_t i=0; i<ics.size(); i++) {
+			unsigned short x = static_cast<unsigned short>(log(ics[i] + 1) * fixedPoint + 0.5);
+			assert(encoded[8+2*i] == (x & 0xff));
+			assert(encoded[9+2*i] == (x >> 8));
+		}
+	}
+	
+	cout << "+ pass    encodeSlofRounding " << endl << endl;
+}
+
+
 void encodeDecodeSlof5() {
 	srand(123459);
 	
@@ -733,6 +1003,1333 @@ void encodeDecodeSlof5() {
 
 
 
+void simdTiers() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// odd lengths, so that every kernel also has a scalar tail
+	size_t n = 40003;
+	std::vector<double> mzs(n), huge(n), ics(n), safe(n);
+	double mz = 100.0;
+	for (size_t i=0; i<n; i++) {
+		mz += (rand() % 1000) / 1000.0 + ((i % 997 == 0) ? 5000.0 : 0.0);
+		mzs[i] 	= mz;
+		huge[i] = 1e6 + i * 0.001 + (rand() % 100) * 1e-9;
+		ics[i] 	= rand() % 1000000;
+		safe[i] = mz * ((rand() % 3) - 1);
+	}
+	
+	SimdTier original = simdTier();
+	std::vector<unsigned char> encoded[4][5];
+	std::vector<double> decoded[4][5];
+	double slofFixedPoint[4];
+	
+	for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+		setSimdTier(static_cast<SimdTier>(t));
+		
+		encodeLinear(mzs, encoded[t][0], optimalLinearFixedPoint(&mzs[0], n));
+		// fixed point values beyond 2^51
+		encodeLinear(huge, encoded[t][4], 1e10);
+		encodePic(ics, encoded[t][1]);
+		slofFixedPoint[t] = optimalSlofFixedPoint(&ics[0], n);
+		encodeSlof(ics, encoded[t][2], slofFixedPoint[t]);
+		encoded[t][3].resize(8 * n);
+		encodeSafe(&safe[0], n, &encoded[t][3][0]);
+		
+		decodeLinear(encoded[t][0], decoded[t][0]);
+		decodeLinear(encoded[t][4], decoded[t][4]);
+		decodePic(encoded[t][1], decoded[t][1]);
+		decodeSlof(encoded[t][2], decoded[t][2]);
+		decoded[t][3].resize(n);
+		decodeSafe(&encoded[t][3][0], 8 * n, &decoded[t][3][0]);
+		
+		assert(slofFixedPoint[t] == slofFixedPoint[0]);
+		for (size_t c=0; c<5; c++) {
+			assert(encoded[t][c] == encoded[0][c]);
+			assert(decoded[t][c].size() == decoded[0][c].size());
+			assert(memcmp(&decoded[t][c][0], &decoded[0][c][0], decoded[0][c].size() * sizeof(double)) == 0);
+		}
+	}
+	
+	setSimdTier(original);
+	
+	cout << "+ pass    simdTiers " << endl << endl;
+}
+
+
+
+void encodedSizeDecodedCount() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 3000;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 100000) / 1000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % ((i % 7 == 0) ? 2000000000 : 100);
+	
+	std::vector<unsigned char> encoded(n * 5 + 8);
+	double fixedPoint = optimalLinearFixedPoint(&mzs[0], n);
+	
+	// every length, so that all paddings and tails are covered
+	for (size_t k=0; k<=n; k+=(k < 40) ? 1 : 97) {
+		size_t linearBytes = encodeLinear(&mzs[0], k, &encoded[0], fixedPoint);
+		assert(encodedSizeLinear(&mzs[0], k, fixedPoint) == linearBytes);
+		assert(decodedCountLinear(&encoded[0], linearBytes) == k);
+		
+		size_t picBytes = encodePic(&ics[0], k, &encoded[0]);
+		assert(encodedSizePic(&ics[0], k) == picBytes);
+		assert(decodedCountPic(&encoded[0], picBytes) == k);
+	}
+	
+	// corrupt data is rejected as by the decoders (see testErroneousDecodePic)
+	unsigned char corrupt[32] = { 100, 102, 140, 92, 33, 80, 145 };
+	try {
+		decodedCountPic(corrupt, 32);
+		assert(0 == 1);
+	} catch (const char *err) {
+	}
+	try {
+		decodedCountLinear(corrupt, 7);
+		assert(0 == 1);
+	} catch (const char *err) {
+	}
+	
+	cout << "+ pass    encodedSizeDecodedCount " << endl << endl;
+}
+
+
+
+void codecReuse() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	std::vector<std::vector<double> > spectra(20);
+	for (size_t k=0; k<spectra.size(); k++) {
+		spectra[k].resize(1 + rand() % 300);
+		double mz = 100.0;
+		for (size_t i=0; i<spectra[k].size(); i++) {
+			mz += (rand() % 10000) / 100.0;
+			spectra[k][i] = mz;
+		}
+	}
+	
+	Codec codec;
+	const double *decodedBuffer = NULL;
+	for (size_t round=0; round<2; round++) {
+		codec.clear();
+		codec.setAppend(true);
+		
+		std::vector<unsigned char> packed;
+		for (size_t k=0; k<spectra.size(); k++) {
+			std::vector<unsigned char> expected;
+			encodePic(spectra[k], expected);
+			Span<const unsigned char> encoded = codec.encodePic(&spectra[k][0], spectra[k].size());
+			assert(std::vector<unsigned char>(encoded.begin(), encoded.end()) == expected);
+			packed.insert(packed.end(), expected.begin(), expected.end());
+		}
+		assert(std::vector<unsigned char>(codec.bytes().begin(), codec.bytes().end()) == packed);
+		
+		// without append, every call replaces the previous result
+		codec.setAppend(false);
+		for (size_t k=0; k<spectra.size(); k++) {
+			double fixedPoint = optimalLinearFixedPoint(&spectra[k][0], spectra[k].size());
+			std::vector<unsigned char> encoded;
+			std::vector<double> expected;
+			encodeLinear(spectra[k], encoded, fixedPoint);
+			decodeLinear(encoded, expected);
+			
+			Span<const double> decoded = codec.decodeLinear(&encoded[0], encoded.size());
+			assert(decoded.size == expected.size());
+			for (size_t i=0; i<decoded.size; i++) 
+				assert(decoded[i] == expected[i]);
+			assert(codec.doubles().size == expected.size());
+		}
+		
+		// the buffers are kept between rounds
+		if (round == 1) assert(codec.doubles().data == decodedBuffer);
+		decodedBuffer = codec.doubles().data;
+	}
+	
+	cout << "+ pass    codecReuse " << endl << endl;
+}
+
+
+
+void encodeDecodeFramed() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 100003;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 1000) / 10000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % 100000;
+	
+	double fixedPoint = optimalLinearFixedPoint(&mzs[0], n);
+	size_t blockSize = 4096;
+	
+	std::vector<unsigned char> framed, block;
+	std::vector<double> decoded, expected;
+	
+	encodeLinearFramed(mzs, framed, fixedPoint, blockSize);
+	assert(isFramed(&framed[0], framed.size()));
+	assert(decodedCountFramed(&framed[0], framed.size()) == n);
+	for (size_t threads=1; threads<=4; threads+=3) {
+		decodeLinearFramed(framed, decoded, threads);
+		assert(decoded.size() == n);
+		for (size_t b=0; b<n; b+=blockSize) {
+			std::vector<double> part(mzs.begin() + b, mzs.begin() + std::min(n, b + blockSize));
+			encodeLinear(part, block, fixedPoint);
+			decodeLinear(block, expected);
+			for (size_t i=0; i<expected.size(); i++) 
+				assert(decoded[b+i] == expected[i]);
+		}
+	}
+	
+	// the tag reads as a NaN fixed point
+	try {
+		decodeLinear(framed, decoded);
+		assert(0 == 1);
+	} catch (const char *err) {
+	}
+	
+	encodePicFramed(ics, framed, blockSize);
+	decodePicFramed(framed, decoded, 0);
+	assert(decoded == ics);
+	
+	// and cannot start a Pic array
+	try {
+		decodePic(framed, decoded);
+		assert(0 == 1);
+	} catch (const char *err) {
+	}
+	
+	encodePic(ics, block);
+	assert(!isFramed(&block[0], block.size()));
+	
+	// a forged value count must be refused before it is allocated
+	encodePicFramed(ics, framed, 1 << 28);
+	std::vector<unsigned char> forged(framed);
+	forged[16 + 3] = 0x10;
+	forged[16 + 2] = forged[16 + 1] = forged[16] = 0;
+	try {
+		decodePicFramed(forged, decoded, 1);
+		assert(0 == 1);
+	} catch (const char *err) {
+	}
+	decodePicFramed(framed, decoded, 1);
+	assert(decoded == ics);
+	
+	// a block offset pointing into the previous block
+	encodePicFramed(ics, framed, blockSize);
+	framed[24 + 8] -= 1;
+	try {
+		decodePicFramed(framed, decoded, 2);
+		assert(0 == 1);
+	} catch (const char *err) {
+	}
+	
+	cout << "+ pass    encodeDecodeFramed " << endl << endl;
+}
+
+
+
+void encodeDecodeBatch() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// spectra of very different sizes, some empty
+	size_t count = 500;
+	std::vector<double> data;
+	std::vector<size_t> offsets(1, 0);
+	for (size_t k=0; k<count; k++) {
+		size_t n = (k % 50 == 0) ? 20000 : rand() % 200;
+		double mz = 100.0 + rand() % 100;
+		for (size_t i=0; i<n; i++) {
+			mz += (rand() % 10000) / 1000.0;
+			data.push_back(mz);
+		}
+		offsets.push_back(data.size());
+	}
+	
+	BatchCodec codecs[4] = { BATCH_LINEAR, BATCH_PIC, BATCH_SLOF, BATCH_SAFE };
+	for (size_t c=0; c<4; c++) {
+		std::vector<unsigned char> single, encoded;
+		std::vector<size_t> encodedOffsets, decodedOffsets;
+		std::vector<double> decoded, expected;
+		encodeBatch(codecs[c], data, offsets, single, encodedOffsets, 1);
+		
+		for (size_t threads=0; threads<=3; threads++) {
+			encodeBatch(codecs[c], data, offsets, encoded, encodedOffsets, threads);
+			assert(encoded == single);
+		}
+		decodeBatch(codecs[c], encoded, encodedOffsets, decoded, decodedOffsets, 3);
+		assert(decodedOffsets == offsets);
+		
+		// each array as it would be on its own
+		for (size_t k=0; k<count; k++) {
+			std::vector<double> array(data.begin() + offsets[k], data.begin() + offsets[k+1]);
+			std::vector<unsigned char> bytes(array.size() * 8 + 8);
+			size_t n = 0;
+			switch (codecs[c]) {
+				case BATCH_LINEAR: 	
+					n = encodeLinear(array.data(), array.size(), &bytes[0], optimalLinearFixedPoint(array.data(), array.size())); 
+					break;
+				case BATCH_PIC: 	
+					n = encodePic(array.data(), array.size(), &bytes[0]); 
+					break;
+				case BATCH_SLOF: 	
+					n = encodeSlof(array.data(), array.size(), &bytes[0], optimalSlofFixedPoint(array.data(), array.size())); 
+					break;
+				case BATCH_SAFE: 	
+					n = encodeSafe(array.data(), array.size(), &bytes[0]); 
+					break;
+			}
+			assert(encodedOffsets[k+1] - encodedOffsets[k] == n);
+			assert(memcmp(&bytes[0], &encoded[encodedOffsets[k]], n) == 0);
+			if (codecs[c] == BATCH_SAFE) 
+				for (size_t i=0; i<array.size(); i++) 
+					assert(decoded[offsets[k]+i] == array[i]);
+		}
+	}
+	
+	cout << "+ pass    encodeDecodeBatch " << endl << endl;
+}
+
+
+
+void appendBytes(
+		void *context,
+		const unsigned char *bytes,
+		size_t size
+) {
+	std::vector<unsigned char> *out = static_cast<std::vector<unsigned char>*>(context);
+	assert(size > 0);
+	out->insert(out->end(), bytes, bytes + size);
+}
+
+
+void streamingEncoders() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 30000;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % ((i % 3 == 0) ? 2000000000 : 100);
+	double fixedPoint = optimalLinearFixedPoint(&mzs[0], n);
+	
+	// few values, and many values in chunks of all sizes
+	size_t lengths[6] = { 0, 1, 2, 3, 17, n };
+	for (size_t k=0; k<6; k++) {
+		size_t length = lengths[k];
+		std::vector<unsigned char> expected(length * 5 + 8), streamed;
+		
+		expected.resize(encodeLinear(&mzs[0], length, &expected[0], fixedPoint));
+		LinearEncoder linear(fixedPoint, appendBytes, &streamed);
+		for (size_t i=0; i<length; ) {
+			size_t chunk = std::min(length - i, static_cast<size_t>(rand() % 50));
+			linear.push(&mzs[i], chunk);
+			if (chunk % 7 == 0) linear.flush();
+			i += chunk;
+		}
+		assert(linear.finish() == expected.size());
+		assert(streamed == expected);
+		
+		streamed.clear();
+		expected.resize(length * 5 + 8);
+		expected.resize(encodePic(&ics[0], length, &expected[0]));
+		PicEncoder pic(appendBytes, &streamed);
+		for (size_t i=0; i<length; ) {
+			size_t chunk = std::min(length - i, static_cast<size_t>(rand() % 50));
+			pic.push(&ics[i], chunk);
+			i += chunk;
+		}
+		assert(pic.finish() == expected.size());
+		assert(streamed == expected);
+	}
+	
+	cout << "+ pass    streamingEncoders " << endl << endl;
+}
+
+
+
+void streamingDecoders() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 30000;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % ((i % 3 == 0) ? 2000000000 : 100);
+	
+	// few values, and many values, in chunks of a few bytes up to whole tiles
+	size_t lengths[6] = { 0, 1, 2, 3, 17, n };
+	size_t maxChunks[3] = { 3, 40, 20000 };
+	for (size_t k=0; k<6; k++) {
+		size_t length = lengths[k];
+		std::vector<unsigned char> encoded[3];
+		std::vector<double> expected[3];
+		encoded[0].resize(length * 5 + 8);
+		encoded[0].resize(encodeLinear(mzs.data(), length, &encoded[0][0], 1000.0));
+		encoded[1].resize(length * 5 + 8);
+		encoded[1].resize(encodePic(ics.data(), length, &encoded[1][0]));
+		encoded[2].resize(length * 2 + 8);
+		encoded[2].resize(encodeSlof(ics.data(), length, &encoded[2][0], 2000.0));
+		// (the vector overloads do not take empty arrays)
+		if (length > 0) {
+			decodeLinear(encoded[0], expected[0]);
+			decodePic(encoded[1], expected[1]);
+			decodeSlof(encoded[2], expected[2]);
+		}
+		
+		for (size_t m=0; m<3; m++) {
+			LinearDecoder linear;
+			PicDecoder pic;
+			SlofDecoder slof;
+			std::vector<double> decoded[3];
+			for (size_t c=0; c<3; c++) {
+				for (size_t i=0; i<encoded[c].size(); ) {
+					size_t chunk = std::min(encoded[c].size() - i, 1 + rand() % maxChunks[m]);
+					if 		(c == 0) linear.push(&encoded[c][i], chunk, decoded[c]);
+					else if (c == 1) pic.push(&encoded[c][i], chunk, decoded[c]);
+					else 			 slof.push(&encoded[c][i], chunk, decoded[c]);
+					i += chunk;
+				}
+			}
+			linear.finish(decoded[0]);
+			pic.finish(decoded[1]);
+			slof.finish(decoded[2]);
+			
+			for (size_t c=0; c<3; c++) {
+				assert(decoded[c] == expected[c]);
+			}
+			assert(linear.count() == length && pic.count() == length && slof.count() == length);
+		}
+	}
+	
+	// incomplete arrays throw on finish, as in the classic decoders
+	std::vector<unsigned char> encoded(30);
+	encodeLinear(mzs.data(), 3, &encoded[0], 1000.0);
+	std::vector<double> decoded;
+	LinearDecoder linear;
+	linear.push(&encoded[0], 14, decoded);
+	try {
+		linear.finish(decoded);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	SlofDecoder slof;
+	slof.push(&encoded[0], 5, decoded);
+	try {
+		slof.finish(decoded);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	cout << "+ pass    streamingDecoders " << endl << endl;
+}
+
+
+
+#if __cplusplus >= 202002L
+static_assert(std::forward_iterator<ms::numpress::MSNumpress::DecodeIterator>, 
+	"DecodeIterator must be a forward iterator");
+static_assert(std::ranges::forward_range<ms::numpress::MSNumpress::DecodeRange>, 
+	"DecodeRange must be a forward range");
+#endif
+
+void decodeLazy() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 40000;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % 1000000;
+	
+	// empty arrays
+	unsigned char empty[8];
+	encodeLinear(&mzs[0], 0, empty, 1000.0);
+	assert(decodeLinearLazy(empty, 8).begin() == decodeLinearLazy(empty, 8).end());
+	assert(decodePicLazy(empty, 0).begin() == decodePicLazy(empty, 0).end());
+	
+	size_t lengths[4] = { 1, 2, 3, n };
+	for (size_t k=0; k<4; k++) {
+		std::vector<double> part(mzs.begin(), mzs.begin() + lengths[k]);
+		std::vector<unsigned char> encoded;
+		std::vector<double> expected;
+		
+		encodeLinear(part, encoded, optimalLinearFixedPoint(part.data(), part.size()));
+		decodeLinear(encoded, expected);
+		DecodeRange linear = decodeLinearLazy(&encoded[0], encoded.size());
+		assert(std::vector<double>(linear.begin(), linear.end()) == expected);
+		
+		std::vector<double> counts(ics.begin(), ics.begin() + lengths[k]);
+		encodePic(counts, encoded);
+		decodePic(encoded, expected);
+		DecodeRange pic = decodePicLazy(encoded.data(), encoded.size());
+		assert(std::vector<double>(pic.begin(), pic.end()) == expected);
+		
+		encodeSlof(counts, encoded, optimalSlofFixedPoint(counts.data(), counts.size()));
+		decodeSlof(encoded, expected);
+		DecodeRange slof = decodeSlofLazy(&encoded[0], encoded.size());
+		assert(std::vector<double>(slof.begin(), slof.end()) == expected);
+	}
+	
+	// a range can be iterated over twice, and copies advance independently
+	std::vector<unsigned char> encoded;
+	encodePic(ics, encoded);
+	DecodeRange range = decodePicLazy(&encoded[0], encoded.size());
+	assert(std::vector<double>(range.begin(), range.end()) == ics);
+	assert(std::vector<double>(range.begin(), range.end()) == ics);
+	DecodeIterator it = range.begin();
+	for (size_t i=0; i<1000; i++) 
+		assert(*it++ == ics[i]);
+	DecodeIterator copy = it;
+	for (size_t i=1000; i<2000; i++, ++copy) 
+		assert(*copy == ics[i]);
+	assert(*it == ics[1000]);
+	DecodeIterator previous = it++;
+	assert(*previous == ics[1000] && *it == ics[1001]);
+	for (size_t i=1001; i<n; i++, ++it) 
+		assert(*it == ics[i]);
+	assert(it == range.end() && copy != range.end());
+	
+	cout << "+ pass    decodeLazy " << endl << endl;
+}
+
+
+
+void decodeLinearRange() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 40000;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % 1000000;
+	
+	std::vector<unsigned char> encodedMzs, encodedPic, encodedSlof;
+	std::vector<double> mzsDecoded, icsDecoded, slofDecoded;
+	encodeLinear(mzs, encodedMzs, optimalLinearFixedPoint(mzs.data(), n));
+	decodeLinear(encodedMzs, mzsDecoded);
+	encodePic(ics, encodedPic);
+	decodePic(encodedPic, icsDecoded);
+	encodeSlof(ics, encodedSlof, optimalSlofFixedPoint(ics.data(), n));
+	decodeSlof(encodedSlof, slofDecoded);
+	
+	// bounds on, between, before and after the values
+	double los[6] = { 0.0, mzsDecoded[0], mzsDecoded[1000], mzsDecoded[1000] + 0.0005, mzsDecoded[n-1], 1e9 };
+	double his[6] = { 0.0, mzsDecoded[0], mzsDecoded[1000], mzsDecoded[21000] - 0.0005, mzsDecoded[n-1], 1e9 };
+	std::vector<double> result(n), slice(n);
+	for (size_t a=0; a<6; a++) {
+		for (size_t b=0; b<6; b++) {
+			IndexRange range = decodeLinearRange(&encodedMzs[0], encodedMzs.size(), los[a], his[b], &result[0]);
+			
+			size_t begin = 0;
+			while (begin < n && mzsDecoded[begin] < los[a] && mzsDecoded[begin] <= his[b]) 
+				begin++;
+			size_t end = begin;
+			while (end < n && mzsDecoded[end] <= his[b]) 
+				end++;
+			assert(range.begin == begin);
+			assert(range.end == end);
+			for (size_t i=begin; i<end; i++) 
+				assert(result[i - begin] == mzsDecoded[i]);
+			
+			assert(decodePicSlice(&encodedPic[0], encodedPic.size(), begin, end, &slice[0]) == end - begin);
+			for (size_t i=begin; i<end; i++) 
+				assert(slice[i - begin] == icsDecoded[i]);
+			
+			assert(decodeSlofSlice(&encodedSlof[0], encodedSlof.size(), begin, end, &slice[0]) == end - begin);
+			for (size_t i=begin; i<end; i++) 
+				assert(slice[i - begin] == slofDecoded[i]);
+		}
+	}
+	
+	// short arrays and slices past the end
+	for (size_t k=0; k<=3; k++) {
+		std::vector<unsigned char> encoded(8 + 5 * k + 8);
+		encoded.resize(encodeLinear(mzs.data(), k, &encoded[0], 1000.0));
+		IndexRange range = decodeLinearRange(&encoded[0], encoded.size(), 0.0, 1e9, &result[0]);
+		assert(range.begin == 0 && range.end == k);
+		for (size_t i=0; i<k; i++) 
+			assert(fabs(result[i] - mzs[i]) < 0.001);
+	}
+	assert(decodePicSlice(&encodedPic[0], encodedPic.size(), n - 10, n + 10, &slice[0]) == 10);
+	assert(decodePicSlice(&encodedPic[0], encodedPic.size(), n + 10, n + 20, &slice[0]) == 0);
+	assert(decodeSlofSlice(&encodedSlof[0], encodedSlof.size(), n - 10, n + 10, &slice[0]) == 10);
+	assert(slice[9] == slofDecoded[n-1]);
+	
+	cout << "+ pass    decodeLinearRange " << endl << endl;
+}
+
+
+
+void encodeDecodeIndexed() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 40000;
+	std::vector<double> mzs(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+	double fixedPoint = optimalLinearFixedPoint(mzs.data(), n);
+	
+	size_t lengths[6] = { 0, 1, 2, 3, 256, n };
+	size_t intervals[3] = { 2, 7, 256 };
+	for (size_t k=0; k<6; k++) {
+		for (size_t l=0; l<3; l++) {
+			std::vector<double> part(mzs.begin(), mzs.begin() + lengths[k]);
+			std::vector<unsigned char> classic(8 + 5 * part.size()), indexed;
+			std::vector<double> expected(part.size() + 1), decoded;
+			
+			classic.resize(encodeLinear(part.data(), part.size(), &classic[0], fixedPoint));
+			expected.resize(decodeLinear(&classic[0], classic.size(), &expected[0]));
+			
+			encodeLinearIndexed(part, indexed, fixedPoint, intervals[l]);
+			assert(indexed.size() <= maxIndexedSize(part.size(), intervals[l]));
+			assert(isFramed(&indexed[0], indexed.size()));
+			assert(decodedCountIndexed(&indexed[0], indexed.size()) == part.size());
+			decodeLinearIndexed(indexed, decoded);
+			assert(decoded == expected);
+			
+			// slices starting on and between checkpoints
+			std::vector<double> slice(part.size() + 1);
+			for (size_t begin=0; begin<part.size(); begin+=1 + begin/3) {
+				size_t end = std::min(part.size(), begin + 1 + begin % 300);
+				assert(decodeLinearIndexedSlice(&indexed[0], indexed.size(), begin, part.size() + 5, &slice[0]) == part.size() - begin);
+				assert(decodeLinearIndexedSlice(&indexed[0], indexed.size(), begin, end, &slice[0]) == end - begin);
+				for (size_t i=begin; i<end; i++) 
+					assert(slice[i - begin] == expected[i]);
+			}
+			
+			// lower bounds on, between, before and after the values
+			for (size_t i=0; i<part.size(); i+=1 + i/5) {
+				assert(lowerBoundLinearIndexed(&indexed[0], indexed.size(), expected[i]) == 
+					size_t(std::lower_bound(expected.begin(), expected.end(), expected[i]) - expected.begin()));
+				assert(lowerBoundLinearIndexed(&indexed[0], indexed.size(), expected[i] + 0.0001) == 
+					size_t(std::lower_bound(expected.begin(), expected.end(), expected[i] + 0.0001) - expected.begin()));
+			}
+			assert(lowerBoundLinearIndexed(&indexed[0], indexed.size(), 0.0) == 0);
+			assert(lowerBoundLinearIndexed(&indexed[0], indexed.size(), 1e9) == part.size());
+		}
+	}
+	
+	// rejected by the classic and framed decoders
+	std::vector<unsigned char> indexed;
+	std::vector<double> decoded(n);
+	encodeLinearIndexed(mzs, indexed, fixedPoint, 64);
+	try {
+		decodeLinear(&indexed[0], indexed.size(), &decoded[0]);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	try {
+		decodedCountFramed(&indexed[0], indexed.size());
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	// truncated data throws
+	try {
+		decodeLinearIndexedSlice(&indexed[0], indexed.size() / 2, n - 10, n, &decoded[0]);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	try {
+		decodeLinearIndexed(&indexed[0], indexed.size() - 100, &decoded[0]);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	cout << "+ pass    encodeDecodeIndexed " << endl << endl;
+}
+
+
+
+void seekIndex() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 100000;
+	std::vector<double> mzs(n), ics(n);
+	mzs[0] = 300.0;
+	for (size_t i=1; i<n; i++) 
+		mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+	for (size_t i=0; i<n; i++) 
+		ics[i] = rand() % 1000000;
+	double fixedPoint = optimalLinearFixedPoint(mzs.data(), n);
+	
+	size_t lengths[5] = { 0, 1, 2, 3, n };
+	size_t intervals[3] = { 2, 7, 256 };
+	for (size_t k=0; k<5; k++) {
+		for (size_t l=0; l<3; l++) {
+			size_t count = lengths[k];
+			std::vector<unsigned char> linear(8 + 5 * count), pic(5 * count), linearIndex, picIndex;
+			std::vector<double> expectedMzs(count + 1), expectedIcs(count + 1);
+			linear.resize(encodeLinear(mzs.data(), count, &linear[0], fixedPoint));
+			expectedMzs.resize(decodeLinear(&linear[0], linear.size(), &expectedMzs[0]));
+			pic.resize(encodePic(ics.data(), count, pic.data()));
+			expectedIcs.resize(decodePic(pic.data(), pic.size(), &expectedIcs[0]));
+			
+			seekIndexLinear(linear, intervals[l], linearIndex);
+			seekIndexPic(pic, intervals[l], picIndex);
+			assert(linearIndex.size() <= maxSeekIndexSize(linear.size(), intervals[l]));
+			assert(picIndex.size() <= maxSeekIndexSize(pic.size(), intervals[l]));
+			assert(decodedCountSeek(&linearIndex[0], linearIndex.size()) == count);
+			assert(decodedCountSeek(&picIndex[0], picIndex.size()) == count);
+			
+			// slices starting on and between checkpoints
+			std::vector<double> slice(count + 1);
+			for (size_t begin=0; begin<count; begin+=1 + begin/3) {
+				size_t end = std::min(count, begin + 1 + begin % 300);
+				assert(decodeLinearSlice(&linear[0], linear.size(), &linearIndex[0], linearIndex.size(), begin, end, &slice[0]) == end - begin);
+				for (size_t i=begin; i<end; i++) 
+					assert(slice[i - begin] == expectedMzs[i]);
+				assert(decodePicSlice(pic.data(), pic.size(), &picIndex[0], picIndex.size(), begin, end, &slice[0]) == end - begin);
+				for (size_t i=begin; i<end; i++) 
+					assert(slice[i - begin] == expectedIcs[i]);
+			}
+			for (size_t i=0; i<count; i+=1 + i/5) {
+				assert(lowerBoundLinear(&linear[0], linear.size(), &linearIndex[0], linearIndex.size(), expectedMzs[i] - 0.0001) == 
+					size_t(std::lower_bound(expectedMzs.begin(), expectedMzs.end(), expectedMzs[i] - 0.0001) - expectedMzs.begin()));
+			}
+			
+			// parallel decodes
+			std::vector<double> decoded(count);
+			for (size_t threads=1; threads<=4; threads*=2) {
+				assert(decodeLinearParallel(&linear[0], linear.size(), &linearIndex[0], linearIndex.size(), decoded.data(), threads) == count);
+				assert(decoded == expectedMzs);
+				assert(decodePicParallel(pic.data(), pic.size(), &picIndex[0], picIndex.size(), decoded.data(), threads) == count);
+				assert(decoded == expectedIcs);
+			}
+		}
+	}
+	
+	// an index only fits its own array
+	std::vector<unsigned char> linear, index;
+	std::vector<double> decoded(n);
+	encodeLinear(mzs, linear, fixedPoint);
+	seekIndexLinear(linear, 256, index);
+	try {
+		decodeLinearSlice(&linear[0], linear.size() - 1, &index[0], index.size(), 0, 10, &decoded[0]);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	try {
+		decodePicSlice(&linear[0], linear.size(), &index[0], index.size(), 0, 10, &decoded[0]);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	cout << "+ pass    seekIndex " << endl << endl;
+}
+
+
+
+void decodePicParallel() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// large enough to be cut into several chunks, with ints of all lengths
+	size_t n = 300000;
+	std::vector<double> ics(n);
+	for (size_t i=0; i<n; i++) 
+		ics[i] = (rand() % 4 == 0) ? 0 : rand() % (1 << (rand() % 31));
+	
+	size_t lengths[5] = { 0, 1, 2, 1000, n };
+	for (size_t k=0; k<5; k++) {
+		std::vector<unsigned char> encoded(5 * lengths[k]);
+		std::vector<double> expected(2 * encoded.size()), decoded;
+		encoded.resize(encodePic(ics.data(), lengths[k], encoded.data()));
+		expected.resize(decodePic(encoded.data(), encoded.size(), expected.data()));
+		
+		for (size_t threads=1; threads<=16; threads*=2) {
+			decodePicParallel(encoded, decoded, threads);
+			assert(decoded == expected);
+		}
+		
+		// starting at every offset into the data
+		if (k == 4) {
+			for (size_t offset=1; offset<16; offset++) {
+				std::vector<unsigned char> part(encoded.begin() + offset, encoded.end());
+				try {
+					decodePic(part, expected);
+				} catch (const char *e) {
+					continue;
+				}
+				decodePicParallel(part, decoded, 8);
+				assert(decoded == expected);
+			}
+		}
+	}
+	
+	// corrupt data throws as in decodePic
+	std::vector<unsigned char> encoded;
+	std::vector<double> decoded;
+	encodePic(ics, encoded);
+	encoded.back() = 0x8f;
+	try {
+		decodePicParallel(encoded, decoded, 8);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	// and so does framed data
+	encodePicFramed(ics, encoded, 4096);
+	try {
+		decodePicParallel(encoded, decoded, 8);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	cout << "+ pass    decodePicParallel " << endl << endl;
+}
+
+
+
+/**
+ * Plain base64 with padding, to check the fused functions against
+ */
+std::string base64(const std::vector<unsigned char> &bytes) {
+	const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string text;
+	for (size_t i=0; i<bytes.size(); i+=3) {
+		unsigned int x = bytes[i] << 16;
+		if (i + 1 < bytes.size()) x |= bytes[i+1] << 8;
+		if (i + 2 < bytes.size()) x |= bytes[i+2];
+		text += chars[x >> 18];
+		text += chars[(x >> 12) & 0x3f];
+		text += (i + 1 < bytes.size()) ? chars[(x >> 6) & 0x3f] : '=';
+		text += (i + 2 < bytes.size()) ? chars[x & 0x3f] : '=';
+	}
+	return text;
+}
+
+
+
+void base64Fused() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	SimdTier original = simdTier();
+	size_t sizes[] = { 1, 2, 3, 5, 100, 1000, 3001, 20000 };
+	for (size_t k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++) {
+		size_t n = sizes[k];
+		std::vector<double> mzs(n);
+		std::vector<double> ics(n);
+		double mz = 100.0;
+		for (size_t i=0; i<n; i++) {
+			mz += (rand() % 1000) / 1000.0;
+			mzs[i] = mz;
+			ics[i] = (rand() % 4 == 0) ? rand() % 100000000 : rand() % 100;
+		}
+		
+		std::vector<unsigned char> bytes[3];
+		std::vector<double> expected[3];
+		encodeLinear(mzs, bytes[0], 100000.0);
+		encodePic(ics, bytes[1]);
+		encodeSlof(ics, bytes[2], 3000.0);
+		decodeLinear(bytes[0], expected[0]);
+		decodePic(bytes[1], expected[1]);
+		decodeSlof(bytes[2], expected[2]);
+		
+		for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+			setSimdTier(static_cast<SimdTier>(t));
+			
+			std::string text[3];
+			encodeLinearBase64(mzs, text[0], 100000.0);
+			encodePicBase64(ics, text[1]);
+			encodeSlofBase64(ics, text[2], 3000.0);
+			for (size_t c=0; c<3; c++) {
+				assert(text[c] == base64(bytes[c]));
+			}
+			
+			for (size_t c=0; c<3; c++) {
+				// with and without padding
+				std::string bare = text[c].substr(0, text[c].find('='));
+				for (int padded=0; padded<2; padded++) {
+					const std::string &t = padded ? text[c] : bare;
+					std::vector<double> decoded;
+					if 		(c == 0) decodeLinearBase64(t.data(), t.size(), decoded);
+					else if (c == 1) decodePicBase64(t.data(), t.size(), decoded);
+					else 			 decodeSlofBase64(t.data(), t.size(), decoded);
+					assert(decoded == expected[c]);
+				}
+			}
+			
+			// the pointer API
+			std::vector<double> decoded(text[1].size() * 3 / 2 + 1);
+			assert(decodePicBase64(text[1].data(), text[1].size(), decoded.data()) == n);
+			decoded.resize(n);
+			assert(decoded == expected[1]);
+		}
+	}
+	setSimdTier(original);
+	
+	// empty arrays
+	std::vector<double> empty;
+	std::string emptyText[3];
+	encodeLinearBase64(empty, emptyText[0], 100000.0);
+	encodePicBase64(empty, emptyText[1]);
+	encodeSlofBase64(empty, emptyText[2], 3000.0);
+	assert(emptyText[1].empty());
+	decodeLinearBase64(emptyText[0].data(), emptyText[0].size(), empty);
+	assert(empty.empty());
+	decodePicBase64(emptyText[1].data(), emptyText[1].size(), empty);
+	assert(empty.empty());
+	decodeSlofBase64(emptyText[2].data(), emptyText[2].size(), empty);
+	assert(empty.empty());
+	
+	// characters outside the alphabet throw, wherever they are
+	std::vector<double> ics(5000);
+	for (size_t i=0; i<ics.size(); i++) {
+		ics[i] = rand() % 100000;
+	}
+	std::string text;
+	encodePicBase64(ics, text);
+	size_t positions[] = { 0, 17, 100, 4095, 4096, text.size() - 3 };
+	for (size_t k=0; k<sizeof(positions)/sizeof(positions[0]); k++) {
+		std::string bad = text;
+		bad[positions[k]] = (k % 2) ? '\n' : '-';
+		std::vector<double> decoded;
+		try {
+			decodePicBase64(bad.data(), bad.size(), decoded);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+	
+	// as do impossible lengths
+	std::vector<double> decoded;
+	try {
+		decodePicBase64(text.data(), 4 * 10 + 1, decoded);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	cout << "+ pass    base64Fused " << endl << endl;
+}
+
+
+
+void encodeDecodePicSV() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	size_t n = 50000;
+	std::vector<double> ics(n);
+	for (size_t i=0; i<n; i++) {
+		int digits = rand() % 11;
+		ics[i] = (digits == 10) ? 2147483646.0 - rand() % 10 : rand() % (1 << (3 * digits));
+	}
+	
+	SimdTier original = simdTier();
+	size_t lengths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 33, n };
+	for (size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++) {
+		size_t length = lengths[k];
+		std::vector<double> part(ics.begin(), ics.begin() + length);
+		
+		// the same ints as Pic
+		std::vector<unsigned char> pic(length * 5 + 8);
+		pic.resize(encodePic(part.data(), length, &pic[0]));
+		std::vector<double> expected(length);
+		expected.resize(decodePic(pic.data(), pic.size(), expected.data()));
+		
+		std::vector<unsigned char> encoded;
+		encodePicSV(part, encoded);
+		assert(encoded.size() <= maxPicSVSize(length));
+		assert(decodedCountPicSV(encoded.data(), encoded.size()) == length);
+		
+		for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+			setSimdTier(static_cast<SimdTier>(t));
+			std::vector<double> decoded;
+			decodePicSV(encoded, decoded);
+			assert(decoded == expected);
+		}
+	}
+	setSimdTier(original);
+	
+	// data bytes that do not match the control bytes throw
+	std::vector<unsigned char> encoded;
+	encodePicSV(std::vector<double>(ics.begin(), ics.begin() + 1001), encoded);
+	std::vector<double> decoded;
+	std::vector<unsigned char> corrupt[4] = { encoded, encoded, encoded, encoded };
+	corrupt[0].pop_back();
+	corrupt[1].push_back(0);
+	corrupt[2][8] = 0xff;
+	corrupt[3][16 + 250] |= 0xc0;
+	for (size_t k=0; k<4; k++) {
+		try {
+			decodePicSV(corrupt[k], decoded);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+	
+	// as do Pic arrays
+	try {
+		decodePicSV(std::vector<unsigned char>(20, 0x11), decoded);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	cout << "+ pass    encodeDecodePicSV " << endl << endl;
+}
+
+
+
+void encodeDecodePicFOR() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// profile-like intensities: a baseline with noise and a few peaks
+	size_t n = 50000;
+	std::vector<double> profile(n), wide(n);
+	for (size_t i=0; i<n; i++) {
+		double peak = 5e5 * exp(-0.5 * pow((i % 500 - 250.0) / 4.0, 2));
+		profile[i] = floor(1000 + rand() % 200 + peak);
+		wide[i] = (rand() % 50 == 0) ? 2147483646.0 - rand() % 10 : rand() % (1 << (rand() % 31));
+	}
+	
+	SimdTier original = simdTier();
+	size_t lengths[] = { 0, 1, 2, 5, 127, 128, 129, 1000, n };
+	for (size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++) {
+		size_t length = lengths[k];
+		for (size_t c=0; c<2; c++) {
+			std::vector<double> part((c ? wide : profile).begin(), (c ? wide : profile).begin() + length);
+			
+			std::vector<unsigned char> pic(length * 5 + 8);
+			pic.resize(encodePic(part.data(), length, &pic[0]));
+			std::vector<double> expected(length);
+			expected.resize(decodePic(pic.data(), pic.size(), expected.data()));
+			
+			std::vector<unsigned char> encoded;
+			encodePicFOR(part, encoded);
+			assert(encoded.size() <= maxPicFORSize(length));
+			assert(decodedCountPicFOR(encoded.data(), encoded.size()) == length);
+			
+			for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+				setSimdTier(static_cast<SimdTier>(t));
+				std::vector<double> decoded;
+				decodePicFOR(encoded, decoded);
+				assert(decoded == expected);
+			}
+			
+			if (length == n && c == 0) {
+				cout << "+        Pic size: " << pic.size() / double(n*8) * 100 << "% " << endl;
+				cout << "+     PicFOR size: " << encoded.size() / double(n*8) * 100 << "% " << endl;
+				assert(encoded.size() < pic.size());
+			}
+		}
+	}
+	setSimdTier(original);
+	
+	// blocks that do not add up throw
+	std::vector<unsigned char> encoded;
+	encodePicFOR(std::vector<double>(wide.begin(), wide.begin() + 1000), encoded);
+	std::vector<double> decoded;
+	std::vector<unsigned char> corrupt[4] = { encoded, encoded, encoded, encoded };
+	corrupt[0].pop_back();
+	corrupt[1].push_back(0);
+	corrupt[2][8] = 0xff;
+	corrupt[3][16 + 4] = 33;
+	for (size_t k=0; k<4; k++) {
+		try {
+			decodePicFOR(corrupt[k], decoded);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+	
+	cout << "+ pass    encodeDecodePicFOR " << endl << endl;
+}
+
+
+
+void encodeDecodePicZR() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// sparse intensities: zero runs of every length between peaks and noise
+	size_t n = 50000;
+	std::vector<double> sparse(n, 0.0);
+	size_t runs[] = { 1, 2, 3, 16, 17, 18, 40, 1000 };
+	for (size_t i=1; i<n; ) {
+		sparse[i] = (rand() % 20 == 0) ? floor(5e5 * exp(-(rand() % 10))) : 1 + rand() % 200;
+		i += 1 + ((rand() % 4 == 0) ? 0 : runs[rand() % 8]);
+	}
+	
+	size_t lengths[] = { 1, 2, 17, 19, 1000, n - 1, n };
+	for (size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++) {
+		size_t length = lengths[k];
+		std::vector<double> part(sparse.begin(), sparse.begin() + length);
+		
+		std::vector<unsigned char> pic(length * 5 + 8);
+		pic.resize(encodePic(part.data(), length, &pic[0]));
+		std::vector<double> expected(length);
+		expected.resize(decodePic(pic.data(), pic.size(), expected.data()));
+		
+		std::vector<unsigned char> encoded;
+		encodePicZR(part, encoded);
+		assert(encoded.size() <= maxPicZRSize(length));
+		assert(decodedCountPicZR(encoded.data(), encoded.size()) == length);
+		
+		std::vector<double> decoded(3, 1.0);
+		decodePicZR(encoded, decoded);
+		assert(decoded == expected);
+		
+		// runs are zeroed in a buffer that is not
+		std::vector<double> buffer(length, 1.0);
+		assert(decodePicZR(encoded.data(), encoded.size(), buffer.data()) == length);
+		assert(buffer == expected);
+		
+		// the sparse mode gives exactly the values that are not zero
+		std::vector<size_t> indices;
+		std::vector<double> values;
+		decodePicZRSparse(encoded, indices, values);
+		assert(indices.size() == values.size());
+		size_t v = 0;
+		for (size_t i=0; i<length; i++) {
+			if (expected[i] != 0) {
+				assert(v < indices.size() && indices[v] == i && values[v] == expected[i]);
+				v++;
+			}
+		}
+		assert(v == indices.size());
+		
+		if (length == n) {
+			cout << "+        Pic size: " << pic.size() / double(n*8) * 100 << "% " << endl;
+			cout << "+      PicZR size: " << encoded.size() / double(n*8) * 100 << "% " << endl;
+			cout << "+   values not zero: " << values.size() << " of " << n << endl;
+			assert(encoded.size() < pic.size());
+		}
+	}
+	
+	// an array of only zeros is a few bytes
+	std::vector<unsigned char> encoded;
+	std::vector<double> decoded;
+	encodePicZR(std::vector<double>(n, 0.0), encoded);
+	assert(encoded.size() < 32);
+	decodePicZR(encoded, decoded);
+	assert(decoded == std::vector<double>(n, 0.0));
+	
+	// runs that do not add up throw, also for a count too large to allocate
+	encodePicZR(std::vector<double>(sparse.begin(), sparse.begin() + 1000), encoded);
+	std::vector<unsigned char> corrupt[5] = { encoded, encoded, encoded, encoded, encoded };
+	corrupt[0].resize(encoded.size() / 2);
+	corrupt[1].push_back(0xf0);
+	corrupt[2][8]++;
+	corrupt[3][8]--;
+	corrupt[4][14] = 0xff;
+	for (size_t k=0; k<5; k++) {
+		try {
+			decodePicZR(corrupt[k], decoded);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+	
+	cout << "+ pass    encodeDecodePicZR " << endl << endl;
+}
+
+
+
+void encodeDecodeLinearRL() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// retention times evenly spaced in pieces, ion mobility scan numbers 
+	// repeated per peak, and m/z values without runs
+	size_t n = 50000;
+	std::vector<double> rts(n), mobilities(n), mzs(n);
+	double rt = 1.5, spacing = 0.25;
+	double scan = 900;
+	double mz = 300;
+	for (size_t i=0; i<n; i++) {
+		if (rand() % 2000 == 0) {
+			spacing = (1 + rand() % 100) / 64.0;
+		}
+		rt += (rand() % 500 == 0) ? 3 * spacing : spacing;
+		rts[i] = rt;
+		scan -= (rand() % 40 == 0) ? 1 + rand() % 3 : 0;
+		mobilities[i] = scan;
+		mz += (rand() % 10000) / 1000.0;
+		mzs[i] = mz;
+	}
+	std::vector<double> *arrays[3] = { &rts, &mobilities, &mzs };
+	double fixedPoints[3] = { 64.0, 1.0, 1000.0 };
+	
+	size_t lengths[] = { 1, 2, 3, 4, 20, 1000, n };
+	for (size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++) {
+		size_t length = lengths[k];
+		for (size_t c=0; c<3; c++) {
+			std::vector<double> part(arrays[c]->begin(), arrays[c]->begin() + length);
+			
+			std::vector<unsigned char> linear;
+			encodeLinear(part, linear, fixedPoints[c]);
+			std::vector<double> expected;
+			decodeLinear(linear, expected);
+			
+			std::vector<unsigned char> encoded;
+			encodeLinearRL(part, encoded, fixedPoints[c]);
+			assert(encoded.size() <= maxLinearRLSize(length));
+			assert(decodedCountLinearRL(encoded.data(), encoded.size()) == length);
+			
+			SimdTier original = simdTier();
+			for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+				setSimdTier(static_cast<SimdTier>(t));
+				std::vector<double> decoded(3, 1.0);
+				decodeLinearRL(encoded, decoded);
+				assert(decoded == expected);
+			}
+			setSimdTier(original);
+			
+			if (length == n) {
+				const char *names[3] = { "rt", "mobility", "m/z" };
+				cout << "+  " << names[c] << " Linear size: " << linear.size() / double(n*8) * 100 << "%, "
+					<< "LinearRL size: " << encoded.size() / double(n*8) * 100 << "% " << endl;
+				assert(encoded.size() < linear.size() || c == 2);
+			}
+		}
+	}
+	
+	// runs of an evenly spaced array, and residuals of -7 and -8, round trip
+	std::vector<double> steps(n), expected, decoded;
+	for (size_t i=0; i<n; i++) {
+		steps[i] = (i < n/2) ? i * 8.0 : (i % 3) * -7.0 - (i % 5);
+	}
+	std::vector<unsigned char> linear, encoded;
+	encodeLinear(steps, linear, 1.0);
+	decodeLinear(linear, expected);
+	encodeLinearRL(steps, encoded, 1.0);
+	assert(encoded.size() < linear.size());
+	decodeLinearRL(encoded, decoded);
+	assert(decoded == expected);
+	
+	// values that do not add up throw, also for a count too large to allocate
+	std::vector<double> part(rts.begin(), rts.begin() + 1000);
+	encodeLinearRL(part, encoded, 64.0);
+	std::vector<unsigned char> corrupt[5] = { encoded, encoded, encoded, encoded, encoded };
+	corrupt[0].resize(encoded.size() / 2);
+	corrupt[1].push_back(0x88);
+	corrupt[2][16]++;
+	corrupt[3][16]--;
+	corrupt[4][22] = 0xff;
+	for (size_t k=0; k<5; k++) {
+		try {
+			decodeLinearRL(corrupt[k], decoded);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+	
+	cout << "+ pass    encodeDecodeLinearRL " << endl << endl;
+}
+
+
+
+void encodeDecodeLinearLog() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+	
+	// profile m/z with a spacing that grows with m/z, as from an Orbitrap
+	size_t n = 50000;
+	std::vector<double> mzs(n);
+	mzs[0] = 100.0;
+	for (size_t i=1; i<n; i++) {
+		mzs[i] = mzs[i-1] * (1 + 4e-6 * (1 + (rand() % 1000) / 1e4)) + ((rand() % 200 == 0) ? 1.0 : 0.0);
+	}
+	
+	SimdTier original = simdTier();
+	double tolerances[] = { 0.05, 1.0, 5.0 };
+	size_t lengths[] = { 1, 2, 3, 5, 1000, n };
+	for (size_t p=0; p<sizeof(tolerances)/sizeof(tolerances[0]); p++) {
+		double ppm = tolerances[p];
+		for (size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++) {
+			size_t length = lengths[k];
+			std::vector<double> part(mzs.begin(), mzs.begin() + length);
+			
+			std::vector<unsigned char> encoded;
+			for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+				setSimdTier(static_cast<SimdTier>(t));
+				std::vector<unsigned char> tier;
+				encodeLinearLog(part, tier, ppm);
+				assert(tier.size() <= maxLinearLogSize(length));
+				assert(t == SIMD_SCALAR || tier == encoded);
+				encoded = tier;
+			}
+			assert(decodedCountLinearLog(encoded.data(), encoded.size()) == length);
+			
+			// every tier decodes the same doubles
+			std::vector<double> scalar;
+			for (int t=SIMD_SCALAR; t<=SIMD_AVX512; t++) {
+				setSimdTier(static_cast<SimdTier>(t));
+				std::vector<double> decoded(3, 1.0);
+				decodeLinearLog(encoded, decoded);
+				assert(decoded.size() == length);
+				assert(t == SIMD_SCALAR || decoded == scalar);
+				scalar = decoded;
+				for (size_t i=0; i<length; i++) {
+					assert(fabs(decoded[i] / part[i] - 1) <= ppm * 1e-6);
+				}
+			}
+			
+			// against Linear with the absolute accuracy of ppm at the lowest m/z
+			if (length == n && ppm == 1.0) {
+				std::vector<unsigned char> linear;
+				encodeLinear(part, linear, 0.5 / (part[0] * ppm * 1e-6));
+				cout << "+     Linear size: " << linear.size() / double(n*8) * 100 << "% " << endl;
+				cout << "+  LinearLog size: " << encoded.size() / double(n*8) * 100 << "% " << endl;
+				assert(encoded.size() < linear.size());
+			}
+		}
+	}
+	setSimdTier(original);
+	
+	// tolerances out of reach, and values that have no log, throw
+	std::vector<unsigned char> encoded;
+	assert(optimalLinearLogFixedPoint(0) < 0);
+	assert(optimalLinearLogFixedPoint(1e-9) < 0);
+	try {
+		encodeLinearLog(mzs, encoded, -1.0);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	std::vector<double> zero(mzs.begin(), mzs.begin() + 10);
+	zero[5] = 0;
+	try {
+		encodeLinearLog(zero, encoded, 1.0);
+		assert(0 == 1);
+	} catch (const char *e) { }
+	
+	// values that do not add up throw, also for a count too large to allocate,
+	// as do fixed points of zero and NaN
+	std::vector<double> decoded;
+	encodeLinearLog(std::vector<double>(mzs.begin(), mzs.begin() + 1000), encoded, 1.0);
+	std::vector<unsigned char> corrupt[7] = { encoded, encoded, encoded, encoded, encoded, encoded, encoded };
+	corrupt[0].resize(encoded.size() / 2);
+	corrupt[1].push_back(0x88);
+	corrupt[2][16]++;
+	corrupt[3][16]--;
+	corrupt[4][22] = 0xff;
+	memset(&corrupt[5][8], 0, 8);
+	memset(&corrupt[6][8], 0xff, 8);
+	for (size_t k=0; k<7; k++) {
+		try {
+			decodeLinearLog(corrupt[k], decoded);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+	
+	cout << "+ pass    encodeDecodeLinearLog " << endl << endl;
+}
+
+
+
 void testErroneousDecodePic() {
 	std::vector<double> result;
 
@@ -771,14 +2368,39 @@ int main(int argc, const char* argv[]) {
 	decodeLinearCorrupt2();
 	encodeDecodeLinearStraight();
 	encodeDecodeLinear();
+	encodeLinearAuto();
+	encodePicBytes();
 	encodeDecodePic();
+	encodeDecodePicAllLengths();
 	encodeDecodeSafeStraight();
 	encodeDecodeSafe();
+	encodeSafeBytes();
 	optimalSlofFixedPoint();
 	encodeDecodeSlof();
+	encodeSlofRounding();
 	encodeDecodeLinear5();
+	decodeLinearExact();
 	encodeDecodePic5();
 	encodeDecodeSlof5();
+	decodeSlofTable();
+	simdTiers();
+	encodedSizeDecodedCount();
+	codecReuse();
+	encodeDecodeFramed();
+	encodeDecodeBatch();
+	streamingEncoders();
+	decodeLazy();
+	decodeLinearRange();
+	encodeDecodeIndexed();
+	seekIndex();
+	decodePicParallel();
+	base64Fused();
+	streamingDecoders();
+	encodeDecodePicSV();
+	encodeDecodePicFOR();
+	encodeDecodePicZR();
+	encodeDecodeLinearRL();
+	encodeDecodeLinearLog();
 	testErroneousDecodePic();
 	
 	cout << "=== all tests succeeded! ===" << endl;
@@ -0,0 +1,380 @@
+/*
+	MSNumpressZlib.cpp
+	johan.teleman@immun.lth.se
+
+	Copyright 2013 Johan Teleman
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "MSNumpressZlib.hpp"
+
+namespace ms {
+namespace numpress {
+namespace MSNumpress {
+
+using std::min;
+using std::max;
+
+// values encoded, and bytes inflated, at a time
+static const size_t ZLIB_TILE = 65536;
+
+// number of inflated tiles the pipeline keeps ahead of the decoder
+static const size_t PIPELINE_TILES = 4;
+
+/////////////////////////////////////////////////////////////
+
+/**
+ * Deflates the bytes it is given onto the end of a vector
+ */
+struct Deflater {
+	z_stream stream;
+	std::vector<unsigned char> *result;
+	size_t size;
+
+	Deflater(std::vector<unsigned char> *result_, int level) :
+			result(result_), size(0) {
+		memset(&stream, 0, sizeof(stream));
+		if (deflateInit(&stream, level) != Z_OK)
+			throw "[MSNumpress::encodeZlib] Could not initialise zlib deflate, is the level valid? ";
+		result->resize(ZLIB_TILE);
+	}
+
+	~Deflater() {
+		deflateEnd(&stream);
+	}
+
+	// zlib counts in uInt, so more than UINT_MAX bytes are deflated in parts
+	void put(const unsigned char *bytes, size_t n, int flush) {
+		const unsigned char *end = bytes + n;
+		for (;;) {
+			size_t chunk = min(static_cast<size_t>(end - bytes), static_cast<size_t>(UINT_MAX));
+			stream.next_in 	= const_cast<Bytef*>(bytes);
+			stream.avail_in = static_cast<uInt>(chunk);
+
+			if (result->size() - size < ZLIB_TILE / 4) {
+				result->resize(2 * result->size());
+			}
+			size_t room = min(result->size() - size, static_cast<size_t>(UINT_MAX));
+			stream.next_out 	= &(*result)[size];
+			stream.avail_out 	= static_cast<uInt>(room);
+
+			int status = deflate(&stream, (bytes + chunk == end) ? flush : Z_NO_FLUSH);
+			if (status == Z_STREAM_ERROR)
+				throw "[MSNumpress::encodeZlib] zlib deflate failed! ";
+			size 	+= room - stream.avail_out;
+			bytes 	+= chunk - stream.avail_in;
+
+			if (flush == Z_FINISH) {
+				if (status == Z_STREAM_END) return;
+			} else if (bytes == end && stream.avail_out > 0) {
+				return;
+			}
+		}
+	}
+
+	void finish() {
+		put(NULL, 0, Z_FINISH);
+		result->resize(size);
+	}
+};
+
+static void deflateSink(
+		void *context,
+		const unsigned char *bytes,
+		size_t size
+) {
+	static_cast<Deflater*>(context)->put(bytes, size, Z_NO_FLUSH);
+}
+
+
+
+/**
+ * Inflates a zlib stream a tile at a time
+ */
+struct Inflater {
+	z_stream stream;
+	const unsigned char *next;
+	const unsigned char *end;
+	bool ended;
+
+	Inflater(const unsigned char *data, size_t dataSize) :
+			next(data), end(data + dataSize), ended(false) {
+		memset(&stream, 0, sizeof(stream));
+		if (inflateInit(&stream) != Z_OK)
+			throw "[MSNumpress::decodeZlib] Could not initialise zlib inflate! ";
+	}
+
+	~Inflater() {
+		inflateEnd(&stream);
+	}
+
+	/**
+	 * Inflates up to capacity bytes into tile, fewer only at the end of the
+	 * stream, which sets ended.
+	 *
+	 * @return the number of inflated bytes
+	 */
+	size_t fill(unsigned char *tile, size_t capacity) {
+		stream.next_out 	= tile;
+		stream.avail_out 	= static_cast<uInt>(capacity);
+		while (!ended && stream.avail_out > 0) {
+			if (stream.avail_in == 0) {
+				size_t chunk = min(static_cast<size_t>(end - next), static_cast<size_t>(UINT_MAX));
+				stream.next_in 	= const_cast<Bytef*>(next);
+				stream.avail_in = static_cast<uInt>(chunk);
+				next += chunk;
+			}
+
+			int status = inflate(&stream, Z_NO_FLUSH);
+			if (status == Z_STREAM_END) {
+				ended = true;
+			} else if (status == Z_BUF_ERROR) {
+				throw "[MSNumpress::decodeZlib] Corrupt input data: the zlib stream is truncated! ";
+			} else if (status != Z_OK) {
+				throw "[MSNumpress::decodeZlib] Corrupt input data: not a valid zlib stream! ";
+			}
+		}
+		return capacity - stream.avail_out;
+	}
+};
+
+
+
+/**
+ * Runs an Inflater on its own thread, PIPELINE_TILES tiles ahead of the
+ * thread that decodes them. Tile k goes to slot k % PIPELINE_TILES, which
+ * is refilled once the decoder has released it.
+ */
+struct InflatePipeline {
+	Inflater &inflater;
+	std::vector<unsigned char> tiles;
+	size_t sizes[PIPELINE_TILES];
+	size_t filled;
+	size_t released;
+	bool ended;
+	bool stopped;
+	const char *error;
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	explicit InflatePipeline(Inflater &inflater_) :
+			inflater(inflater_), tiles(PIPELINE_TILES * ZLIB_TILE),
+			filled(0), released(0), ended(false), stopped(false), error(NULL) {
+	}
+
+	void run() {
+		for (size_t k=0; ; k++) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return stopped || k - released < PIPELINE_TILES; });
+				if (stopped) return;
+			}
+
+			size_t n = 0;
+			const char *failure = NULL;
+			try {
+				n = inflater.fill(&tiles[(k % PIPELINE_TILES) * ZLIB_TILE], ZLIB_TILE);
+			} catch (const char *e) {
+				failure = e;
+			}
+
+			bool last = inflater.ended || failure != NULL;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				sizes[k % PIPELINE_TILES] = n;
+				filled += (failure == NULL) ? 1 : 0;
+				ended = last;
+				error = failure;
+			}
+			changed.notify_all();
+			if (last) return;
+		}
+	}
+
+	// waits for tile k, false if the stream ended before it
+	bool next(size_t k, const unsigned char **bytes, size_t *size) {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&] { return filled > k || ended; });
+		if (filled <= k) return false;
+		*bytes 	= &tiles[(k % PIPELINE_TILES) * ZLIB_TILE];
+		*size 	= sizes[k % PIPELINE_TILES];
+		return true;
+	}
+
+	void release() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			released++;
+		}
+		changed.notify_all();
+	}
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+		}
+		changed.notify_all();
+	}
+};
+
+
+
+/**
+ * Inflates data and decodes it with a Decoder (LinearDecoder, PicDecoder or
+ * SlofDecoder). The first tile is always inflated on the calling thread,
+ * so that arrays of a single tile never start a thread.
+ */
+template <typename Decoder>
+static void decodeZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads
+) {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+
+	Decoder decoder;
+	Inflater inflater(data, dataSize);
+	result.clear();
+
+	std::vector<unsigned char> tile(ZLIB_TILE);
+	size_t n = inflater.fill(&tile[0], ZLIB_TILE);
+	decoder.push(tile.data(), n, result);
+
+	if (threads <= 1) {
+		while (!inflater.ended) {
+			n = inflater.fill(&tile[0], ZLIB_TILE);
+			decoder.push(tile.data(), n, result);
+		}
+	} else if (!inflater.ended) {
+		InflatePipeline pipeline(inflater);
+		std::thread worker(&InflatePipeline::run, &pipeline);
+		try {
+			const unsigned char *bytes;
+			for (size_t k=0; pipeline.next(k, &bytes, &n); k++) {
+				decoder.push(bytes, n, result);
+				pipeline.release();
+			}
+		} catch (...) {
+			pipeline.stop();
+			worker.join();
+			throw;
+		}
+		worker.join();
+		if (pipeline.error) throw pipeline.error;
+	}
+
+	decoder.finish(result);
+}
+
+/////////////////////////////////////////////////////////////
+
+void encodeLinearZlib(
+		const double *data,
+		size_t dataSize,
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		int level
+) {
+	Deflater deflater(&result, level);
+	LinearEncoder encoder(fixedPoint, deflateSink, &deflater);
+	encoder.push(data, dataSize);
+	encoder.finish();
+	deflater.finish();
+}
+
+
+
+void encodePicZlib(
+		const double *data,
+		size_t dataSize,
+		std::vector<unsigned char> &result,
+		int level
+) {
+	Deflater deflater(&result, level);
+	PicEncoder encoder(deflateSink, &deflater);
+	encoder.push(data, dataSize);
+	encoder.finish();
+	deflater.finish();
+}
+
+
+
+void encodeSlofZlib(
+		const double *data,
+		size_t dataSize,
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		int level
+) {
+	Deflater deflater(&result, level);
+	std::vector<unsigned char> tile(ZLIB_TILE + 8);
+
+	encodeSlof(data, 0, &tile[0], fixedPoint);
+	deflater.put(&tile[0], 8, Z_NO_FLUSH);
+	for (size_t i=0; i<dataSize; i+=ZLIB_TILE/2) {
+		size_t n = min(ZLIB_TILE/2, dataSize - i);
+		encodeSlof(data + i, n, &tile[0], fixedPoint);
+		deflater.put(&tile[8], 2 * n, Z_NO_FLUSH);
+	}
+	deflater.finish();
+}
+
+
+
+void decodeLinearZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads
+) {
+	decodeZlib<LinearDecoder>(data, dataSize, result, threads);
+}
+
+
+
+void decodePicZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads
+) {
+	decodeZlib<PicDecoder>(data, dataSize, result, threads);
+}
+
+
+
+void decodeSlofZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads
+) {
+	decodeZlib<SlofDecoder>(data, dataSize, result, threads);
+}
+
+} // namespace MSNumpress
+} // namespace numpress
+} // namespace ms
@@ -0,0 +1,129 @@
+/*
+	MSNumpressZlib.hpp
+	johan.teleman@immun.lth.se
+
+	Copyright 2013 Johan Teleman
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+/*
+	==================== numpress + zlib ====================
+	The PSI-MS controlled vocabulary has terms for numpress followed by zlib
+	compression (e.g. MS:1002746, "MS-Numpress linear prediction compression
+	followed by zlib compression"). This optional module does both steps in
+	one pass, through tiles of a fixed size: values are encoded into a small
+	buffer that is deflated before the next tile is encoded, and inflated
+	tiles are decoded by the streaming decoders while they are still in
+	cache. Apart from the result, memory use does not grow with the array.
+
+	The compressed data is a zlib stream (RFC 1950) of exactly the bytes the
+	classic encode functions give, so it can be written to and read from
+	mzML as it is.
+
+	The module is compiled separately and needs the system zlib, e.g.
+
+	> g++ MSNumpress.cpp MSNumpressZlib.cpp MSNumpressZlibTest.cpp -lz -o testZlib
+ */
+
+#ifndef _MSNUMPRESSZLIB_HPP_
+#define _MSNUMPRESSZLIB_HPP_
+
+#include "MSNumpress.hpp"
+
+namespace ms {
+namespace numpress {
+
+namespace MSNumpress {
+
+	/**
+	 * Encodes data as encodeLinear does and compresses the bytes with zlib.
+	 *
+	 * @data		pointer to array of double to be encoded (need memorycont. repr.)
+	 * @dataSize	number of doubles from *data to encode
+	 * @result		the zlib stream, replacing the contents
+	 * @fixedPoint	the scaling factor used for getting the fixed point repr.
+	 * @level		the zlib compression level, 0 to 9, or -1 for the zlib default
+	 */
+	void encodeLinearZlib(
+		const double *data,
+		size_t dataSize,
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		int level);
+
+	/**
+	 * Encodes data as encodePic does and compresses the bytes with zlib.
+	 * See encodeLinearZlib.
+	 */
+	void encodePicZlib(
+		const double *data,
+		size_t dataSize,
+		std::vector<unsigned char> &result,
+		int level);
+
+	/**
+	 * Encodes data as encodeSlof does and compresses the bytes with zlib.
+	 * See encodeLinearZlib.
+	 */
+	void encodeSlofZlib(
+		const double *data,
+		size_t dataSize,
+		std::vector<unsigned char> &result,
+		double fixedPoint,
+		int level);
+
+	/**
+	 * Inflates a zlib stream written by encodeLinearZlib (or by zlib from
+	 * the bytes of encodeLinear) and decodes it.
+	 *
+	 * With more than one thread, inflating and decoding are pipelined: one
+	 * thread inflates the next tiles while the calling thread decodes. The
+	 * result is the same.
+	 *
+	 * @data		pointer to the zlib stream
+	 * @dataSize	number of bytes in the stream
+	 * @result		the decoded values, replacing the contents
+	 * @threads		1 to inflate and decode in turn, 0 to pipeline if there
+	 *				is more than one core, 2 or more to pipeline
+	 */
+	void decodeLinearZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads);
+
+	/**
+	 * Inflates and decodes a zlib stream of an encodePic array. See
+	 * decodeLinearZlib.
+	 */
+	void decodePicZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads);
+
+	/**
+	 * Inflates and decodes a zlib stream of an encodeSlof array. See
+	 * decodeLinearZlib.
+	 */
+	void decodeSlofZlib(
+		const unsigned char *data,
+		size_t dataSize,
+		std::vector<double> &result,
+		size_t threads);
+
+} // namespace MSNumpress
+} // namespace numpress
+} // namespace ms
+
+#endif // _MSNUMPRESSZLIB_HPP_
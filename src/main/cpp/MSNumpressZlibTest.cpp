@@ -0,0 +1,174 @@
+/*
+	MSNumpressZlibTest.cpp
+	johan.teleman@immun.lth.se
+
+	Copyright 2013 Johan Teleman
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*
+	Compile and run tests (on LINUX) with
+
+	> g++ MSNumpress.cpp MSNumpressZlib.cpp MSNumpressZlibTest.cpp -lz -o testZlib && ./testZlib
+
+ */
+
+#include "MSNumpressZlib.hpp"
+#include <assert.h>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <zlib.h>
+
+using std::cout;
+using std::endl;
+
+
+
+/**
+ * Plain zlib of the whole buffer, as callers did it before
+ */
+std::vector<unsigned char> compressAll(const std::vector<unsigned char> &bytes) {
+	uLongf size = compressBound(bytes.size());
+	std::vector<unsigned char> compressed(size);
+	assert(compress(&compressed[0], &size, bytes.data(), bytes.size()) == Z_OK);
+	compressed.resize(size);
+	return compressed;
+}
+
+
+
+void encodeDecodeZlib() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+
+	// up to many tiles of encoded bytes
+	size_t sizes[] = { 0, 1, 2, 3, 1000, 70000, 400000 };
+	for (size_t k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++) {
+		size_t n = sizes[k];
+		std::vector<double> mzs(n + 1), ics(n + 1);
+		mzs[0] = 300.0;
+		for (size_t i=1; i<n; i++)
+			mzs[i] = mzs[i-1] + (rand() % 10000) / 1000.0;
+		for (size_t i=0; i<n; i++)
+			ics[i] = rand() % ((i % 3 == 0) ? 2000000 : 100);
+
+		std::vector<unsigned char> bytes[3];
+		std::vector<double> expected[3];
+		bytes[0].resize(n * 5 + 8);
+		bytes[0].resize(encodeLinear(&mzs[0], n, &bytes[0][0], 1000.0));
+		bytes[1].resize(n * 5 + 8);
+		bytes[1].resize(encodePic(&ics[0], n, &bytes[1][0]));
+		bytes[2].resize(n * 2 + 8);
+		bytes[2].resize(encodeSlof(&ics[0], n, &bytes[2][0], 4000.0));
+		for (size_t c=0; c<3; c++) {
+			expected[c].resize(n + 1);
+		}
+		expected[0].resize(decodeLinear(&bytes[0][0], bytes[0].size(), &expected[0][0]));
+		expected[1].resize(decodePic(bytes[1].data(), bytes[1].size(), &expected[1][0]));
+		expected[2].resize(decodeSlof(&bytes[2][0], bytes[2].size(), &expected[2][0]));
+
+		std::vector<unsigned char> compressed[3];
+		encodeLinearZlib(&mzs[0], n, compressed[0], 1000.0, Z_DEFAULT_COMPRESSION);
+		encodePicZlib(&ics[0], n, compressed[1], Z_DEFAULT_COMPRESSION);
+		encodeSlofZlib(&ics[0], n, compressed[2], 4000.0, Z_DEFAULT_COMPRESSION);
+
+		for (size_t c=0; c<3; c++) {
+			// the same bytes as zlib of the classic encoding, at any level
+			std::vector<unsigned char> inflated(bytes[c].size() + 1);
+			uLongf size = inflated.size();
+			assert(uncompress(&inflated[0], &size, compressed[c].data(), compressed[c].size()) == Z_OK);
+			inflated.resize(size);
+			assert(inflated == bytes[c]);
+
+			// and what callers compressed themselves decodes too
+			std::vector<unsigned char> streams[2] = { compressed[c], compressAll(bytes[c]) };
+			for (size_t s=0; s<2; s++) {
+				for (size_t threads=0; threads<=4; threads+=2) {
+					std::vector<double> decoded(3, 1.0);
+					if 		(c == 0) decodeLinearZlib(streams[s].data(), streams[s].size(), decoded, threads);
+					else if (c == 1) decodePicZlib(streams[s].data(), streams[s].size(), decoded, threads);
+					else 			 decodeSlofZlib(streams[s].data(), streams[s].size(), decoded, threads);
+					assert(decoded == expected[c]);
+				}
+			}
+		}
+
+		std::vector<unsigned char> fast, small;
+		encodePicZlib(&ics[0], n, fast, 1);
+		encodePicZlib(&ics[0], n, small, 9);
+		std::vector<double> decoded;
+		decodePicZlib(fast.data(), fast.size(), decoded, 1);
+		assert(decoded == expected[1]);
+		decodePicZlib(small.data(), small.size(), decoded, 2);
+		assert(decoded == expected[1]);
+	}
+
+	cout << "+ pass    encodeDecodeZlib " << endl << endl;
+}
+
+
+
+void corruptZlib() {
+	using namespace ms::numpress::MSNumpress;
+	srand(123459);
+
+	size_t n = 300000;
+	std::vector<double> ics(n);
+	for (size_t i=0; i<n; i++)
+		ics[i] = rand() % 1000000;
+	std::vector<unsigned char> compressed;
+	encodePicZlib(&ics[0], n, compressed, Z_DEFAULT_COMPRESSION);
+
+	// truncated streams and garbage throw, in the pipeline as well
+	size_t lengths[] = { 0, 1, 10, compressed.size() / 2, compressed.size() - 1 };
+	for (size_t k=0; k<sizeof(lengths)/sizeof(lengths[0]); k++) {
+		for (size_t threads=1; threads<=2; threads++) {
+			std::vector<double> decoded;
+			try {
+				decodePicZlib(compressed.data(), lengths[k], decoded, threads);
+				assert(0 == 1);
+			} catch (const char *e) { }
+		}
+	}
+
+	std::vector<unsigned char> garbage(compressed);
+	for (size_t i=garbage.size() / 3; i<garbage.size() / 3 + 64; i++)
+		garbage[i] = rand() % 256;
+	for (size_t threads=1; threads<=2; threads++) {
+		std::vector<double> decoded;
+		try {
+			decodePicZlib(garbage.data(), garbage.size(), decoded, threads);
+			assert(0 == 1);
+		} catch (const char *e) { }
+	}
+
+	// as do invalid levels
+	try {
+		encodePicZlib(&ics[0], n, compressed, 12);
+		assert(0 == 1);
+	} catch (const char *e) { }
+
+	cout << "+ pass    corruptZlib " << endl << endl;
+}
+
+
+
+int main(int argc, const char* argv[]) {
+	encodeDecodeZlib();
+	corruptZlib();
+
+	cout << "=== all tests succeeded! ===" << endl;
+	return 0;
+}